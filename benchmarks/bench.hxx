@@ -0,0 +1,69 @@
+#ifndef REPLXX_BENCH_HXX_INCLUDED
+#define REPLXX_BENCH_HXX_INCLUDED 1
+
+#include <chrono>
+#include <cstdio>
+
+namespace replxx {
+
+namespace bench {
+
+// Run f_( i ) for i in [0, iterations_) and return average time of a single call in nanoseconds.
+template<typename func_t>
+double measure( func_t f_, int iterations_ ) {
+	std::chrono::steady_clock::time_point start( std::chrono::steady_clock::now() );
+	for ( int i( 0 ); i < iterations_; ++ i ) {
+		f_( i );
+	}
+	std::chrono::steady_clock::time_point end( std::chrono::steady_clock::now() );
+	return ( static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() ) / iterations_ );
+}
+
+// Print a single result in output format selected on command line.
+void report( char const* group_, char const* name_, double value_, char const* unit_ );
+
+// Record failed correctness check, replxx-bench then exits with non-zero status.
+void fail( char const* group_, char const* message_ );
+
+inline void report( char const* group_, char const* name_, double nsPerOp_ ) {
+	report( group_, name_, nsPerOp_, "ns/op" );
+}
+
+// Number of heap allocations made so far by the benchmark binary.
+int long allocation_count( void );
+
+// Run f_( i ) for i in [0, iterations_) and return average number of heap allocations made by a single call.
+template<typename func_t>
+double count_allocations( func_t f_, int iterations_ ) {
+	int long start( allocation_count() );
+	for ( int i( 0 ); i < iterations_; ++ i ) {
+		f_( i );
+	}
+	return ( static_cast<double>( allocation_count() - start ) / iterations_ );
+}
+
+inline void report_allocations( char const* group_, char const* name_, double allocsPerOp_ ) {
+	report( group_, name_, allocsPerOp_, "allocs/op" );
+}
+
+inline void report_bytes( char const* group_, char const* name_, double bytesPerOp_ ) {
+	report( group_, name_, bytesPerOp_, "bytes/op" );
+}
+
+void keymap( void );
+void editbuffer( void );
+void candidates( void );
+void conversion( void );
+void conversion_check( void );
+void unicodestring( void );
+void unicodestring_check( void );
+void terminal( void );
+void width( void );
+void history( void );
+
+}
+
+}
+
+#endif
+
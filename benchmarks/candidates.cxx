@@ -0,0 +1,153 @@
+#include <vector>
+#include <string>
+#include <cstdio>
+
+#include "bench.hxx"
+#include "candidates.hxx"
+#include "fuzzymatcher.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+void candidates( void ) {
+	int const iterations( 200 );
+	int const count( 10000 );
+	int const displayed( 20 );
+	std::vector<std::string> words;
+	words.reserve( count );
+	for ( int i( 0 ); i < count; ++ i ) {
+		char buf[32];
+		snprintf( buf, sizeof ( buf ), "candidate_%05d", i );
+		words.push_back( buf );
+	}
+	std::string const input( "candidate_" );
+	int volatile sink( 0 );
+
+	/* std::string callback, every candidate copied and converted */ {
+		double ns(
+			measure(
+				[&]( int ) {
+					std::string in( input );
+					std::vector<std::string> out( words );
+					std::vector<UnicodeString> completions;
+					completions.reserve( out.size() );
+					for ( std::string const& c : out ) {
+						completions.emplace_back( c.c_str() );
+					}
+					sink = sink + completions[displayed].length();
+				},
+				iterations
+			)
+		);
+		report( "candidates", "copy and convert all 10K", ns );
+	}
+
+	/* view callback, candidates appended to sink, displayed ones converted */ {
+		CandidateList completions;
+		double ns(
+			measure(
+				[&]( int ) {
+					Replxx::StringView in( input.c_str(), static_cast<int>( input.length() ) );
+					Replxx::Candidates& out( completions.sink() );
+					for ( std::string const& c : words ) {
+						out.add( c );
+					}
+					sink = sink + in.size() + completions.longest_common_prefix();
+					for ( int i( 0 ); i < displayed; ++ i ) {
+						sink = sink + completions[i].length();
+					}
+				},
+				iterations
+			)
+		);
+		report( "candidates", "sink 10K, convert 20", ns );
+	}
+
+	/* fixed vocabulary of 200K identifiers, linear scan versus index */ {
+		int const vocabularySize( 200000 );
+		std::vector<std::string> vocabulary;
+		vocabulary.reserve( vocabularySize );
+		Replxx::CompletionIndex index;
+		for ( int i( 0 ); i < vocabularySize; ++ i ) {
+			char buf[32];
+			snprintf( buf, sizeof ( buf ), "ident_%c%c_%06d", 'a' + i % 26, 'a' + ( i / 26 ) % 26, i );
+			vocabulary.push_back( buf );
+			index.add( buf );
+		}
+		index.size();
+		std::string const prefix( "ident_qx_" );
+		CandidateList completions;
+		double ns(
+			measure(
+				[&]( int ) {
+					Replxx::Candidates& out( completions.sink() );
+					for ( std::string const& w : vocabulary ) {
+						if ( w.compare( 0, prefix.length(), prefix ) == 0 ) {
+							out.add( w );
+						}
+					}
+					sink = sink + completions.longest_common_prefix();
+				},
+				iterations
+			)
+		);
+		report( "candidates", "scan 200K words", ns );
+		ns = measure(
+			[&]( int ) {
+				Replxx::StringView p( prefix.c_str(), static_cast<int>( prefix.length() ) );
+				index.complete( p, completions.sink() );
+				completions.set_common_prefix( index.longest_common_prefix( p ) );
+				sink = sink + completions.longest_common_prefix();
+			},
+			iterations
+		);
+		report( "candidates", "index 200K words", ns );
+	}
+
+	/* fuzzy ranking of 100K identifiers, top 20 kept */ {
+		int const candidateCount( 100000 );
+		char const* const parts[] = { "get", "set", "Buffer", "Cursor", "line", "Width", "history", "Index", "max", "_size" };
+		int const partCount( static_cast<int>( sizeof ( parts ) / sizeof ( parts[0] ) ) );
+		Replxx::Candidates all;
+		Replxx::CompletionIndex index;
+		for ( int i( 0 ); i < candidateCount; ++ i ) {
+			char buf[64];
+			snprintf(
+				buf, sizeof ( buf ), "%s%s%s%d",
+				parts[i % partCount], parts[( i / partCount ) % partCount], parts[( i / 7 ) % partCount], i
+			);
+			all.add( buf );
+			index.add( buf );
+		}
+		index.size();
+		std::string const pattern( "gcwid" );
+		Replxx::StringView p( pattern.c_str(), static_cast<int>( pattern.length() ) );
+		FuzzyMatcher matcher;
+		matcher.set_pattern( p.data(), p.size() );
+		Replxx::Candidates ranked;
+		double ns(
+			measure(
+				[&]( int ) {
+					ranked.clear();
+					sink = sink + matcher.rank( all, ranked, 20 );
+				},
+				20
+			)
+		);
+		report( "candidates", "fuzzy rank 100K", ns );
+		ns = measure(
+			[&]( int ) {
+				ranked.clear();
+				sink = sink + index.complete_fuzzy( p, ranked, 20 );
+			},
+			20
+		);
+		report( "candidates", "fuzzy index 100K", ns );
+	}
+}
+
+}
+
+}
+
@@ -0,0 +1,230 @@
+#include <vector>
+#include <string>
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+#include "bench.hxx"
+#include "conversion.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+// Conversions as done before fast paths were added.
+ConversionResult scalar8to32( char32_t* dst_, int dstSize_, int& dstCount_, char const* src_ ) {
+	UTF8 const* sourceStart( reinterpret_cast<UTF8 const*>( src_ ) );
+	UTF8 const* sourceEnd( sourceStart + strlen( src_ ) );
+	UTF32* targetStart( reinterpret_cast<UTF32*>( dst_ ) );
+	ConversionResult res( ConvertUTF8toUTF32( &sourceStart, sourceEnd, &targetStart, targetStart + dstSize_, lenientConversion ) );
+	if ( res == conversionOK ) {
+		dstCount_ = static_cast<int>( targetStart - reinterpret_cast<UTF32*>( dst_ ) );
+	}
+	return ( res );
+}
+
+ConversionResult scalar32to8( char* dst_, int dstSize_, char32_t const* src_, int srcSize_, int& dstCount_ ) {
+	UTF32 const* sourceStart( reinterpret_cast<UTF32 const*>( src_ ) );
+	UTF8* targetStart( reinterpret_cast<UTF8*>( dst_ ) );
+	ConversionResult res( ConvertUTF32toUTF8( &sourceStart, sourceStart + srcSize_, &targetStart, targetStart + dstSize_, lenientConversion ) );
+	if ( res == conversionOK ) {
+		dstCount_ = static_cast<int>( targetStart - reinterpret_cast<UTF8*>( dst_ ) );
+	}
+	return ( res );
+}
+
+// Convert NUL terminated text_ from UTF-8 with scalar code and with fast paths, true if results are the same.
+bool same_8to32( char const* text_, int size_, int dstSize_ ) {
+	std::vector<char32_t> expected( dstSize_ + 1, 0 );
+	std::vector<char32_t> actual( dstSize_ + 1, 0 );
+	int expectedCount( -1 );
+	int actualCount( -1 );
+	ConversionResult expectedRes( scalar8to32( expected.data(), dstSize_, expectedCount, text_ ) );
+	ConversionResult actualRes( copyString8to32( actual.data(), dstSize_, actualCount, text_, size_ ) );
+	return (
+		( expectedRes == actualRes )
+		&& ( expectedCount == actualCount )
+		&& std::equal( expected.begin(), expected.begin() + std::max( expectedCount, 0 ), actual.begin() )
+	);
+}
+
+// Convert text_ to UTF-8 with scalar code and with fast paths, true if results are the same.
+bool same_32to8( char32_t const* text_, int size_, int dstSize_ ) {
+	std::vector<char> expected( dstSize_ + 1, 0 );
+	std::vector<char> actual( dstSize_ + 1, 0 );
+	int expectedCount( -1 );
+	int actualCount( -1 );
+	ConversionResult expectedRes( scalar32to8( expected.data(), dstSize_, text_, size_, expectedCount ) );
+	copyString32to8( actual.data(), dstSize_, text_, size_, &actualCount );
+	return (
+		( ( expectedRes == conversionOK ) == ( actualCount >= 0 ) )
+		&& ( expectedCount == actualCount )
+		&& std::equal( expected.begin(), expected.begin() + std::max( expectedCount, 0 ), actual.begin() )
+	);
+}
+
+// Compare fast paths with scalar conversion, returns number of mismatching inputs.
+//
+// Every input is an ASCII run with a single non-ASCII piece (valid, invalid or surrogate)
+// put at every position, runs are converted from every offset within a vector
+// and with every tail length past last full vector, output buffer is either big enough
+// or ends at the piece. Random, often malformed, input covers the rest.
+int check_fast_paths( void ) {
+	char const* const pieces8[] = {
+		"\xc3\xa9",         // U+00E9
+		"\xe2\x82\xac",     // U+20AC
+		"\xf0\x9f\x98\x80", // U+1F600
+		"\x80",             // stray continuation byte
+		"\xe2\x82",         // truncated sequence
+		"\xc0\xaf",         // overlong
+		"\xff",             // never valid
+		"\xed\xa0\x80",     // UTF-16 surrogate
+		"\xf4\x90\x80\x80"  // beyond U+10FFFF
+	};
+	char32_t const pieces32[] = { 0x7f, 0x80, 0xe9, 0x20ac, 0x1f600, 0xd800, 0xdfff, 0x10ffff, 0x110000 };
+	int const maxOffset( 32 );
+	int const maxLen( 2 * 32 + 8 );
+	int mismatches( 0 );
+	for ( int offset( 0 ); offset < maxOffset; ++ offset ) {
+		for ( int len( 0 ); len <= maxLen; ++ len ) {
+			// conversion starts offset characters into the buffer
+			std::string text( static_cast<size_t>( offset + len ), 'a' );
+			for ( int i( 0 ); i < offset + len; ++ i ) {
+				text[i] = static_cast<char>( 'a' + i % 26 );
+			}
+			std::vector<char32_t> text32( text.begin(), text.end() );
+			if ( ! same_8to32( text.c_str() + offset, len, len + 1 ) || ! same_32to8( text32.data() + offset, len, len + 1 ) ) {
+				++ mismatches;
+			}
+			for ( int pos( 0 ); pos < len; ++ pos ) {
+				for ( char const* piece : pieces8 ) {
+					std::string mixed( text );
+					mixed.replace( static_cast<size_t>( offset + pos ), 1, piece );
+					int size( static_cast<int>( mixed.length() ) - offset );
+					if ( ! same_8to32( mixed.c_str() + offset, size, size + 1 ) || ! same_8to32( mixed.c_str() + offset, size, pos ) ) {
+						++ mismatches;
+					}
+				}
+				for ( char32_t piece : pieces32 ) {
+					std::vector<char32_t> mixed( text32 );
+					mixed[offset + pos] = piece;
+					if ( ! same_32to8( mixed.data() + offset, len, len * 4 + 1 ) || ! same_32to8( mixed.data() + offset, len, pos ) ) {
+						++ mismatches;
+					}
+				}
+			}
+		}
+	}
+	std::mt19937 rng( 7 );
+	UTF8 const bytes[] = { 'a', 'Z', ' ', 0x7f, 0x80, 0xbf, 0xc2, 0xc3, 0xa9, 0xe2, 0x82, 0xac, 0xed, 0xa0, 0xf0, 0x9f, 0x98, 0x80, 0xf4, 0x90, 0xff, 0 };
+	int const byteCount( static_cast<int>( sizeof ( bytes ) / sizeof ( bytes[0] ) ) );
+	for ( int round( 0 ); round < 20000; ++ round ) {
+		int len( static_cast<int>( rng() % 100 ) );
+		std::string text;
+		for ( int i( 0 ); i < len; ++ i ) {
+			text.push_back( static_cast<char>( ( rng() % 4 ) ? 'a' + rng() % 26 : bytes[rng() % byteCount] ) );
+		}
+		if ( ! same_8to32( text.c_str(), len, static_cast<int>( rng() % ( len + 2 ) ) ) ) {
+			++ mismatches;
+		}
+		std::vector<char32_t> text32;
+		for ( int i( 0 ); i < len; ++ i ) {
+			text32.push_back( ( rng() % 4 ) ? 'a' + rng() % 26 : static_cast<char32_t>( rng() % 0x120000 ) );
+		}
+		if ( ! same_32to8( text32.data(), len, static_cast<int>( rng() % ( len * 4 + 2 ) ) ) ) {
+			++ mismatches;
+		}
+	}
+	return ( mismatches );
+}
+
+char const* isa_name( simd::ISA isa_ ) {
+	switch ( isa_ ) {
+		case ( simd::ISA::AVX2 ): return ( "avx2" );
+		case ( simd::ISA::SSE2 ): return ( "sse2" );
+		default: break;
+	}
+	return ( "none" );
+}
+
+}
+
+void conversion( void ) {
+	int const iterations( 20000 );
+	int const size( 4096 );
+	simd::ISA const best( simd::isa() );
+	std::string ascii( size, 'x' );
+	std::string mixed;
+	while ( static_cast<int>( mixed.length() ) < size ) {
+		mixed.append( "price: 10\xe2\x82\xac, caf\xc3\xa9 " );
+	}
+	std::vector<char32_t> buf32( size + 1 );
+	std::vector<char> buf8( size * 4 + 1 );
+	int volatile sink( 0 );
+
+	struct Input {
+		char const* name;
+		std::string const& text;
+	} const inputs[] = { { "ascii", ascii }, { "mixed", mixed } };
+
+	for ( Input const& in : inputs ) {
+		int len32( 0 );
+		copyString8to32( buf32.data(), size, len32, in.text.c_str() );
+		std::string name( std::string( "8to32 " ) + in.name + " scalar" );
+		report(
+			"conversion", name.c_str(),
+			measure( [&]( int ) { int n( 0 ); scalar8to32( buf32.data(), size, n, in.text.c_str() ); sink = sink + n; }, iterations )
+		);
+		for ( simd::ISA isa : { simd::ISA::NONE, simd::ISA::SSE2, simd::ISA::AVX2 } ) {
+			if ( ( simd::set_isa( isa ) != isa ) || ( isa == simd::ISA::NONE ) ) {
+				continue;
+			}
+			name = std::string( "8to32 " ) + in.name + " " + isa_name( isa );
+			report(
+				"conversion", name.c_str(),
+				measure( [&]( int ) { int n( 0 ); copyString8to32( buf32.data(), size, n, in.text.c_str(), static_cast<int>( in.text.length() ) ); sink = sink + n; }, iterations )
+			);
+		}
+		simd::set_isa( best );
+		name = std::string( "32to8 " ) + in.name + " scalar";
+		report(
+			"conversion", name.c_str(),
+			measure( [&]( int ) { int n( 0 ); scalar32to8( buf8.data(), static_cast<int>( buf8.size() ), buf32.data(), len32, n ); sink = sink + n; }, iterations )
+		);
+		for ( simd::ISA isa : { simd::ISA::SSE2, simd::ISA::AVX2 } ) {
+			if ( simd::set_isa( isa ) != isa ) {
+				continue;
+			}
+			name = std::string( "32to8 " ) + in.name + " " + isa_name( isa );
+			report(
+				"conversion", name.c_str(),
+				measure( [&]( int ) { int n( 0 ); copyString32to8( buf8.data(), static_cast<int>( buf8.size() ), buf32.data(), len32, &n ); sink = sink + n; }, iterations )
+			);
+		}
+		simd::set_isa( best );
+	}
+}
+
+// Every instruction set supported by the CPU must give the same results as scalar ConvertUTF code.
+void conversion_check( void ) {
+	simd::ISA const best( simd::isa() );
+	for ( simd::ISA isa : { simd::ISA::NONE, simd::ISA::SSE2, simd::ISA::AVX2 } ) {
+		if ( simd::set_isa( isa ) != isa ) {
+			continue;
+		}
+		int mismatches( check_fast_paths() );
+		std::string name( std::string( "check " ) + isa_name( isa ) );
+		report( "conversion", name.c_str(), mismatches, "mismatches" );
+		if ( mismatches > 0 ) {
+			fail( "conversion", ( std::string( isa_name( isa ) ) + " fast path differs from scalar conversion" ).c_str() );
+		}
+	}
+	simd::set_isa( best );
+}
+
+}
+
+}
+
@@ -0,0 +1,120 @@
+#include <vector>
+#include <cstdio>
+
+#include "bench.hxx"
+#include "editbuffer.hxx"
+#include "utf8string.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+void editbuffer( void ) {
+	int const iterations( 200000 );
+	int const size( 100000 );
+	int const pos( 100 );
+
+	/* std::vector<char32_t>, type near the start of 100K line */ {
+		std::vector<char32_t> data( size, 'x' );
+		double ns(
+			measure(
+				[&]( int i ) {
+					if ( i & 1 ) {
+						data.erase( data.begin() + pos );
+					} else {
+						data.insert( data.begin() + pos, 'a' );
+					}
+				},
+				iterations
+			)
+		);
+		report( "editbuffer", "vector insert/erase", ns );
+	}
+
+	/* EditBuffer, type near the start of 100K line */ {
+		EditBuffer data;
+		data.assign( UnicodeString( std::string( size, 'x' ) ) );
+		double ns(
+			measure(
+				[&]( int i ) {
+					if ( i & 1 ) {
+						data.erase( pos );
+					} else {
+						data.insert( pos, 'a' );
+					}
+				},
+				iterations
+			)
+		);
+		report( "editbuffer", "EditBuffer insert/erase", ns );
+	}
+
+	/* UTF-8 text for callbacks after each key typed at the end of 10K line */ {
+		int const lineSize( 10000 );
+		int const keys( 20000 );
+		UnicodeString data( std::string( lineSize, 'x' ) );
+		Utf8String utf8;
+		size_t sum( 0 );
+		double ns(
+			measure(
+				[&]( int i ) {
+					if ( i & 1 ) {
+						data.erase( data.length() - 1 );
+					} else {
+						data.insert( data.length(), U'\u017c' );
+					}
+					utf8.assign( data );
+					sum += static_cast<size_t>( utf8.get()[0] );
+				},
+				keys
+			)
+		);
+		report( "editbuffer", "re-encode whole line", ns );
+		EditBuffer buffer;
+		buffer.assign( std::string( lineSize, 'x' ) );
+		ns = measure(
+			[&]( int i ) {
+				if ( i & 1 ) {
+					buffer.erase( buffer.length() - 1 );
+				} else {
+					buffer.insert( buffer.length(), U'\u017c' );
+				}
+				sum += static_cast<size_t>( buffer.utf8()[0] );
+			},
+			keys
+		);
+		report( "editbuffer", "incremental UTF-8 mirror", ns );
+		if ( sum == 1 ) {
+			printf( "\n" );
+		}
+	}
+
+	/* Cost of an edit (text and its UTF-8 copy) in the middle of growing lines, should stay flat */ {
+		int const sizes[] = { 1000, 10000, 100000, 1000000 };
+		for ( int lineSize : sizes ) {
+			EditBuffer buffer;
+			buffer.assign( std::string( lineSize, 'x' ) );
+			int mid( lineSize / 2 );
+			double ns(
+				measure(
+					[&]( int i ) {
+						if ( i & 1 ) {
+							buffer.erase( mid );
+						} else {
+							buffer.insert( mid, U'\u017c' );
+						}
+					},
+					iterations
+				)
+			);
+			char name[64];
+			snprintf( name, sizeof ( name ), "edit mid-line, %d chars", lineSize );
+			report( "editbuffer", name, ns );
+		}
+	}
+}
+
+}
+
+}
+
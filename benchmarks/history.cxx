@@ -0,0 +1,87 @@
+#include <vector>
+#include <string>
+#include <cstdio>
+
+#include "bench.hxx"
+#include "history.hxx"
+#include "replxx.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+int const ENTRY_COUNT = 1000000;
+char const HISTORY_FILE[] = "replxx-bench-history.txt";
+
+std::string entry( int i_ ) {
+	char buf[64];
+	snprintf( buf, sizeof ( buf ), "select * from table_%d where id = %d;", i_ % 1000, i_ );
+	return ( buf );
+}
+
+}
+
+void history( void ) {
+	// Oldest entry is the only one matching searches below, so every search scans whole history.
+	std::string const needle( "zyx needle" );
+	{
+		History h;
+		h.set_max_size( ENTRY_COUNT );
+		std::vector<std::string> lines;
+		lines.reserve( ENTRY_COUNT );
+		lines.push_back( needle );
+		for ( int i( 1 ); i < ENTRY_COUNT; ++ i ) {
+			lines.push_back( entry( i ) );
+		}
+		report( "history", "add 1M (per entry)", measure( [&]( int i ) { h.add( lines[i] ); }, ENTRY_COUNT ) );
+		// search before adding to full history, that evicts the needle
+		// typed prefix, search skips entries equal to it
+		std::string const prefix( needle, 0, 3 );
+		bool matched( false );
+		report( "history", "prefix search 1M", measure( [&]( int ) { h.reset_pos(); matched = h.common_prefix_search( prefix, 3, true ); }, 20 ) );
+		if ( ! matched ) {
+			fprintf( stderr, "history: prefix search did not find the oldest entry\n" );
+		}
+		report( "history", "add to full 1M (per entry)", measure( [&]( int i ) { h.add( entry( ENTRY_COUNT + i ) ); }, 100 ) );
+		report( "history", "save 1M (per entry)", measure( [&]( int ) { h.save( HISTORY_FILE ); }, 1 ) / ENTRY_COUNT );
+		History loaded;
+		loaded.set_max_size( ENTRY_COUNT );
+		report( "history", "load 1M (per entry)", measure( [&]( int ) { loaded.load( HISTORY_FILE ); }, 1 ) / ENTRY_COUNT );
+		if ( loaded.size() != h.size() ) {
+			fprintf( stderr, "history: loaded %d of %d entries\n", loaded.size(), h.size() );
+		}
+		std::remove( HISTORY_FILE );
+	}
+
+	Replxx rx;
+	Replxx::VirtualTerminal terminal( 80, 24 );
+	rx.set_terminal( &terminal );
+	rx.set_max_history_size( ENTRY_COUNT + 1 );
+	rx.history_add( needle );
+	for ( int i( 1 ); i < ENTRY_COUNT; ++ i ) {
+		rx.history_add( entry( i ) );
+	}
+	int found( 0 );
+	double ns( measure(
+		[&]( int ) {
+			terminal.feed( "\022zyx\r" ); // ctrl-R, search, accept
+			char const* line( rx.input( "replxx> " ) );
+			if ( line && ( needle == line ) ) {
+				++ found;
+			}
+		},
+		10
+	) );
+	report( "history", "incremental search 1M", ns );
+	if ( found != 10 ) {
+		fprintf( stderr, "history: incremental search found %d of 10 lines\n", found );
+	}
+	rx.set_terminal( nullptr );
+}
+
+}
+
+}
+
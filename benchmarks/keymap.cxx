@@ -0,0 +1,143 @@
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <random>
+
+#include "bench.hxx"
+#include "keymap.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+// Stand-in for ReplxxImpl, each action just accumulates the key code.
+class Editor {
+public:
+	typedef Replxx::ACTION_RESULT ( Editor::* action_t )( char32_t );
+	int long _sum;
+	Editor( void )
+		: _sum( 0 ) {
+	}
+	template<int N>
+	Replxx::ACTION_RESULT action( char32_t c ) {
+		_sum += static_cast<int long>( c ) * N;
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	Replxx::ACTION_RESULT insert_character( char32_t c ) {
+		_sum -= static_cast<int long>( c );
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+};
+
+typedef std::vector<char32_t> keys_t;
+
+// Default key bindings of ReplxxImpl.
+keys_t bound_keys( void ) {
+	keys_t keys;
+	for ( char32_t c( 'A' ); c <= 'Z'; ++ c ) {
+		keys.push_back( Replxx::KEY::control( c ) );
+	}
+	for ( char const* c( "bBfFdDyYcClLuUpPnN<>" ); *c; ++ c ) {
+		keys.push_back( Replxx::KEY::meta( static_cast<char32_t>( *c ) ) );
+	}
+	char32_t const special[] = {
+		Replxx::KEY::HOME, Replxx::KEY::END, Replxx::KEY::LEFT, Replxx::KEY::RIGHT,
+		Replxx::KEY::UP, Replxx::KEY::DOWN, Replxx::KEY::PAGE_UP, Replxx::KEY::PAGE_DOWN,
+		Replxx::KEY::DELETE, 127,
+		Replxx::KEY::control( Replxx::KEY::LEFT ), Replxx::KEY::control( Replxx::KEY::RIGHT ),
+		Replxx::KEY::control( Replxx::KEY::UP ), Replxx::KEY::control( Replxx::KEY::DOWN ),
+		Replxx::KEY::meta( Replxx::KEY::LEFT ), Replxx::KEY::meta( Replxx::KEY::RIGHT ),
+		Replxx::KEY::meta( Replxx::KEY::BACKSPACE )
+	};
+	keys.insert( keys.end(), std::begin( special ), std::end( special ) );
+	return ( keys );
+}
+
+// Typical input, mostly printable characters with some editing keys.
+keys_t input_keys( keys_t const& bound_ ) {
+	std::mt19937 rng( 0 );
+	std::uniform_int_distribution<int> printable( ' ', '~' );
+	std::uniform_int_distribution<int> pick( 0, static_cast<int>( bound_.size() ) - 1 );
+	std::uniform_int_distribution<int> ratio( 0, 3 );
+	keys_t keys;
+	for ( int i( 0 ); i < 4096; ++ i ) {
+		keys.push_back( ratio( rng ) == 0 ? bound_[pick( rng )] : static_cast<char32_t>( printable( rng ) ) );
+	}
+	return ( keys );
+}
+
+template<int N>
+void add_action( std::vector<Editor::action_t>& actions_ ) {
+	actions_.push_back( &Editor::action<N> );
+}
+
+}
+
+void keymap( void ) {
+	int const iterations( 20000000 );
+	keys_t bound( bound_keys() );
+	keys_t keys( input_keys( bound ) );
+	std::vector<Editor::action_t> actions;
+	add_action<1>( actions ); add_action<2>( actions ); add_action<3>( actions ); add_action<4>( actions );
+	add_action<5>( actions ); add_action<6>( actions ); add_action<7>( actions ); add_action<8>( actions );
+
+	/* unordered_map<int, std::function> with std::bind thunks */ {
+		Editor editor;
+		typedef std::unordered_map<int, std::function<Replxx::ACTION_RESULT ( char32_t )>> handlers_t;
+		handlers_t handlers;
+		for ( size_t i( 0 ); i < bound.size(); ++ i ) {
+			handlers[bound[i]] = std::bind( actions[i % actions.size()], &editor, std::placeholders::_1 );
+		}
+		double ns(
+			measure(
+				[&]( int i ) {
+					char32_t c( keys[static_cast<size_t>( i ) & ( keys.size() - 1 )] );
+					handlers_t::iterator it( handlers.find( static_cast<int>( c ) ) );
+					if ( it != handlers.end() ) {
+						it->second( c );
+					} else {
+						editor.insert_character( c );
+					}
+				},
+				iterations
+			)
+		);
+		report( "keymap", "unordered_map+std::function", ns );
+		if ( editor._sum == 1 ) {
+			printf( "\n" );
+		}
+	}
+
+	/* KeyMap with direct member function calls */ {
+		Editor editor;
+		KeyMap keyMap;
+		for ( size_t i( 0 ); i < bound.size(); ++ i ) {
+			keyMap.set( bound[i], static_cast<int>( i % actions.size() ) + 1 );
+		}
+		double ns(
+			measure(
+				[&]( int i ) {
+					char32_t c( keys[static_cast<size_t>( i ) & ( keys.size() - 1 )] );
+					int id( keyMap.find( c ) );
+					if ( id != KeyMap::NONE ) {
+						( editor.*actions[static_cast<size_t>( id - 1 )] )( c );
+					} else {
+						editor.insert_character( c );
+					}
+				},
+				iterations
+			)
+		);
+		report( "keymap", "KeyMap+member function", ns );
+		if ( editor._sum == 1 ) {
+			printf( "\n" );
+		}
+	}
+}
+
+}
+
+}
+
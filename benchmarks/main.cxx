@@ -0,0 +1,184 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <new>
+
+#include "bench.hxx"
+
+namespace {
+
+int long allocationCount( 0 );
+
+enum class FORMAT {
+	TEXT,
+	CSV,
+	JSON
+};
+
+FORMAT format( FORMAT::TEXT );
+bool failed( false );
+
+}
+
+// Counting allocator, every benchmark can report heap allocations it made.
+void* operator new( std::size_t size_ ) {
+	++ allocationCount;
+	void* p( malloc( size_ > 0 ? size_ : 1 ) );
+	if ( ! p ) {
+		throw std::bad_alloc();
+	}
+	return ( p );
+}
+
+void* operator new[]( std::size_t size_ ) {
+	return ( operator new( size_ ) );
+}
+
+void operator delete( void* p_ ) noexcept {
+	free( p_ );
+}
+
+void operator delete[]( void* p_ ) noexcept {
+	free( p_ );
+}
+
+void operator delete( void* p_, std::size_t ) noexcept {
+	free( p_ );
+}
+
+void operator delete[]( void* p_, std::size_t ) noexcept {
+	free( p_ );
+}
+
+namespace replxx {
+
+namespace bench {
+
+int long allocation_count( void ) {
+	return ( allocationCount );
+}
+
+namespace {
+
+// Benchmark names are plain ASCII, only quotes and backslashes need escaping.
+void print_quoted( char const* str_, char escape_ ) {
+	putchar( '"' );
+	for ( ; *str_; ++ str_ ) {
+		if ( ( *str_ == '"' ) || ( *str_ == '\\' ) ) {
+			putchar( escape_ == '"' ? '"' : '\\' );
+		}
+		putchar( *str_ );
+	}
+	putchar( '"' );
+}
+
+}
+
+void report( char const* group_, char const* name_, double value_, char const* unit_ ) {
+	switch ( format ) {
+		case ( FORMAT::TEXT ): {
+			printf( "%-13s %-32s %10.2f %s\n", group_, name_, value_, unit_ );
+		} break;
+		case ( FORMAT::CSV ): {
+			printf( "%s,", group_ );
+			print_quoted( name_, '"' );
+			printf( ",%.2f,%s\n", value_, unit_ );
+		} break;
+		case ( FORMAT::JSON ): {
+			printf( "{\"group\": \"%s\", \"name\": ", group_ );
+			print_quoted( name_, '\\' );
+			printf( ", \"value\": %.2f, \"unit\": \"%s\"}\n", value_, unit_ );
+		} break;
+	}
+	fflush( stdout );
+}
+
+void fail( char const* group_, char const* message_ ) {
+	fprintf( stderr, "%s: %s\n", group_, message_ );
+	failed = true;
+}
+
+}
+
+}
+
+namespace {
+
+struct Benchmark {
+	char const* name;
+	void (*run)( void );
+	void (*check)( void ); // correctness checks run with --check, if group has any
+};
+
+Benchmark const benchmarks[] = {
+	{ "keymap", &replxx::bench::keymap, nullptr },
+	{ "editbuffer", &replxx::bench::editbuffer, nullptr },
+	{ "candidates", &replxx::bench::candidates, nullptr },
+	{ "conversion", &replxx::bench::conversion, &replxx::bench::conversion_check },
+	{ "unicodestring", &replxx::bench::unicodestring, &replxx::bench::unicodestring_check },
+	{ "width", &replxx::bench::width, nullptr },
+	{ "history", &replxx::bench::history, nullptr },
+	{ "terminal", &replxx::bench::terminal, nullptr }
+};
+
+int usage( char const* self_ ) {
+	fprintf( stderr, "Usage: %s [--format=text|csv|json] [--check] [group...]\nGroups:", self_ );
+	for ( Benchmark const& b : benchmarks ) {
+		fprintf( stderr, " %s", b.name );
+	}
+	fprintf( stderr, "\n" );
+	return ( 1 );
+}
+
+}
+
+// replxx-bench [--format=text|csv|json] [--check] [group...]
+// Every result is a single line on stdout, csv and json (one object per line)
+// formats are meant for tracking regressions between builds.
+// With --check correctness checks of selected groups are run instead of timings,
+// exit status tells if all of them passed.
+int main( int argc_, char** argv_ ) {
+	int groupCount( 0 );
+	bool check( false );
+	for ( int i( 1 ); i < argc_; ++ i ) {
+		char const* arg( argv_[i] );
+		if ( strcmp( arg, "--check" ) == 0 ) {
+			check = true;
+		} else if ( strcmp( arg, "--format=text" ) == 0 ) {
+			format = FORMAT::TEXT;
+		} else if ( strcmp( arg, "--format=csv" ) == 0 ) {
+			format = FORMAT::CSV;
+		} else if ( strcmp( arg, "--format=json" ) == 0 ) {
+			format = FORMAT::JSON;
+		} else if ( arg[0] == '-' ) {
+			return ( usage( argv_[0] ) );
+		} else {
+			bool known( false );
+			for ( Benchmark const& b : benchmarks ) {
+				known = known || ( strcmp( arg, b.name ) == 0 );
+			}
+			if ( ! known ) {
+				return ( usage( argv_[0] ) );
+			}
+			++ groupCount;
+		}
+	}
+	if ( format == FORMAT::CSV ) {
+		printf( "group,name,value,unit\n" );
+	}
+	for ( Benchmark const& b : benchmarks ) {
+		bool selected( groupCount == 0 );
+		for ( int i( 1 ); ! selected && ( i < argc_ ); ++ i ) {
+			selected = strcmp( argv_[i], b.name ) == 0;
+		}
+		if ( ! selected ) {
+			continue;
+		}
+		if ( ! check ) {
+			b.run();
+		} else if ( b.check ) {
+			b.check();
+		}
+	}
+	return ( failed ? 1 : 0 );
+}
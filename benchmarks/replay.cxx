@@ -0,0 +1,248 @@
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "replxx.hxx"
+#include "session.hxx"
+
+using namespace replxx;
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+// Feeds recorded session to replxx and measures how long replxx takes
+// to process each input chunk and how many bytes it emits in response.
+class ReplayBackend : public Replxx::TerminalBackend {
+public:
+	struct Sample {
+		int input;
+		int long long latency; // nanoseconds
+		int long long output;
+	};
+private:
+	std::vector<SessionReader::Event> const& _events;
+	bool _realtime;
+	Replxx::VirtualTerminal _screen;
+	size_t _next;
+	size_t _offset; // part of last event already delivered
+	clock_type::time_point _due;
+	bool _pending;
+	clock_type::time_point _deliveredAt;
+	int long long _writtenAt;
+	std::vector<Sample> _samples;
+	std::thread _notifier; // wakes replxx up when recorded input is due in realtime replay
+public:
+	ReplayBackend( std::vector<SessionReader::Event> const& events_, bool realtime_ )
+		: _events( events_ )
+		, _realtime( realtime_ )
+		, _screen( 80, 24 )
+		, _next( 0 )
+		, _offset( 0 )
+		, _due( clock_type::now() )
+		, _pending( false )
+		, _deliveredAt()
+		, _writtenAt( 0 )
+		, _samples()
+		, _notifier() {
+		// screen starts with the size recorded first
+		while ( ( _next < _events.size() ) && ( _events[_next].type == SessionReader::Event::TYPE::RESIZE ) ) {
+			_screen.resize( _events[_next].columns, _events[_next].rows );
+			++ _next;
+		}
+		if ( _realtime ) {
+			_notifier = std::thread( &ReplayBackend::notify_due, this, _next, _due );
+		}
+	}
+	~ReplayBackend( void ) {
+		join();
+	}
+	void join( void ) {
+		if ( _notifier.joinable() ) {
+			_notifier.join();
+		}
+	}
+	int read( char* data_, int size_ ) override {
+		finish_sample();
+		if ( _offset == 0 ) {
+			if ( _next == _events.size() ) {
+				return ( 0 );
+			}
+			SessionReader::Event const& event( _events[_next] );
+			++ _next;
+			if ( _realtime ) {
+				_due += std::chrono::microseconds( event.delay );
+				std::this_thread::sleep_until( _due );
+			}
+			if ( event.type == SessionReader::Event::TYPE::RESIZE ) {
+				_screen.resize( event.columns, event.rows );
+				errno = EINTR;
+				return ( -1 );
+			}
+		}
+		std::string const& data( _events[_next - 1].data );
+		int size( std::min( static_cast<int>( data.length() - _offset ), size_ ) );
+		memcpy( data_, data.data() + _offset, static_cast<size_t>( size ) );
+		_offset += static_cast<size_t>( size );
+		if ( _offset == data.length() ) {
+			_offset = 0;
+		}
+		_pending = true;
+		_deliveredAt = clock_type::now();
+		_writtenAt = _screen.bytes_written();
+		_samples.push_back( Sample{ size, 0, 0 } );
+		return ( size );
+	}
+	int write( char const* data_, int size_ ) override {
+		return ( _screen.write( data_, size_ ) );
+	}
+	bool input_ready( void ) override {
+		finish_sample();
+		return ( ! _realtime || ( _offset > 0 ) || ( _next == _events.size() ) || ( clock_type::now() >= _due + std::chrono::microseconds( _events[_next].delay ) ) );
+	}
+	int screen_columns( void ) override {
+		return ( _screen.columns() );
+	}
+	int screen_rows( void ) override {
+		return ( _screen.rows() );
+	}
+	int enable_raw_mode( void ) override {
+		return ( 0 );
+	}
+	void disable_raw_mode( void ) override {
+	}
+	// Close measurement of last delivered chunk, replxx checks for or asks for more input
+	// only after it has processed everything it got.
+	void finish_sample( void ) {
+		if ( _pending ) {
+			_samples.back().latency = std::chrono::duration_cast<std::chrono::nanoseconds>( clock_type::now() - _deliveredAt ).count();
+			_samples.back().output = _screen.bytes_written() - _writtenAt;
+			_pending = false;
+		}
+	}
+	std::vector<Sample> const& samples( void ) const {
+		return ( _samples );
+	}
+private:
+	// Same schedule read() follows, replxx is told about every event once it is due.
+	void notify_due( size_t next_, clock_type::time_point due_ ) {
+		for ( ; next_ < _events.size(); ++ next_ ) {
+			due_ += std::chrono::microseconds( _events[next_].delay );
+			std::this_thread::sleep_until( due_ );
+			notify_input();
+		}
+	}
+};
+
+// Color every word of the input, so replays can include highlighting cost.
+void highlight_words( std::string const& input_, Replxx::colors_t& colors_ ) {
+	Replxx::Color const palette[] = { Replxx::Color::BRIGHTGREEN, Replxx::Color::YELLOW, Replxx::Color::BRIGHTBLUE };
+	int word( 0 );
+	int size( std::min( static_cast<int>( colors_.size() ), static_cast<int>( input_.length() ) ) );
+	for ( int i( 0 ); i < size; ++ i ) {
+		if ( input_[i] == ' ' ) {
+			++ word;
+		} else {
+			colors_[i] = palette[word % 3];
+		}
+	}
+}
+
+int long long percentile( std::vector<int long long> sorted_, double p_ ) {
+	if ( sorted_.empty() ) {
+		return ( 0 );
+	}
+	size_t rank( static_cast<size_t>( p_ * static_cast<double>( sorted_.size() - 1 ) / 100.0 + 0.5 ) );
+	return ( sorted_[rank] );
+}
+
+int usage( char const* self_ ) {
+	fprintf( stderr, "Usage: %s [--realtime] [--highlight] [--events] session-file\n", self_ );
+	return ( 1 );
+}
+
+}
+
+// replxx-replay [--realtime] [--highlight] [--events] session-file
+//
+// Replays session recorded with Replxx::set_session_recording() on a virtual terminal,
+// at maximum speed unless --realtime is given, and reports per input chunk
+// (usually a single key press) processing latency and number of bytes emitted.
+int main( int argc_, char** argv_ ) {
+	bool realtime( false );
+	bool highlight( false );
+	bool events( false );
+	char const* path( nullptr );
+	for ( int i( 1 ); i < argc_; ++ i ) {
+		if ( strcmp( argv_[i], "--realtime" ) == 0 ) {
+			realtime = true;
+		} else if ( strcmp( argv_[i], "--highlight" ) == 0 ) {
+			highlight = true;
+		} else if ( strcmp( argv_[i], "--events" ) == 0 ) {
+			events = true;
+		} else if ( ( argv_[i][0] == '-' ) || path ) {
+			return ( usage( argv_[0] ) );
+		} else {
+			path = argv_[i];
+		}
+	}
+	if ( ! path ) {
+		return ( usage( argv_[0] ) );
+	}
+	SessionReader reader;
+	if ( reader.open( path ) != 0 ) {
+		fprintf( stderr, "%s: not a replxx session file\n", path );
+		return ( 1 );
+	}
+	std::vector<SessionReader::Event> session;
+	SessionReader::Event event;
+	while ( reader.next( event ) ) {
+		session.push_back( event );
+	}
+
+	ReplayBackend backend( session, realtime );
+	Replxx rx;
+	if ( rx.set_terminal( &backend ) != 0 ) {
+		fprintf( stderr, "replay is not supported on this platform\n" );
+		return ( 1 );
+	}
+	rx.set_latency_instrumentation( true );
+	if ( highlight ) {
+		rx.set_highlighter_callback( &highlight_words );
+	}
+	int lines( 0 );
+	while ( rx.input( "replxx> " ) ) {
+		++ lines;
+	}
+	backend.finish_sample();
+	backend.join();
+	rx.set_terminal( nullptr );
+
+	std::vector<ReplayBackend::Sample> const& samples( backend.samples() );
+	if ( events ) {
+		printf( "chunk,input bytes,latency ns,output bytes\n" );
+		for ( size_t i( 0 ); i < samples.size(); ++ i ) {
+			printf( "%zu,%d,%lld,%lld\n", i, samples[i].input, samples[i].latency, samples[i].output );
+		}
+		return ( 0 );
+	}
+	std::vector<int long long> latencies;
+	int long long output( 0 );
+	for ( ReplayBackend::Sample const& s : samples ) {
+		latencies.push_back( s.latency );
+		output += s.output;
+	}
+	std::sort( latencies.begin(), latencies.end() );
+	printf(
+		"chunks %zu, lines %d, latency p50 %lld ns, p99 %lld ns, max %lld ns, output %lld bytes\n\n%s",
+		samples.size(), lines, percentile( latencies, 50 ), percentile( latencies, 99 ),
+		latencies.empty() ? 0 : latencies.back(), output, rx.latency_report().c_str()
+	);
+	return ( 0 );
+}
+
@@ -0,0 +1,118 @@
+#include <string>
+#include <cstdio>
+
+#include "bench.hxx"
+#include "replxx.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+int const LINE_COUNT = 2000;
+
+// Type given keys as lineCount_ lines into rx_ running on a virtual terminal.
+// Returns time per key, terminal output per key is stored in bytesPerKey_.
+double session( Replxx& rx_, std::string const& keys_, int keysPerLine_, double* bytesPerKey_ = nullptr, int lineCount_ = LINE_COUNT ) {
+	Replxx::VirtualTerminal terminal( 200, 50 );
+	rx_.set_terminal( &terminal );
+	int lines( 0 );
+	double nsPerLine( measure(
+		[&]( int ) {
+			terminal.feed( keys_ );
+			if ( rx_.input( "replxx> " ) ) {
+				++ lines;
+			}
+		},
+		lineCount_
+	) );
+	if ( lines != lineCount_ ) {
+		fprintf( stderr, "session: only %d of %d lines accepted\n", lines, lineCount_ );
+	}
+	if ( bytesPerKey_ ) {
+		*bytesPerKey_ = static_cast<double>( terminal.bytes_written() ) / lineCount_ / keysPerLine_;
+	}
+	rx_.set_terminal( nullptr );
+	return ( nsPerLine / keysPerLine_ );
+}
+
+double session( std::string const& keys_, int keysPerLine_, bool instrumented_ = false ) {
+	Replxx rx;
+	rx.set_latency_instrumentation( instrumented_ );
+	return ( session( rx, keys_, keysPerLine_ ) );
+}
+
+// Color every word of the input, similar to syntax highlighting in real applications.
+void highlight_words( std::string const& input_, Replxx::colors_t& colors_ ) {
+	Replxx::Color const palette[] = { Replxx::Color::BRIGHTGREEN, Replxx::Color::YELLOW, Replxx::Color::BRIGHTBLUE };
+	int word( 0 );
+	int size( static_cast<int>( colors_.size() ) );
+	for ( int i( 0 ); ( i < size ) && ( i < static_cast<int>( input_.length() ) ); ++ i ) {
+		if ( input_[i] == ' ' ) {
+			++ word;
+		} else {
+			colors_[i] = palette[word % 3];
+		}
+	}
+}
+
+}
+
+void terminal( void ) {
+	std::string typing( 60, 'x' );
+	typing.push_back( '\r' );
+	report( "terminal", "type 60 keys + enter (per key)", session( typing, 61 ) );
+	report( "terminal", "type, instrumented (per key)", session( typing, 61, true ) );
+
+	std::string editing;
+	for ( int i( 0 ); i < 20; ++ i ) {
+		editing.append( "ab\033[Dc" ); // type, move left, insert
+	}
+	editing.append( "\001\005\r" );    // home, end, enter
+	report( "terminal", "edit with cursor keys (per key)", session( editing, 20 * 4 + 3 ) );
+
+	std::string longLine;
+	while ( longLine.length() < 400 ) {
+		longLine.append( "word " );
+	}
+	longLine.push_back( '\r' );
+	int longLineKeys( static_cast<int>( longLine.length() ) );
+	double bytes( 0 );
+	{
+		Replxx rx;
+		rx.set_highlighter_callback( &highlight_words );
+		double ns( session( rx, longLine, longLineKeys, &bytes, 100 ) );
+		report( "terminal", "type highlighted 400 (per key)", ns );
+		report_bytes( "terminal", "type highlighted 400 (per key)", bytes );
+	}
+
+	{
+		Replxx rx;
+		rx.set_completion_count_cutoff( 1000 );
+		Replxx::completions_t items;
+		char buf[32];
+		for ( int i( 0 ); i < 300; ++ i ) {
+			snprintf( buf, sizeof ( buf ), "cmd_%d", i * 7 );
+			items.emplace_back( buf );
+		}
+		rx.set_completion_callback( [&items]( std::string const&, int& ) { return ( items ); } );
+		double ns( session( rx, "cmd_\t\r", 6, &bytes, 500 ) * 6 );
+		report( "terminal", "list 300 completions", ns );
+		report_bytes( "terminal", "list 300 completions", bytes * 6 );
+	}
+
+	Replxx::VirtualTerminal terminal( 80, 24 );
+	std::string output;
+	for ( int i( 0 ); i < 24; ++ i ) {
+		output.append( "\033[0;1;92mreplxx\033[0m> some \033[0;22;33mtext\033[0m to draw\033[K\r\n" );
+	}
+	int size( static_cast<int>( output.length() ) );
+	double ns( measure( [&]( int ) { terminal.write( output.data(), size ); }, 10000 ) );
+	report( "terminal", "emulate output (per byte)", ns / size );
+}
+
+}
+
+}
+
@@ -0,0 +1,257 @@
+#include <vector>
+#include <string>
+
+#include "bench.hxx"
+#include "unicodestring.hxx"
+#include "candidates.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+// UnicodeString as it was before inline storage was added.
+typedef std::vector<char32_t> vector_string_t;
+
+vector_string_t vector_string( char const* str_ ) {
+	int byteCount( static_cast<int>( strlen( str_ ) ) );
+	vector_string_t s( byteCount );
+	int len( 0 );
+	copyString8to32( s.data(), byteCount, len, str_ );
+	s.resize( len );
+	return ( s );
+}
+
+template<typename func_t>
+void run( char const* name_, func_t f_, int iterations_ ) {
+	report( "unicodestring", name_, measure( f_, iterations_ ) );
+	report_allocations( "unicodestring", name_, count_allocations( f_, iterations_ ) );
+}
+
+// Text of len_ characters, different seeds_ give different texts.
+std::u32string sample( int len_, char32_t seed_ ) {
+	std::u32string s;
+	for ( int i( 0 ); i < len_; ++ i ) {
+		s.push_back( 'a' + ( seed_ + static_cast<char32_t>( i ) ) % 26 );
+	}
+	return ( s );
+}
+
+UnicodeString make( std::u32string const& text_ ) {
+	return ( UnicodeString( text_.data(), static_cast<int>( text_.length() ) ) );
+}
+
+bool same( UnicodeString const& s_, std::u32string const& text_ ) {
+	return ( ( s_.length() == static_cast<int>( text_.length() ) ) && std::equal( s_.begin(), s_.end(), text_.begin() ) );
+}
+
+// Counts failed expectations of a check.
+class Expect {
+	char const* _check;
+	int _failures;
+public:
+	Expect( char const* check_ )
+		: _check( check_ )
+		, _failures( 0 ) {
+	}
+	void operator()( bool ok_, char const* what_, int len_, int otherLen_ = -1 ) {
+		if ( ok_ ) {
+			return;
+		}
+		++ _failures;
+		char message[256];
+		snprintf( message, sizeof ( message ), "%s: %s, lengths %d and %d", _check, what_, len_, otherLen_ );
+		fail( "unicodestring", message );
+	}
+	int failures( void ) const {
+		return ( _failures );
+	}
+};
+
+}
+
+void unicodestring( void ) {
+	int const iterations( 200000 );
+	char const* const hintWords[] = { "print", "printf", "println", "print_hints" };
+	char const* const color( "\033[0;22;35m" );
+	int volatile sink( 0 );
+
+	run(
+		"vector from utf8",
+		[&]( int ) {
+			vector_string_t s( vector_string( hintWords[3] ) );
+			sink = sink + static_cast<int>( s.size() );
+		},
+		iterations
+	);
+	run(
+		"sso from utf8",
+		[&]( int ) {
+			UnicodeString s( hintWords[3] );
+			sink = sink + s.length();
+		},
+		iterations
+	);
+
+	vector_string_t const vectorSample( vector_string( hintWords[2] ) );
+	UnicodeString const ssoSample( hintWords[2] );
+	run(
+		"vector copy",
+		[&]( int ) {
+			vector_string_t s( vectorSample );
+			sink = sink + static_cast<int>( s.size() );
+		},
+		iterations
+	);
+	run(
+		"sso copy",
+		[&]( int ) {
+			UnicodeString s( ssoSample );
+			sink = sink + s.length();
+		},
+		iterations
+	);
+
+	/* incremental search, search text typed in one character at a time */
+	run(
+		"vector type 12 chars",
+		[&]( int ) {
+			vector_string_t s;
+			for ( char32_t c( 'a' ); c < 'a' + 12; ++ c ) {
+				s.push_back( c );
+			}
+			sink = sink + static_cast<int>( s.size() );
+		},
+		iterations
+	);
+	run(
+		"sso type 12 chars",
+		[&]( int ) {
+			UnicodeString s;
+			for ( char32_t c( 'a' ); c < 'a' + 12; ++ c ) {
+				s.insert( s.length(), c );
+			}
+			sink = sink + s.length();
+		},
+		iterations
+	);
+
+	/* string work done on a keystroke with 4 hints displayed */
+	run(
+		"vector keystroke, 4 hints",
+		[&]( int ) {
+			std::vector<std::string> hints( std::begin( hintWords ), std::end( hintWords ) );
+			std::vector<vector_string_t> decoded;
+			decoded.reserve( hints.size() );
+			for ( std::string const& h : hints ) {
+				decoded.emplace_back( vector_string( h.c_str() ) );
+			}
+			vector_string_t hint( decoded[0] );
+			vector_string_t col( vector_string( color ) );
+			sink = sink + static_cast<int>( hint.size() + col.size() );
+		},
+		iterations
+	);
+	CandidateList hints; // kept by ReplxxImpl across keystrokes
+	run(
+		"sso keystroke, 4 hints",
+		[&]( int ) {
+			Replxx::Candidates& out( hints.sink() );
+			for ( char const* h : hintWords ) {
+				out.add( h );
+			}
+			for ( int i( 0 ); i < hints.size(); ++ i ) {
+				sink = sink + hints[i].length();
+			}
+			UnicodeString hint( hints[0] );
+			UnicodeString col( color );
+			sink = sink + hint.length() + col.length();
+		},
+		iterations
+	);
+}
+
+// Inline storage must be transparent: content survives every copy, move, assignment
+// and edit that crosses inline capacity, in either direction, and only strings
+// longer than inline capacity allocate.
+void unicodestring_check( void ) {
+	int const cap( UnicodeString::INLINE_CAPACITY );
+	int const lengths[] = { 0, 1, cap - 1, cap, cap + 1, 2 * cap + 3 };
+	Expect expect( "sso" );
+	for ( int len : lengths ) {
+		std::u32string const text( sample( len, 0 ) );
+		double allocs( count_allocations( [&]( int ) { UnicodeString s( make( text ) ); }, 1 ) );
+		expect( allocs == ( len > cap ? 1 : 0 ), "allocations on construction", len );
+		UnicodeString src( make( text ) );
+		allocs = count_allocations( [&]( int ) { UnicodeString moved( std::move( src ) ); src = std::move( moved ); }, 1 );
+		expect( allocs == 0, "allocations on move", len );
+
+		UnicodeString copy( src );
+		expect( same( copy, text ) && same( src, text ), "copy construction", len );
+		if ( len > 0 ) {
+			copy[0] = 'X';
+			expect( same( src, text ), "copy shares storage", len );
+		}
+		UnicodeString moved( std::move( src ) );
+		expect( same( moved, text ) && ( src.length() == 0 ), "move construction", len );
+		src.append( moved );
+		expect( same( src, text ), "reuse after move", len );
+
+		for ( int otherLen : lengths ) {
+			std::u32string const other( sample( otherLen, 7 ) );
+			UnicodeString a( make( text ) );
+			UnicodeString b( make( other ) );
+			a = b;
+			expect( same( a, other ) && same( b, other ), "copy assignment", len, otherLen );
+			a.insert( 0, 'X' );
+			expect( same( b, other ), "copy assignment shares storage", len, otherLen );
+			a = make( text );
+			a = std::move( b );
+			expect( same( a, other ) && ( b.length() == 0 ), "move assignment", len, otherLen );
+			b.append( a );
+			expect( same( b, other ), "reuse after move assignment", len, otherLen );
+			a = make( text );
+			a.swap( b );
+			expect( same( a, other ) && same( b, text ), "swap", len, otherLen );
+			UnicodeString utf8( make( text ) );
+			utf8.assign( std::string( other.begin(), other.end() ) );
+			expect( same( utf8, other ), "UTF-8 assignment", len, otherLen );
+		}
+
+		UnicodeString self( make( text ) );
+		UnicodeString& alias( self );
+		self = alias;
+		expect( same( self, text ), "self copy assignment", len );
+		self = std::move( alias );
+		expect( same( self, text ), "self move assignment", len );
+		// text inserted from the string itself while it grows past inline capacity
+		self.insert( len / 2, self.get(), len );
+		std::u32string doubled( text );
+		doubled.insert( static_cast<size_t>( len / 2 ), text );
+		expect( same( self, doubled ), "insert from itself", len );
+	}
+
+	// grow one character at a time across inline capacity, then shrink back
+	UnicodeString s;
+	std::u32string ref;
+	for ( int i( 0 ); i < 2 * cap + 3; ++ i ) {
+		char32_t c( 'a' + static_cast<char32_t>( i % 26 ) );
+		int pos( i % 3 == 0 ? 0 : s.length() / 2 );
+		s.insert( pos, c );
+		ref.insert( static_cast<size_t>( pos ), 1, c );
+		expect( same( s, ref ), "insert", s.length() );
+	}
+	while ( s.length() > 0 ) {
+		int pos( s.length() / 3 );
+		s.erase( pos );
+		ref.erase( static_cast<size_t>( pos ), 1 );
+		expect( same( s, ref ), "erase", s.length() );
+	}
+	report( "unicodestring", "check sso", expect.failures(), "failures" );
+}
+
+}
+
+}
+
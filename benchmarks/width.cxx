@@ -0,0 +1,61 @@
+#include <vector>
+#include <string>
+
+#include "bench.hxx"
+#include "util.hxx"
+#include "unicodestring.hxx"
+
+namespace replxx {
+
+namespace bench {
+
+namespace {
+
+int const SIZE = 4096;
+
+UnicodeString make_line( char const* chunk_ ) {
+	std::string line;
+	while ( static_cast<int>( line.length() ) < SIZE ) {
+		line.append( chunk_ );
+	}
+	return ( UnicodeString( line ) );
+}
+
+}
+
+void width( void ) {
+	int const iterations( 20000 );
+	struct Input {
+		char const* name;
+		UnicodeString text;
+	} const inputs[] = {
+		{ "ascii", make_line( "select * from table where x = 1; " ) },
+		{ "cjk", make_line( "\xe6\xbc\xa2\xe5\xad\x97\xe5\xb9\xb3\xe4\xbb\xae\xe5\x90\x8d " ) },
+		{ "colored", make_line( "\033[0;1;92mselect\033[0m * \033[0;33mfrom\033[0m table " ) }
+	};
+	int volatile sink( 0 );
+	for ( Input const& in : inputs ) {
+		char32_t const* text( in.text.get() );
+		int len( in.text.length() );
+		std::string name( std::string( "wcwidth " ) + in.name + " (per char)" );
+		report(
+			"width", name.c_str(),
+			measure( [&]( int ) { int w( 0 ); for ( int i( 0 ); i < len; ++ i ) { w += mk_wcwidth( text[i] ); } sink = sink + w; }, iterations ) / len
+		);
+		name = std::string( "displayed " ) + in.name + " (per char)";
+		report(
+			"width", name.c_str(),
+			measure( [&]( int ) { sink = sink + calculate_displayed_length( text, len ); }, iterations ) / len
+		);
+	}
+	std::vector<char> widths( static_cast<size_t>( inputs[1].text.length() ) );
+	report(
+		"width", "recompute widths cjk (per char)",
+		measure( [&]( int ) { recompute_character_widths( inputs[1].text.get(), widths.data(), inputs[1].text.length() ); }, iterations ) / inputs[1].text.length()
+	);
+}
+
+}
+
+}
+
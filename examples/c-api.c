@@ -1,9 +1,21 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L /* nanosleep() with -std=c99 */
+#endif
+
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#endif
+
 #include "replxx.h"
 #include "util.h"
 
@@ -21,6 +33,64 @@ void completionHook(char const* context, replxx_completions* lc, int* contextLen
 	}
 }
 
+typedef struct {
+	char** examples;
+	int delay; /* milliseconds between first and remaining candidates */
+} async_completer_t;
+
+typedef struct {
+	replxx_completion_request* request;
+	async_completer_t* completer;
+} async_completion_t;
+
+/* Asynchronous variant of completionHook(), simulates slow completer:
+ * first match is delivered at once, the rest after a delay, unless
+ * the request gets cancelled by a key press in the meantime. */
+void* asyncCompleter( void* data ) {
+	async_completion_t* job = (async_completion_t*)( data );
+	replxx_completion_request* request = job->request;
+	char** examples = job->completer->examples;
+	char const* context = replxx_completion_request_input( request );
+	int delivered = 0;
+	size_t i;
+
+	int utf8ContextLen = context_len( context );
+	int prefixLen = strlen( context ) - utf8ContextLen;
+	replxx_completion_request_set_context_length( request, utf8str_codepoint_len( context + prefixLen, utf8ContextLen ) );
+	for ( i = 0; examples[i] != NULL; ++ i ) {
+		if ( strncmp( context + prefixLen, examples[i], utf8ContextLen ) == 0 ) {
+#ifndef _WIN32
+			if ( ( delivered == 1 ) && ( job->completer->delay > 0 ) ) {
+				struct timespec delay = { job->completer->delay / 1000, ( job->completer->delay % 1000 ) * 1000000L };
+				nanosleep( &delay, NULL );
+			}
+#endif
+			if ( ! replxx_completion_request_add( request, examples[i] ) ) {
+				break;
+			}
+			++ delivered;
+		}
+	}
+	replxx_completion_request_finish( request );
+	replxx_completion_request_release( request );
+	free( job );
+	return ( NULL );
+}
+
+void asyncCompletionHook( replxx_completion_request* request, void* ud ) {
+	async_completion_t* job = (async_completion_t*)( malloc( sizeof ( async_completion_t ) ) );
+	job->request = request;
+	job->completer = (async_completer_t*)( ud );
+#ifndef _WIN32
+	pthread_t worker;
+	if ( pthread_create( &worker, NULL, asyncCompleter, job ) == 0 ) {
+		pthread_detach( worker );
+		return;
+	}
+#endif
+	asyncCompleter( job );
+}
+
 void hintHook(char const* context, replxx_hints* lc, int* contextLen, ReplxxColor* c, void* ud) {
 	char** examples = (char**)( ud );
 	int i;
@@ -36,18 +106,82 @@ void hintHook(char const* context, replxx_hints* lc, int* contextLen, ReplxxColo
 	}
 }
 
+typedef struct {
+	Replxx* replxx;
+	int delay; /* milliseconds, simulates slow highlighter */
+} highlighter_t;
+
 void colorHook( char const* str_, ReplxxColor* colors_, int size_, void* ud ) {
+	highlighter_t* highlighter = (highlighter_t*)( ud );
 	int i = 0;
+#ifndef _WIN32
+	if ( highlighter->delay > 0 ) {
+		struct timespec delay = { highlighter->delay / 1000, ( highlighter->delay % 1000 ) * 1000000L };
+		nanosleep( &delay, NULL );
+	}
+#endif
 	for ( ; i < size_; ++ i ) {
 		if ( isdigit( str_[i] ) ) {
 			colors_[i] = REPLXX_COLOR_BRIGHTMAGENTA;
 		}
 	}
 	if ( ( size_ > 0 ) && ( str_[size_ - 1] == '(' ) ) {
-		replxx_emulate_key_press( ud, ')' );
-		replxx_emulate_key_press( ud, REPLXX_KEY_LEFT );
+		replxx_emulate_key_press( highlighter->replxx, ')' );
+		replxx_emulate_key_press( highlighter->replxx, REPLXX_KEY_LEFT );
+	}
+}
+
+typedef struct {
+	int overruns;
+	ReplxxCallbackDegradation degradation;
+} budget_stats_t;
+
+/* Count calls of highlighter and hint callbacks that took longer than their budgets. */
+void budgetHook( ReplxxBudgetedCallback callback, ReplxxCallbackDegradation degradation, long long duration, int bufferLength, void* ud ) {
+	budget_stats_t* stats = (budget_stats_t*)( ud );
+	++ stats->overruns;
+	stats->degradation = degradation;
+}
+
+#ifndef _WIN32
+/* Extra session on terminal device given with S<path>,
+ * with its own Replxx instance driven step-wise by its own thread. */
+typedef struct {
+	int id;
+	int fd;
+	Replxx* replxx;
+	pthread_t thread;
+} session_t;
+
+void* serveSession( void* data ) {
+	session_t* session = (session_t*)( data );
+	Replxx* replxx = session->replxx;
+	while ( replxx_start_input( replxx, "session> " ) == 0 ) {
+		ReplxxInputStatus status = REPLXX_INPUT_STATUS_EDITING;
+		char const* line = NULL;
+		while ( status == REPLXX_INPUT_STATUS_EDITING ) {
+			int inputFd = replxx_input_fd( replxx );
+			int eventFd = replxx_event_fd( replxx );
+			int timeout = replxx_next_timeout( replxx );
+			struct timeval tv = { timeout / 1000, ( timeout % 1000 ) * 1000 };
+			fd_set fdSet;
+			FD_ZERO( &fdSet );
+			FD_SET( inputFd, &fdSet );
+			FD_SET( eventFd, &fdSet );
+			if ( ( select( ( inputFd > eventFd ? inputFd : eventFd ) + 1, &fdSet, NULL, NULL, timeout >= 0 ? &tv : NULL ) == -1 ) && ( errno != EINTR ) ) {
+				return ( NULL );
+			}
+			status = replxx_process_input( replxx, &line );
+		}
+		if ( status != REPLXX_INPUT_STATUS_COMPLETE ) {
+			break;
+		}
+		replxx_print( replxx, "session %d got: %s\n", session->id, line );
+		replxx_history_add( replxx, line );
 	}
+	return ( NULL );
 }
+#endif
 
 ReplxxActionResult word_eater( int ignored, void* ud ) {
 	Replxx* replxx = (Replxx*)ud;
@@ -85,6 +219,7 @@ void split( char* str_, char** data_, int size_ ) {
 
 int main( int argc, char** argv ) {
 #define MAX_EXAMPLE_COUNT 128
+#define MAX_SESSION_COUNT 4
 	char* examples[MAX_EXAMPLE_COUNT + 1] = {
 		"db", "hello", "hallo", "hans", "hansekogge", "seamann", "quetzalcoatl", "quit", "power", NULL
 	};
@@ -92,6 +227,18 @@ int main( int argc, char** argv ) {
 	replxx_install_window_change_handler( replxx );
 
 	int quiet = 0;
+	int useIndex = 0;
+	char const* indexFile = NULL;
+	ReplxxVirtualTerminal* screen = NULL;
+	async_completer_t completer = { examples, -1 };
+	highlighter_t highlighter = { replxx, 0 };
+	budget_stats_t budget = { 0, REPLXX_CALLBACK_DEGRADATION_NONE };
+	ReplxxCompletionIndex* index = NULL;
+#ifndef _WIN32
+	session_t sessions[MAX_SESSION_COUNT];
+	int sessionCount = 0;
+	int s;
+#endif
 	char const* prompt = "\x1b[1;32mreplxx\x1b[0m> ";
 	while ( argc > 1 ) {
 		-- argc;
@@ -105,15 +252,46 @@ int main( int argc, char** argv ) {
 		switch ( (*argv)[0] ) {
 			case 'b': replxx_set_beep_on_ambiguous_completion( replxx, (*argv)[1] - '0' ); break;
 			case 'c': replxx_set_completion_count_cutoff( replxx, atoi( (*argv) + 1 ) );   break;
+			case 't': replxx_set_completion_cache_ttl( replxx, atoi( (*argv) + 1 ) );      break;
+			case 'u': replxx_set_completion_menu( replxx, atoi( (*argv) + 1 ) );           break;
+			case 'f': replxx_set_fuzzy_completion( replxx, atoi( (*argv) + 1 ) );          break;
 			case 'e': replxx_set_complete_on_empty( replxx, (*argv)[1] - '0' );            break;
 			case 'd': replxx_set_double_tab_completion( replxx, (*argv)[1] - '0' );        break;
 			case 'h': replxx_set_max_hint_rows( replxx, atoi( (*argv) + 1 ) );             break;
 			case 's': replxx_set_max_history_size( replxx, atoi( (*argv) + 1 ) );          break;
+			case 'k': replxx_set_max_kill_ring_size( replxx, atoi( (*argv) + 1 ) );        break;
+			case 'y': replxx_set_kill_ring_clipboard( replxx, (*argv)[1] - '0' );          break;
 			case 'i': replxx_set_preload_buffer( replxx, recode( (*argv) + 1 ) );          break;
 			case 'w': replxx_set_word_break_characters( replxx, (*argv) + 1 );             break;
 			case 'm': replxx_set_no_color( replxx, (*argv)[1] - '0' );                     break;
 			case 'p': prompt = recode( (*argv) + 1 );                                      break;
 			case 'q': quiet = atoi( (*argv) + 1 );                                         break;
+			case 'n': useIndex = (*argv)[1] - '0';                                         break;
+			case 'v': indexFile = (*argv) + 1;                                             break;
+			case 'V': screen = replxx_virtual_terminal_init( 40, 6 );
+			          replxx_virtual_terminal_feed( screen, (*argv) + 1 );
+			          replxx_set_virtual_terminal( replxx, screen );                       break;
+			case 'a': completer.delay = atoi( (*argv) + 1 );                              break;
+			case 'l': replxx_set_latency_instrumentation( replxx, 1 );
+			          replxx_set_latency_report_file( replxx, (*argv) + 1 );               break;
+			case 'r': replxx_set_session_recording( replxx, (*argv) + 1 );                 break;
+			case 'o': replxx_set_terminal_fds( replxx, 0, 1 );                             break;
+#ifndef _WIN32
+			case 'S': if ( sessionCount < MAX_SESSION_COUNT ) {
+			            sessions[sessionCount].id = sessionCount + 1;
+			            sessions[sessionCount].fd = open( (*argv) + 1, O_RDWR | O_NOCTTY );
+			            sessions[sessionCount].replxx = replxx_init();
+			            if ( replxx_set_terminal_fds( sessions[sessionCount].replxx, sessions[sessionCount].fd, sessions[sessionCount].fd ) == 0 ) {
+			              ++ sessionCount;
+			            } else {
+			              replxx_end( sessions[sessionCount].replxx );
+			            }
+			          }                                                                    break;
+#endif
+			case 'g': replxx_set_callback_budget( replxx, REPLXX_BUDGETED_CALLBACK_HIGHLIGHTER, atoi( (*argv) + 1 ) );
+			          replxx_set_callback_budget( replxx, REPLXX_BUDGETED_CALLBACK_HINT, atoi( (*argv) + 1 ) );
+			          replxx_set_callback_budget_handler( replxx, budgetHook, &budget );      break;
+			case 'z': highlighter.delay = atoi( (*argv) + 1 );                            break;
 			case 'x': split( (*argv) + 1, examples, MAX_EXAMPLE_COUNT );                   break;
 		}
 
@@ -123,11 +301,31 @@ int main( int argc, char** argv ) {
 
 	replxx_history_load( replxx, file );
 	replxx_set_completion_callback( replxx, completionHook, examples );
-	replxx_set_highlighter_callback( replxx, colorHook, replxx );
+	if ( completer.delay >= 0 ) {
+		replxx_set_async_completion_callback( replxx, asyncCompletionHook, &completer );
+	}
+	if ( useIndex || indexFile ) {
+		int i;
+		index = replxx_completion_index_init();
+		if ( indexFile ) {
+			replxx_completion_index_load( index, indexFile );
+		} else {
+			for ( i = 0; examples[i] != NULL; ++ i ) {
+				replxx_completion_index_add( index, examples[i] );
+			}
+		}
+		replxx_set_completion_index( replxx, index );
+	}
+	replxx_set_highlighter_callback( replxx, colorHook, &highlighter );
 	replxx_set_hint_callback( replxx, hintHook, examples );
 	replxx_bind_key( replxx, '.', word_eater, replxx );
 
 	printf("starting...\n");
+#ifndef _WIN32
+	for ( s = 0; s < sessionCount; ++ s ) {
+		pthread_create( &sessions[s].thread, NULL, serveSession, &sessions[s] );
+	}
+#endif
 
 	while (1) {
 		char const* result = NULL;
@@ -138,6 +336,13 @@ int main( int argc, char** argv ) {
 		if (result == NULL) {
 			printf("\n");
 			break;
+		} else if (!strncmp(result, "/resize", 7)) {
+			/* terminals of extra sessions get no SIGWINCH, tell them from this thread */
+#ifndef _WIN32
+			for ( s = 0; s < sessionCount; ++ s ) {
+				replxx_window_changed( sessions[s].replxx );
+			}
+#endif
 		} else if (!strncmp(result, "/history", 8)) {
 			/* Display the current history. */
 			int index = 0;
@@ -156,7 +361,31 @@ int main( int argc, char** argv ) {
 		}
 	}
 	replxx_history_save( replxx, file );
+#ifndef _WIN32
+	for ( s = 0; s < sessionCount; ++ s ) {
+		pthread_join( sessions[s].thread, NULL );
+		replxx_end( sessions[s].replxx );
+		close( sessions[s].fd );
+	}
+#endif
+	if ( screen ) {
+		/* session ran on virtual terminal fed with given keys, show what it drew */
+		char line[256];
+		int x = 0, y = 0;
+		replxx_set_virtual_terminal( replxx, NULL );
+		for ( y = 0; y < 6; ++ y ) {
+			replxx_virtual_terminal_line( screen, y, line, sizeof ( line ) );
+			printf( "|%s|\n", line );
+		}
+		replxx_virtual_terminal_cursor( screen, &x, &y );
+		printf( "cursor: %d,%d\n", x, y );
+		replxx_virtual_terminal_end( screen );
+	}
+	if ( budget.overruns > 0 ) {
+		printf( "callbacks exceeded their budgets %d times, degradation %d\n", budget.overruns, budget.degradation );
+	}
 	printf( "Exiting Replxx\n" );
 	replxx_end( replxx );
+	replxx_completion_index_end( index );
 }
 
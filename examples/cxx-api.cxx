@@ -8,6 +8,12 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cerrno>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
 
 #include "replxx.hxx"
 #include "util.h"
@@ -53,6 +59,31 @@ public:
 	}
 };
 
+// drive replxx from our own event loop with non-blocking, step-wise API
+char const* step_input( Replxx& rx, std::string const& prompt ) {
+#ifndef _WIN32
+	if ( rx.start_input( prompt ) ) {
+		char const* line( nullptr );
+		while ( true ) {
+			fd_set fdSet;
+			FD_ZERO( &fdSet );
+			FD_SET( rx.input_fd(), &fdSet );
+			FD_SET( rx.event_fd(), &fdSet );
+			int nfds( std::max( rx.input_fd(), rx.event_fd() ) + 1 );
+			int timeout( rx.next_timeout() );
+			timeval tv{ timeout / 1000, ( timeout % 1000 ) * 1000 };
+			if ( ( select( nfds, &fdSet, nullptr, nullptr, timeout >= 0 ? &tv : nullptr ) == -1 ) && ( errno != EINTR ) ) {
+				return ( nullptr );
+			}
+			if ( rx.process_input( line ) != Replxx::INPUT_STATUS::EDITING ) {
+				return ( line );
+			}
+		}
+	}
+#endif
+	return ( rx.input( prompt ) );
+}
+
 // prototypes
 Replxx::completions_t hook_completion(std::string const& context, int& contextLen, std::vector<std::string> const& user_data);
 Replxx::hints_t hook_hint(std::string const& context, int& contextLen, Replxx::Color& color, std::vector<std::string> const& user_data);
@@ -211,6 +242,7 @@ int main( int argc_, char** argv_ ) {
 	// init the repl
 	Replxx rx;
 	Tick tick( rx, argc_ > 1 ? argv_[1] : "" );
+	bool stepInput( ( argc_ > 2 ) && ( std::string( argv_[2] ) == "step" ) );
 	rx.install_window_change_handler();
 
 	// the path to the history file
@@ -314,6 +346,7 @@ int main( int argc_, char** argv_ ) {
 	rx.bind_key( Replxx::KEY::control( Replxx::KEY::F10 ), std::bind( &message, std::ref( rx ), "<C-F10>", _1 ) );
 	rx.bind_key( Replxx::KEY::control( Replxx::KEY::F11 ), std::bind( &message, std::ref( rx ), "<C-F11>", _1 ) );
 	rx.bind_key( Replxx::KEY::control( Replxx::KEY::F12 ), std::bind( &message, std::ref( rx ), "<C-F12>", _1 ) );
+	rx.bind_key_sequence( Replxx::key_sequence_t{ Replxx::KEY::control( 'X' ), Replxx::KEY::control( 'E' ) }, std::bind( &message, std::ref( rx ), "<C-x C-e>", _1 ) );
 
 	// display initial welcome message
 	std::cout
@@ -334,7 +367,7 @@ int main( int argc_, char** argv_ ) {
 		char const* cinput{ nullptr };
 
 		do {
-			cinput = rx.input(prompt);
+			cinput = stepInput ? step_input( rx, prompt ) : rx.input( prompt );
 		} while ( ( cinput == nullptr ) && ( errno == EAGAIN ) );
 
 		if (cinput == nullptr) {
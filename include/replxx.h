@@ -156,7 +156,9 @@ typedef enum {
 	REPLXX_ACTION_COMPLETE_LINE,
 	REPLXX_ACTION_COMMIT_LINE,
 	REPLXX_ACTION_ABORT_LINE,
-	REPLXX_ACTION_SEND_EOF
+	REPLXX_ACTION_SEND_EOF,
+	REPLXX_ACTION_UNDO,
+	REPLXX_ACTION_REDO
 } ReplxxAction;
 
 /*! \brief Possible results of key-press handler actions.
@@ -167,6 +169,53 @@ typedef enum {
 	REPLXX_ACTION_RESULT_BAIL      /*!< Stop processing user input, returns nullptr from the \e input() call. */
 } ReplxxActionResult;
 
+/*! \brief Possible states of step-wise input session.
+ */
+typedef enum {
+	REPLXX_INPUT_STATUS_EDITING,    /*!< User is still editing the line. */
+	REPLXX_INPUT_STATUS_COMPLETE,   /*!< User accepted the line. */
+	REPLXX_INPUT_STATUS_END_OF_FILE /*!< Session ended without a line (EOF or aborted line, see \e errno). */
+} ReplxxInputStatus;
+
+/*! \brief Phases of key press processing measured by latency instrumentation.
+ */
+typedef enum {
+	REPLXX_LATENCY_PHASE_READ_KEY,    /*!< Reading and decoding a key press, after terminal signaled input. */
+	REPLXX_LATENCY_PHASE_DISPATCH,    /*!< Handling a key press, includes all phases below. */
+	REPLXX_LATENCY_PHASE_HIGHLIGHTER, /*!< Highlighter callback. */
+	REPLXX_LATENCY_PHASE_HINT,        /*!< Hint callback. */
+	REPLXX_LATENCY_PHASE_REFRESH,     /*!< Redrawing input line, includes callbacks and terminal writes it made. */
+	REPLXX_LATENCY_PHASE_WRITE        /*!< Single write to terminal. */
+} ReplxxLatencyPhase;
+
+#define REPLXX_LATENCY_BUCKET_COUNT 40
+
+/*! \brief Snapshot of latency histogram of a single phase, durations are in nanoseconds.
+ */
+typedef struct ReplxxLatencyHistogram {
+	long long count;
+	long long total;
+	long long max;
+	long long bytes;                                /*!< Bytes written, WRITE phase only. */
+	long long buckets[REPLXX_LATENCY_BUCKET_COUNT]; /*!< Bucket \e i counts durations in [2^i, 2^(i+1)), bucket 0 includes 0. */
+} ReplxxLatencyHistogram;
+
+/*! \brief Callbacks called on every refresh of input line that can be given time budgets.
+ */
+typedef enum {
+	REPLXX_BUDGETED_CALLBACK_HIGHLIGHTER,
+	REPLXX_BUDGETED_CALLBACK_HINT
+} ReplxxBudgetedCallback;
+
+/*! \brief Degradation applied to a callback that repeatedly exceeds its time budget.
+ */
+typedef enum {
+	REPLXX_CALLBACK_DEGRADATION_NONE,              /*!< Callback is called on every refresh. */
+	REPLXX_CALLBACK_DEGRADATION_SKIP_ON_TYPEAHEAD, /*!< Callback is not called while more input is already waiting. */
+	REPLXX_CALLBACK_DEGRADATION_DEBOUNCE,          /*!< Callback is called only after input was idle for idle period. */
+	REPLXX_CALLBACK_DEGRADATION_LARGE_BUFFER_OFF   /*!< Callback is not called for input as long as the one it was too slow for. */
+} ReplxxCallbackDegradation;
+
 typedef struct Replxx Replxx;
 
 /*! \brief Create Replxx library resouce holder.
@@ -247,6 +296,93 @@ void replxx_set_completion_callback( Replxx*, replxx_completion_callback_t* fn,
  */
 void replxx_add_completion( replxx_completions* completions, const char* str );
 
+typedef struct ReplxxCompletionIndex ReplxxCompletionIndex;
+
+/*! \brief Create an empty prefix search index for completions.
+ */
+ReplxxCompletionIndex* replxx_completion_index_init( void );
+
+/*! \brief Release resources used by the index.
+ */
+void replxx_completion_index_end( ReplxxCompletionIndex* );
+
+/*! \brief Add an UTF-8 encoded word to the index.
+ */
+void replxx_completion_index_add( ReplxxCompletionIndex*, const char* word );
+
+/*! \brief Add words from a file, one word per line.
+ *
+ * \return 0 on success, -1 if the file could not be read.
+ */
+int replxx_completion_index_load( ReplxxCompletionIndex*, const char* filename );
+
+/*! \brief Add all words from the index starting with \e prefix to \e completions.
+ *
+ * Can be used from user completion callback.
+ *
+ * \return number of words added.
+ */
+int replxx_completion_index_complete( ReplxxCompletionIndex*, const char* prefix, replxx_completions* completions );
+
+/*! \brief Complete words from given index instead of calling completion callback.
+ *
+ * Index is not copied, it must outlive its use by replxx.
+ *
+ * \param index - index to complete from, NULL restores use of completion callback.
+ */
+void replxx_set_completion_index( Replxx*, ReplxxCompletionIndex* index );
+
+typedef struct replxx_completion_request replxx_completion_request;
+
+/*! \brief Asynchronous completions callback type definition.
+ *
+ * Callback should return promptly and fill \e request, possibly from other thread,
+ * replxx shows completions received so far while waiting for more.
+ * Request is cancelled if user presses any key other than Tab before the request is finished.
+ * Completer must call \e replxx_completion_request_release() once it is done with the request.
+ *
+ * \param request - pointer to opaque completion request.
+ * \param userData - pointer to opaque user data block.
+ */
+typedef void(replxx_async_completion_callback_t)(replxx_completion_request* request, void* userData);
+
+/*! \brief Register asynchronous completion callback, used instead of completion callback.
+ *
+ * \param fn - user defined callback function, NULL restores use of completion callback.
+ * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+ */
+void replxx_set_async_completion_callback( Replxx*, replxx_async_completion_callback_t* fn, void* userData );
+
+/*! \brief UTF-8 encoded input entered by the user until current cursor position.
+ */
+char const* replxx_completion_request_input( replxx_completion_request* );
+
+/*! \brief Length of the context in code points, length of word before cursor by default.
+ */
+int replxx_completion_request_context_length( replxx_completion_request* );
+
+/*! \brief Change length of the context, must be called before first completion is added.
+ */
+void replxx_completion_request_set_context_length( replxx_completion_request*, int contextLen );
+
+/*! \brief Add another possible completion, may be called from any thread.
+ *
+ * \return 0 if request was cancelled and completer should stop, non-zero otherwise.
+ */
+int replxx_completion_request_add( replxx_completion_request*, const char* str );
+
+/*! \brief Tell replxx no more completions will be added.
+ */
+void replxx_completion_request_finish( replxx_completion_request* );
+
+/*! \brief Check if user cancelled the request.
+ */
+int replxx_completion_request_is_cancelled( replxx_completion_request* );
+
+/*! \brief Release the request, it must not be used afterwards.
+ */
+void replxx_completion_request_release( replxx_completion_request* );
+
 typedef struct replxx_hints replxx_hints;
 
 /*! \brief Hints callback type definition.
@@ -299,6 +435,95 @@ void replxx_add_hint( replxx_hints* hints, const char* str );
  */
 char const* replxx_input( Replxx*, const char* prompt );
 
+/*! \brief Start non-blocking, step-wise line editing session.
+ *
+ * User input is then processed by calls to replxx_process_input()
+ * whenever replxx_input_fd() or replxx_event_fd() becomes readable.
+ * Available only on POSIX terminals, use replxx_input() if this function fails.
+ *
+ * \param prompt - prompt to be displayed before getting user input.
+ * \return 0 iff session was started, -1 otherwise (\e errno is set).
+ */
+int replxx_start_input( Replxx*, const char* prompt );
+
+/*! \brief Process user input that is available without blocking.
+ *
+ * \param line - set to UTF-8 encoded input given by the user
+ * if REPLXX_INPUT_STATUS_COMPLETE is returned, NULL otherwise.
+ * \return State of the editing session.
+ */
+ReplxxInputStatus replxx_process_input( Replxx*, char const** line );
+
+typedef struct ReplxxVirtualTerminal ReplxxVirtualTerminal;
+
+/*! \brief Create an in-memory terminal emulator of given size.
+ *
+ * Lets replxx be driven in-process, e.g. from tests and benchmarks,
+ * see replxx_set_virtual_terminal().
+ */
+ReplxxVirtualTerminal* replxx_virtual_terminal_init( int columns, int rows );
+
+/*! \brief Release resources used by the virtual terminal.
+ */
+void replxx_virtual_terminal_end( ReplxxVirtualTerminal* );
+
+/*! \brief Append bytes to virtual terminal input, reads report end of input once it is exhausted.
+ */
+void replxx_virtual_terminal_feed( ReplxxVirtualTerminal*, const char* data );
+
+/*! \brief Copy UTF-8 encoded content of screen row \e y, without trailing blanks, to \e buffer.
+ *
+ * \return Length of the row content, content is truncated if it is not less than \e size.
+ */
+int replxx_virtual_terminal_line( ReplxxVirtualTerminal*, int y, char* buffer, int size );
+
+/*! \brief Get cursor position of the virtual terminal.
+ */
+void replxx_virtual_terminal_cursor( ReplxxVirtualTerminal*, int* x, int* y );
+
+/*! \brief Use virtual terminal instead of standard input and output.
+ *
+ * \param terminal - terminal to use, NULL restores standard input and output.
+ * \return 0 on success, -1 if not supported (on Windows).
+ */
+int replxx_set_virtual_terminal( Replxx*, ReplxxVirtualTerminal* terminal );
+
+/*! \brief Use given file descriptors as terminal instead of standard input and output.
+ *
+ * Every Replxx instance is independent, so one process can serve many
+ * sessions on pseudo terminals or sockets. Descriptors are not closed by replxx.
+ *
+ * \param in - descriptor to read key presses from.
+ * \param out - descriptor to draw on.
+ * \return 0 on success, -1 on invalid descriptors or if not supported (on Windows).
+ */
+int replxx_set_terminal_fds( Replxx*, int in, int out );
+
+/*! \brief Tell replxx that screen size of terminal given with replxx_set_terminal_fds() has changed.
+ *
+ * May be called from any thread.
+ */
+void replxx_window_changed( Replxx* );
+
+/*! \brief Record terminal input and screen size changes to a session file.
+ *
+ * \param filename - path of session file, NULL or empty string stops recording.
+ * \return 0 on success, -1 on error or if not supported (on Windows).
+ */
+int replxx_set_session_recording( Replxx*, const char* filename );
+
+/*! \brief Get file descriptor of terminal input, -1 if not supported.
+ */
+int replxx_input_fd( Replxx* );
+
+/*! \brief Get file descriptor signaled by replxx_print() and replxx_emulate_key_press() called from other threads, -1 if not supported.
+ */
+int replxx_event_fd( Replxx* );
+
+/*! \brief Get time in milliseconds after which replxx_process_input() has to be called even if no input arrives, -1 if there is nothing to wait for.
+ */
+int replxx_next_timeout( Replxx* );
+
 /*! \brief Print formatted string to standard output.
  *
  * This function ensures proper handling of ANSI escape sequences
@@ -333,6 +558,21 @@ ReplxxActionResult replxx_invoke( Replxx*, ReplxxAction action, int unsigned cod
  */
 void replxx_bind_key( Replxx*, int code, key_press_handler_t handler, void* userData );
 
+/*! \brief Bind user defined action to handle given sequence of key-press events.
+ *
+ * \param codes - handle this sequence of key-press events with following handler.
+ * \param count - number of key codes in the sequence.
+ * \param handle - use this handler to handle the sequence.
+ * \param userData - supplementary user data passed to invoked handlers.
+ */
+void replxx_bind_key_sequence( Replxx*, int const* codes, int count, key_press_handler_t handler, void* userData );
+
+/*! \brief Set how long to wait for the next key of a key sequence.
+ *
+ * \param milliseconds - timeout in milliseconds, 0 means wait indefinitely, default is 1000.
+ */
+void replxx_set_key_sequence_timeout( Replxx*, int milliseconds );
+
 void replxx_set_preload_buffer( Replxx*, const char* preloadText );
 
 void replxx_history_add( Replxx*, const char* line );
@@ -350,6 +590,35 @@ void replxx_set_word_break_characters( Replxx*, char const* wordBreakers );
  */
 void replxx_set_completion_count_cutoff( Replxx*, int count );
 
+/*! \brief Cache completions returned by completion callback.
+ *
+ * Cached completions are filtered locally while user types more characters of the same word.
+ * Cache works only with callbacks that return completions starting with the completion context.
+ *
+ * \param milliseconds - how long cached completions are used,
+ * 0 disables cache (default), negative value means cached completions do not expire.
+ */
+void replxx_set_completion_cache_ttl( Replxx*, int milliseconds );
+
+/*! \brief Show ambiguous completions in an interactive menu, filtered as user types.
+ *
+ * \param rows - maximum number of rows of the menu, 0 disables the menu (default).
+ */
+void replxx_set_completion_menu( Replxx*, int rows );
+
+/*! \brief Rank completions by fuzzy matching against completion context.
+ *
+ * Completion matches if it contains all characters of the context in the same order.
+ * Completion callback should return all candidates applicable in given context.
+ *
+ * \param maxResults - number of best matching completions to keep, 0 disables fuzzy matching (default).
+ */
+void replxx_set_fuzzy_completion( Replxx*, int maxResults );
+
+/*! \brief Drop cached completions, safe to call from any thread.
+ */
+void replxx_invalidate_completion_cache( Replxx* );
+
 /*! \brief Set maximum number of displayed hint rows.
  */
 void replxx_set_max_hint_rows( Replxx*, int count );
@@ -378,13 +647,95 @@ void replxx_set_beep_on_ambiguous_completion( Replxx*, int val );
  */
 void replxx_set_no_color( Replxx*, int val );
 
+/*! \brief Limit how often the prompt is redrawn due to messages printed from other threads.
+ *
+ * \param rate - maximum number of redraws per second, 0 means no limit (default).
+ */
+void replxx_set_max_redraw_rate( Replxx*, int rate );
+
+/*! \brief Set time budget of a callback called on every refresh.
+ *
+ * \param callback - callback to set budget for.
+ * \param microseconds - budget of a single call, 0 means unlimited (default).
+ */
+void replxx_set_callback_budget( Replxx*, ReplxxBudgetedCallback callback, int microseconds );
+
+/*! \brief Set idle period after which debounced callbacks are called, default is 100 milliseconds.
+ */
+void replxx_set_callback_idle_period( Replxx*, int milliseconds );
+
+/*! \brief Callback budget diagnostics handler type definition.
+ *
+ * \param callback - callback that exceeded its budget.
+ * \param degradation - degradation of the callback in effect after this call.
+ * \param duration - duration of the call in microseconds.
+ * \param bufferLength - number of code points in input buffer.
+ * \param userData - pointer to opaque user data block.
+ */
+typedef void (replxx_callback_budget_handler_t)( ReplxxBudgetedCallback callback, ReplxxCallbackDegradation degradation, long long duration, int bufferLength, void* userData );
+
+/*! \brief Register handler notified about callbacks exceeding their time budgets.
+ */
+void replxx_set_callback_budget_handler( Replxx*, replxx_callback_budget_handler_t* fn, void* userData );
+
+/*! \brief Get degradation currently applied to given callback.
+ */
+ReplxxCallbackDegradation replxx_callback_degradation( Replxx*, ReplxxBudgetedCallback callback );
+
 /*! \brief Set maximum number of entries in history list.
  */
 void replxx_set_max_history_size( Replxx*, int len );
+
+/*! \brief Set memory limit for undo log of currently edited line.
+ *
+ * \param bytes - memory limit in bytes, 0 disables undo, default is 64 KiB.
+ */
+void replxx_set_max_undo_size( Replxx*, int bytes );
+
+/*! \brief Set maximum number of entries in kill ring.
+ *
+ * \param count - maximum number of killed texts remembered, 0 disables kill ring, default is 10.
+ */
+void replxx_set_max_kill_ring_size( Replxx*, int count );
+
+/*! \brief Set memory limit for kill ring.
+ *
+ * \param bytes - memory limit in bytes, default is 1 MiB.
+ */
+void replxx_set_max_kill_ring_bytes( Replxx*, int bytes );
+
+/*! \brief Copy killed text to system clipboard (with OSC 52 terminal escape sequence).
+ *
+ * \param val - if set to non-zero copy killed text to system clipboard.
+ */
+void replxx_set_kill_ring_clipboard( Replxx*, int val );
+
 char const* replxx_history_line( Replxx*, int index );
 int replxx_history_save( Replxx*, const char* filename );
 int replxx_history_load( Replxx*, const char* filename );
 void replxx_clear_screen( Replxx* );
+
+/*! \brief Enable or disable latency instrumentation.
+ *
+ * \param val - measure latencies of key press processing phases, disabled by default.
+ */
+void replxx_set_latency_instrumentation( Replxx*, int val );
+
+/*! \brief Get snapshot of latency histogram of given phase.
+ */
+void replxx_latency_histogram( Replxx*, ReplxxLatencyPhase phase, ReplxxLatencyHistogram* histogram );
+
+void replxx_reset_latency_histograms( Replxx* );
+
+/*! \brief Copy human readable summary of all latency histograms to \e buffer.
+ *
+ * \return Length of the summary, summary is truncated if it is not less than \e size.
+ */
+int replxx_latency_report( Replxx*, char* buffer, int size );
+
+/*! \brief Write latency summary to given file when replxx is destroyed, NULL disables the summary.
+ */
+void replxx_set_latency_report_file( Replxx*, const char* filename );
 #ifdef __REPLXX_DEBUG__
 void replxx_debug_dump_print_codes(void);
 #endif
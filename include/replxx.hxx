@@ -155,7 +155,9 @@ public:
 		COMPLETE_LINE,
 		COMMIT_LINE,
 		ABORT_LINE,
-		SEND_EOF
+		SEND_EOF,
+		UNDO,
+		REDO
 	};
 	/*! \brief Possible results of key-press handler actions.
 	 */
@@ -164,6 +166,51 @@ public:
 		RETURN,   /*!< Return user input entered so far. */
 		BAIL      /*!< Stop processing user input, returns nullptr from the \e input() call. */
 	};
+	/*! \brief Possible states of step-wise input session.
+	 */
+	enum class INPUT_STATUS {
+		EDITING,    /*!< User is still editing the line. */
+		COMPLETE,   /*!< User accepted the line. */
+		END_OF_FILE /*!< Session ended without a line (EOF or aborted line, see \e errno). */
+	};
+	/*! \brief Phases of key press processing measured by latency instrumentation.
+	 */
+	enum class LATENCY_PHASE {
+		READ_KEY,    /*!< Reading and decoding a key press, after terminal signaled input. */
+		DISPATCH,    /*!< Handling a key press, includes all phases below. */
+		HIGHLIGHTER, /*!< Highlighter callback. */
+		HINT,        /*!< Hint callback. */
+		REFRESH,     /*!< Redrawing input line, includes callbacks and terminal writes it made. */
+		WRITE        /*!< Single write to terminal. */
+	};
+	/*! \brief Snapshot of latency histogram of a single phase, durations are in nanoseconds.
+	 */
+	struct LatencyHistogram {
+		static int const BUCKET_COUNT = 40;
+		int long long count;
+		int long long total;
+		int long long max;
+		int long long bytes;                 /*!< Bytes written, WRITE phase only. */
+		int long long buckets[BUCKET_COUNT]; /*!< Bucket \e i counts durations in [2^i, 2^(i+1)), bucket 0 includes 0. */
+		/*! \brief Upper bound of duration for given percentile (0-100) of measurements. */
+		int long long percentile( double p ) const;
+	};
+	/*! \brief Callbacks called on every refresh of input line that can be given time budgets.
+	 */
+	enum class BUDGETED_CALLBACK {
+		HIGHLIGHTER,
+		HINT
+	};
+	/*! \brief Degradation applied to a callback that repeatedly exceeds its time budget.
+	 *
+	 * Every level also applies restrictions of levels before it.
+	 */
+	enum class CALLBACK_DEGRADATION {
+		NONE,              /*!< Callback is called on every refresh. */
+		SKIP_ON_TYPEAHEAD, /*!< Callback is not called while more input is already waiting. */
+		DEBOUNCE,          /*!< Callback is called only after input was idle for idle period. */
+		LARGE_BUFFER_OFF   /*!< Callback is not called for input as long as the one it was too slow for. */
+	};
 	typedef std::vector<Color> colors_t;
 	typedef std::vector<std::string> completions_t;
 	typedef std::vector<std::string> hints_t;
@@ -203,6 +250,18 @@ public:
 	 */
 	typedef std::function<void ( std::string const& input, colors_t& colors )> highlighter_callback_t;
 
+	/*! \brief Callback budget diagnostics handler type definition.
+	 *
+	 * Handler is invoked from within \e input() after every call of a budgeted
+	 * callback that took longer than its budget, it must not call back into replxx.
+	 *
+	 * \param callback - callback that exceeded its budget.
+	 * \param degradation - degradation of the callback in effect after this call.
+	 * \param duration - duration of the call in microseconds.
+	 * \param bufferLength - number of code points in input buffer.
+	 */
+	typedef std::function<void ( BUDGETED_CALLBACK callback, CALLBACK_DEGRADATION degradation, int long long duration, int bufferLength )> callback_budget_handler_t;
+
 	/*! \brief Hints callback type definition.
 	 *
 	 * \e contextLen is counted in Unicode code points (not in bytes!).
@@ -224,6 +283,180 @@ public:
 	 */
 	typedef std::function<hints_t ( std::string const& input, int& contextLen, Color& color )> hint_callback_t;
 
+	/*! \brief Read only view of UTF-8 encoded text owned by replxx.
+	 *
+	 * View is valid only until the callback it was passed to returns.
+	 * Viewed text is always followed by a terminating NUL.
+	 */
+	class StringView {
+		char const* _data;
+		int _size;
+	public:
+		StringView( char const* data_, int size_ )
+			: _data( data_ )
+			, _size( size_ ) {
+		}
+		char const* data( void ) const {
+			return ( _data );
+		}
+		/*! \brief Length of the text in bytes (not in code points!). */
+		int size( void ) const {
+			return ( _size );
+		}
+		std::string str( void ) const {
+			return ( std::string( _data, static_cast<size_t>( _size ) ) );
+		}
+	};
+
+	/*! \brief Output sink for completions and hints.
+	 *
+	 * Candidates are copied once into a single buffer owned by replxx,
+	 * replxx converts only the candidates it actually displays.
+	 */
+	class Candidates {
+		std::string _text;
+		std::vector<int> _offsets;
+	public:
+		Candidates( void );
+		/*! \brief Add an UTF-8 encoded candidate. */
+		void add( char const* text, int size );
+		void add( char const* text );
+		void add( std::string const& text );
+		int size( void ) const;
+		StringView get( int index ) const;
+		void clear( void );
+	};
+
+	/*! \brief Prefix search index over a fixed vocabulary.
+	 *
+	 * Words are kept sorted in a single buffer, prefix queries are answered
+	 * with binary search in O(k log n + matches) without calling any user
+	 * callback, common prefix of all matches is computed from the first
+	 * and the last match only.
+	 *
+	 * Index can be used by replxx directly (see \e set_completion_index())
+	 * or queried from user completion callback.
+	 *
+	 * Words added one by one are sorted on first query, concurrent queries
+	 * of one index (e.g. from many Replxx instances) are safe, adding words
+	 * while index is being queried is not.
+	 */
+	class CompletionIndex {
+	public:
+		class CompletionIndexImpl;
+	private:
+		typedef std::unique_ptr<CompletionIndexImpl, void (*)( CompletionIndexImpl* )> impl_t;
+		impl_t _impl;
+	public:
+		CompletionIndex( void );
+		CompletionIndex( CompletionIndex&& ) = default;
+		CompletionIndex& operator = ( CompletionIndex&& ) = default;
+		/*! \brief Add an UTF-8 encoded word to the index. */
+		void add( char const* word, int size );
+		void add( char const* word );
+		void add( std::string const& word );
+		/*! \brief Add words from a file, one word per line.
+		 *
+		 * \return 0 on success, -1 if the file could not be read.
+		 */
+		int load( std::string const& filename );
+		/*! \brief Number of distinct words in the index. */
+		int size( void ) const;
+		void clear( void );
+		/*! \brief Add all words starting with \e prefix to \e completions, in sorted order.
+		 *
+		 * \return number of words added.
+		 */
+		int complete( StringView prefix, Candidates& completions ) const;
+		/*! \brief Length (in bytes) of prefix common to all words starting with \e prefix.
+		 *
+		 * \return common prefix length or -1 if no word starts with \e prefix.
+		 */
+		int longest_common_prefix( StringView prefix ) const;
+		/*! \brief Add at most \e maxResults words best matching \e pattern to \e completions, best match first.
+		 *
+		 * Word matches if it contains all characters of \e pattern in the same order,
+		 * see \e set_fuzzy_completion().
+		 *
+		 * \return number of words added.
+		 */
+		int complete_fuzzy( StringView pattern, Candidates& completions, int maxResults ) const;
+	};
+
+	/*! \brief Completions callback type definition, variant without copies.
+	 *
+	 * Same as \e completion_callback_t but \e input is a view of replxx's own
+	 * buffer and completions are added to \e completions sink instead of
+	 * being returned in a newly allocated container.
+	 *
+	 * \param input - UTF-8 encoded input entered by the user until current cursor position.
+	 * \param[in,out] contextLen - length of the additional context to provide while displaying completions.
+	 * \param completions - output sink for user completions.
+	 */
+	typedef std::function<void ( StringView input, int& contextLen, Candidates& completions )> completion_view_callback_t;
+
+	/*! \brief Highlighter callback type definition, variant without copies.
+	 *
+	 * Same as \e highlighter_callback_t but \e input is a view of replxx's own buffer.
+	 *
+	 * \param input - an UTF-8 encoded input entered by the user so far.
+	 * \param colors - output buffer for color information.
+	 */
+	typedef std::function<void ( StringView input, colors_t& colors )> highlighter_view_callback_t;
+
+	/*! \brief Hints callback type definition, variant without copies.
+	 *
+	 * Same as \e hint_callback_t but \e input is a view of replxx's own
+	 * buffer and hints are added to \e hints sink.
+	 *
+	 * \param input - UTF-8 encoded input entered by the user until current cursor position.
+	 * \param contextLen[in,out] - length of the additional context to provide while displaying hints.
+	 * \param color - a color used for displaying hints.
+	 * \param hints - output sink for possible hints.
+	 */
+	typedef std::function<void ( StringView input, int& contextLen, Color& color, Candidates& hints )> hint_view_callback_t;
+
+	/*! \brief Pending request for completions, handed to asynchronous completion callback.
+	 *
+	 * Completer may fill the request from any thread, in batches,
+	 * replxx shows candidates received so far while waiting for more.
+	 * Request is cancelled if user presses any key other than Tab
+	 * before the request is finished, Tab stops waiting and completes
+	 * with candidates received so far.
+	 */
+	class CompletionRequest {
+	public:
+		virtual ~CompletionRequest( void ) {}
+		/*! \brief UTF-8 encoded input entered by the user until current cursor position. */
+		virtual std::string const& input( void ) const = 0;
+		/*! \brief Length of the context in code points, length of word before cursor by default. */
+		virtual int context_length( void ) const = 0;
+		/*! \brief Change length of the context, must be called before first candidates are added. */
+		virtual void set_context_length( int contextLen ) = 0;
+		/*! \brief Add an UTF-8 encoded candidate.
+		 *
+		 * \return false if request was cancelled and completer should stop.
+		 */
+		virtual bool add( char const* text, int size ) = 0;
+		/*! \brief Add a batch of candidates.
+		 *
+		 * \return false if request was cancelled and completer should stop.
+		 */
+		virtual bool add( Candidates const& batch ) = 0;
+		/*! \brief Tell replxx no more candidates will be added. */
+		virtual void finish( void ) = 0;
+		virtual bool is_cancelled( void ) const = 0;
+	};
+
+	/*! \brief Asynchronous completions callback type definition.
+	 *
+	 * Callback is called from the thread that reads user input, it should
+	 * return promptly and fill \e request, possibly from other thread.
+	 *
+	 * \param request - request to fill with completions and to finish.
+	 */
+	typedef std::function<void ( std::shared_ptr<CompletionRequest> const& request )> async_completion_callback_t;
+
 	/*! \brief Key press handler type definition.
 	 *
 	 * \param code - the key code replxx got from terminal.
@@ -231,6 +464,141 @@ public:
 	 */
 	typedef std::function<ACTION_RESULT ( char32_t code )> key_press_handler_t;
 
+	/*! \brief Sequence of key press codes, e.g. `C-x C-e`.
+	 */
+	typedef std::vector<char32_t> key_sequence_t;
+
+	/*! \brief Terminal replxx reads key presses from and draws on.
+	 *
+	 * Replxx uses standard input and output by default,
+	 * custom backend can be installed with \e set_terminal().
+	 * Backend deals in raw bytes only, escape sequences
+	 * and UTF-8 are decoded and encoded by replxx.
+	 */
+	class TerminalBackend {
+		std::function<void ( void )> _inputNotifier;
+	public:
+		TerminalBackend( void )
+			: _inputNotifier() {
+		}
+		virtual ~TerminalBackend( void ) {}
+		/*! \brief Read at most \e size bytes of input, block until some input is available.
+		 *
+		 * Returning -1 with \e errno set to \e EINTR tells replxx that screen size
+		 * has changed and the line should be redrawn.
+		 *
+		 * \return Number of bytes read, 0 on end of input, -1 on error.
+		 */
+		virtual int read( char* data, int size ) = 0;
+		/*! \brief Write \e size bytes of output.
+		 *
+		 * \return Number of bytes written, -1 on error.
+		 */
+		virtual int write( char const* data, int size ) = 0;
+		/*! \brief Check if \e read() would not block. */
+		virtual bool input_ready( void ) = 0;
+		/*! \brief File descriptor that becomes readable when input is available.
+		 *
+		 * \return File descriptor or -1 if backend has none, replxx then relies on \e input_ready()
+		 * and on the backend calling \e notify_input() whenever input becomes available.
+		 */
+		virtual int input_fd( void ) {
+			return ( -1 );
+		}
+		virtual int screen_columns( void ) = 0;
+		virtual int screen_rows( void ) = 0;
+		/*! \brief Switch terminal to raw mode, called when line editing starts.
+		 *
+		 * \return 0 on success, -1 on failure with \e errno set.
+		 */
+		virtual int enable_raw_mode( void ) = 0;
+		virtual void disable_raw_mode( void ) = 0;
+		/*! \brief Set by replxx when backend is installed, called by \e notify_input(). */
+		void set_input_notifier( std::function<void ( void )> const& notifier ) {
+			_inputNotifier = notifier;
+		}
+	protected:
+		/*! \brief Wake up replxx waiting for input, may be called from any thread. */
+		void notify_input( void ) {
+			if ( !! _inputNotifier ) {
+				_inputNotifier();
+			}
+		}
+	};
+
+	/*! \brief In-memory terminal emulator.
+	 *
+	 * Input is fed by the caller, output is interpreted as a VT100 compatible
+	 * terminal would do it (cursor movement, erasing, colors, line wrapping and scrolling)
+	 * and kept in a grid of cells that can be inspected afterwards.
+	 * Allows driving replxx in-process, e.g. from tests, benchmarks and fuzzers.
+	 * Once fed input is exhausted reads report end of input.
+	 */
+	class VirtualTerminal : public TerminalBackend {
+	public:
+		struct Cell {
+			char32_t character; /*!< 0 for the second cell of a double width character. */
+			Color color;
+		};
+	private:
+		int _columns;
+		int _rows;
+		std::vector<Cell> _cells;
+		std::string _input;
+		std::string::size_type _inputPos;
+		int _x;
+		int _y;
+		bool _wrapPending;     // cursor is past the last column
+		Color _color;
+		bool _bold;
+		bool _background;
+		std::string _sequence; // escape sequence being parsed
+		int _utf8Pending;
+		char32_t _utf8CodePoint;
+		int long long _bytesWritten;
+		int _bells;
+		bool _rawMode;
+	public:
+		VirtualTerminal( int columns = 80, int rows = 24 );
+		/*! \brief Append bytes to terminal input, e.g. "abc\033[D\r". */
+		void feed( char const* data, int size );
+		void feed( std::string const& data );
+		/*! \brief Number of fed bytes not read yet. */
+		int pending_input( void ) const;
+		/*! \brief Change screen size, screen is cleared. */
+		void resize( int columns, int rows );
+		/*! \brief Clear screen, move cursor home and reset statistics, pending input is kept. */
+		void reset( void );
+		int columns( void ) const;
+		int rows( void ) const;
+		Cell const& cell( int x, int y ) const;
+		/*! \brief UTF-8 encoded content of screen row \e y, without trailing blanks. */
+		std::string line( int y ) const;
+		/*! \brief All screen rows separated with newlines, without trailing blank rows. */
+		std::string screen( void ) const;
+		int cursor_x( void ) const;
+		int cursor_y( void ) const;
+		/*! \brief Number of bytes written to terminal since last \e reset(). */
+		int long long bytes_written( void ) const;
+		/*! \brief Number of bell characters written to terminal since last \e reset(). */
+		int bells( void ) const;
+		bool is_raw_mode( void ) const;
+		int read( char* data, int size ) override;
+		int write( char const* data, int size ) override;
+		bool input_ready( void ) override;
+		int screen_columns( void ) override;
+		int screen_rows( void ) override;
+		int enable_raw_mode( void ) override;
+		void disable_raw_mode( void ) override;
+	private:
+		void put( char32_t );
+		void control( char );
+		void execute( void );
+		void set_attributes( std::vector<int> const& );
+		void line_feed( void );
+		void erase( int from, int to );
+	};
+
 	class ReplxxImpl;
 private:
 	typedef std::unique_ptr<ReplxxImpl, void (*)( ReplxxImpl* )> impl_t;
@@ -259,6 +627,49 @@ public:
 	 */
 	void set_hint_callback( hint_callback_t const& fn );
 
+	/*! \brief Register completion callback that works on views of replxx's buffers.
+	 *
+	 * Replaces callback registered with \e set_completion_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 */
+	void set_completion_view_callback( completion_view_callback_t const& fn );
+
+	/*! \brief Complete words from given index instead of calling completion callback.
+	 *
+	 * Word before cursor (as delimited by word break characters) is looked up in the index.
+	 * Index is not copied, it must outlive its use by replxx.
+	 *
+	 * \param index - index to complete from, nullptr restores use of completion callback.
+	 */
+	void set_completion_index( CompletionIndex const* index );
+
+	/*! \brief Register asynchronous completion callback.
+	 *
+	 * Asynchronous callback is used instead of callback registered with
+	 * \e set_completion_callback(), user can keep typing while completions
+	 * are being computed.
+	 *
+	 * \param fn - user defined callback function, nullptr restores use of completion callback.
+	 */
+	void set_async_completion_callback( async_completion_callback_t const& fn );
+
+	/*! \brief Register highlighter callback that works on views of replxx's buffers.
+	 *
+	 * Replaces callback registered with \e set_highlighter_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 */
+	void set_highlighter_view_callback( highlighter_view_callback_t const& fn );
+
+	/*! \brief Register hints callback that works on views of replxx's buffers.
+	 *
+	 * Replaces callback registered with \e set_hint_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 */
+	void set_hint_view_callback( hint_view_callback_t const& fn );
+
 	/*! \brief Read line of user input.
 	 *
 	 * \param prompt - prompt to be displayed before getting user input.
@@ -266,6 +677,103 @@ public:
 	 */
 	char const* input( std::string const& prompt );
 
+	/*! \brief Start non-blocking, step-wise line editing session.
+	 *
+	 * Displays the prompt and switches terminal to raw mode,
+	 * user input is then processed by calls to \e process_input()
+	 * whenever \e input_fd() or \e event_fd() becomes readable,
+	 * so replxx can be driven from application's own event loop.
+	 *
+	 * Step-wise sessions are available only on POSIX terminals,
+	 * use \e input() if this function fails.
+	 *
+	 * \param prompt - prompt to be displayed before getting user input.
+	 * \return True iff session was started, on failure \e errno is set.
+	 */
+	bool start_input( std::string const& prompt );
+
+	/*! \brief Process user input that is available without blocking.
+	 *
+	 * Should be called when \e input_fd() or \e event_fd() is readable
+	 * and after SIGWINCH was received.
+	 * Modal sub-modes (completion pager, incremental history search)
+	 * still wait for user input until they are finished.
+	 *
+	 * \param line - set to UTF-8 encoded input given by the user
+	 * if \e INPUT_STATUS::COMPLETE is returned, nullptr otherwise.
+	 * \return State of the editing session, session is finished
+	 * unless \e INPUT_STATUS::EDITING is returned.
+	 */
+	INPUT_STATUS process_input( char const*& line );
+
+	/*! \brief Use custom terminal backend instead of standard input and output.
+	 *
+	 * Backend is not owned by replxx and must outlive it or be replaced,
+	 * it must not be changed while a line is being edited.
+	 * Custom backends are not supported on Windows.
+	 *
+	 * \param terminal - backend to use, nullptr restores standard input and output.
+	 * \return 0 on success, -1 if custom backends are not supported.
+	 */
+	int set_terminal( TerminalBackend* terminal );
+
+	/*! \brief Use given file descriptors as terminal instead of standard input and output.
+	 *
+	 * Each Replxx instance keeps all of its editing state to itself,
+	 * so one process can serve many independent sessions, e.g. on pseudo terminals
+	 * or sockets, every session driven by its own thread or event loop.
+	 * Raw mode is enabled on \e in when it is a terminal, for other descriptors
+	 * it is up to the remote side. Descriptors are not closed by replxx.
+	 * SIGWINCH only concerns standard terminal, screen size changes
+	 * of other sessions are reported with \e window_changed().
+	 *
+	 * \param in - descriptor to read key presses from.
+	 * \param out - descriptor to draw on.
+	 * \return 0 on success, -1 if descriptors are invalid or not supported (on Windows).
+	 */
+	int set_terminal_fds( int in, int out );
+
+	/*! \brief Tell replxx that screen size of its terminal has changed.
+	 *
+	 * Line being edited is redrawn for new size, may be called from any thread.
+	 */
+	void window_changed( void );
+
+	/*! \brief Record terminal input and screen size changes to a session file.
+	 *
+	 * Raw input bytes are stored with timestamps exactly as read from the terminal,
+	 * so the session can be replayed later (see \e replxx-replay benchmark tool)
+	 * to reproduce latency problems from real workloads.
+	 * Session recording is not supported on Windows.
+	 *
+	 * \param filename - path of session file, empty string stops recording.
+	 * \return 0 on success, -1 if file cannot be created or recording is not supported.
+	 */
+	int set_session_recording( std::string const& filename );
+
+	/*! \brief Get file descriptor of terminal input.
+	 *
+	 * \return File descriptor to watch for readability, or -1 if not supported.
+	 */
+	int input_fd( void ) const;
+
+	/*! \brief Get file descriptor signaled by \e print() and \e emulate_key_press() called from other threads.
+	 *
+	 * \return File descriptor to watch for readability, or -1 if not supported.
+	 */
+	int event_fd( void ) const;
+
+	/*! \brief Get time after which \e process_input() has work to do even if no input arrives.
+	 *
+	 * Event loop driving step-wise session should use it as a timeout
+	 * when waiting for \e input_fd() and \e event_fd(), and call \e process_input()
+	 * when it expires, e.g. to finish pending key sequence or to print messages
+	 * deferred by \e set_max_redraw_rate().
+	 *
+	 * \return Timeout in milliseconds, -1 if there is nothing to wait for.
+	 */
+	int next_timeout( void ) const;
+
 	/*! \brief Print formatted string to standard output.
 	 *
 	 * This function ensures proper handling of ANSI escape sequences
@@ -299,6 +807,28 @@ public:
 	 */
 	void bind_key( char32_t code, key_press_handler_t handler );
 
+	/*! \brief Bind user defined action to handle given sequence of key-press events.
+	 *
+	 * After a key that starts some bound sequence replxx waits for the following keys.
+	 * If the keys received do not form any bound sequence, or if the next key does not
+	 * arrive within key sequence timeout, the keys received so far are processed one by one
+	 * (or by the handler bound to the sequence received so far, if there is one).
+	 *
+	 * \param keys - handle this sequence of key-press events with following handler.
+	 * \param handler - use this handler to handle the sequence, it gets the last key code.
+	 */
+	void bind_key_sequence( key_sequence_t const& keys, key_press_handler_t handler );
+
+	/*! \brief Set how long to wait for the next key of a key sequence.
+	 *
+	 * When used with process_input() the event loop learns the deadline from \e next_timeout(),
+	 * step-wise session also waits this long for the rest of a terminal escape sequence
+	 * before it takes ESC for a key press of its own.
+	 *
+	 * \param milliseconds - timeout in milliseconds, 0 means wait indefinitely, default is 1000.
+	 */
+	void set_key_sequence_timeout( int milliseconds );
+
 	void history_add( std::string const& line );
 	int history_save( std::string const& filename );
 	int history_load( std::string const& filename );
@@ -319,6 +849,53 @@ public:
 	 */
 	void set_completion_count_cutoff( int count );
 
+	/*! \brief Cache completions returned by completion callback.
+	 *
+	 * When user types more characters of the word completions were
+	 * returned for, cached completions are filtered locally instead of
+	 * calling completion callback again.
+	 * Cache works only with callbacks that return completions starting
+	 * with the completion context.
+	 *
+	 * \param milliseconds - how long cached completions are used,
+	 * 0 disables cache (default), negative value means cached completions do not expire.
+	 */
+	void set_completion_cache_ttl( int milliseconds );
+
+	/*! \brief Show ambiguous completions in an interactive menu.
+	 *
+	 * Instead of listing all completions, a selectable menu showing
+	 * at most \e rows completions at a time is drawn below the input.
+	 * Up/Down/Tab move selection, PageUp/PageDown move by page,
+	 * Enter picks selected completion, Escape closes the menu,
+	 * typing filters completions.
+	 * Menu is not used if colors are disabled.
+	 *
+	 * \param rows - maximum number of rows of the menu, 0 disables the menu (default).
+	 */
+	void set_completion_menu( int rows );
+
+	/*! \brief Rank completions by fuzzy matching against completion context.
+	 *
+	 * Completion matches if it contains all characters of the context
+	 * in the same order (ASCII case insensitive), matches at word
+	 * boundaries (after separators, camelCase humps) and consecutive
+	 * matches rank higher. Completion callback should return all
+	 * candidates applicable in given context, not only those starting
+	 * with the context; completion index is searched as a whole.
+	 * Completion cache is not used in this mode.
+	 *
+	 * \param maxResults - number of best matching completions to keep, 0 disables fuzzy matching (default).
+	 */
+	void set_fuzzy_completion( int maxResults );
+
+	/*! \brief Drop cached completions.
+	 *
+	 * Call it when data completions come from changes,
+	 * it is safe to call it from any thread.
+	 */
+	void invalidate_completion_cache( void );
+
 	/*! \brief Set maximum number of displayed hint rows.
 	 */
 	void set_max_hint_rows( int count );
@@ -347,9 +924,102 @@ public:
 	 */
 	void set_no_color( bool val );
 
+	/*! \brief Limit how often the prompt is redrawn due to messages printed from other threads.
+	 *
+	 * Messages printed in between redraws are shown together with a single redraw.
+	 * Step-wise session learns when deferred messages are due from \e next_timeout().
+	 *
+	 * \param rate - maximum number of redraws per second, 0 means no limit (default).
+	 */
+	void set_max_redraw_rate( int rate );
+
+	/*! \brief Set time budget of a callback called on every refresh.
+	 *
+	 * Callback that exceeds its budget in several consecutive calls is degraded
+	 * one \e CALLBACK_DEGRADATION level further, degradation is kept
+	 * until budget is set again. Idle period debouncing needs \e input(),
+	 * with \e process_input() debounced callbacks run as soon as no input is waiting.
+	 *
+	 * \param callback - callback to set budget for.
+	 * \param microseconds - budget of a single call, 0 means unlimited (default).
+	 */
+	void set_callback_budget( BUDGETED_CALLBACK callback, int microseconds );
+
+	/*! \brief Set idle period after which debounced callbacks are called.
+	 *
+	 * \param milliseconds - time without input before debounced callbacks are called, default is 100.
+	 */
+	void set_callback_idle_period( int milliseconds );
+
+	/*! \brief Register handler notified about callbacks exceeding their time budgets.
+	 */
+	void set_callback_budget_handler( callback_budget_handler_t const& handler );
+
+	/*! \brief Get degradation currently applied to given callback.
+	 */
+	CALLBACK_DEGRADATION callback_degradation( BUDGETED_CALLBACK callback ) const;
+
 	/*! \brief Set maximum number of entries in history list.
 	 */
 	void set_max_history_size( int len );
+
+	/*! \brief Set memory limit for undo log of currently edited line.
+	 *
+	 * Oldest changes are forgotten once the log exceeds the limit.
+	 *
+	 * \param bytes - memory limit in bytes, 0 disables undo, default is 64 KiB.
+	 */
+	void set_max_undo_size( int bytes );
+
+	/*! \brief Set maximum number of entries in kill ring.
+	 *
+	 * \param count - maximum number of killed texts remembered, 0 disables kill ring, default is 10.
+	 */
+	void set_max_kill_ring_size( int count );
+
+	/*! \brief Set memory limit for kill ring.
+	 *
+	 * Oldest killed texts are forgotten once the ring exceeds the limit,
+	 * the most recently killed text is always kept.
+	 *
+	 * \param bytes - memory limit in bytes, default is 1 MiB.
+	 */
+	void set_max_kill_ring_bytes( int bytes );
+
+	/*! \brief Copy killed text to system clipboard.
+	 *
+	 * Clipboard is set with OSC 52 terminal escape sequence, it works only
+	 * with terminals that support it (and allow it).
+	 *
+	 * \param val - copy killed text to system clipboard, disabled by default.
+	 */
+	void set_kill_ring_clipboard( bool val );
+
+	/*! \brief Enable or disable latency instrumentation.
+	 *
+	 * When enabled, durations of key press processing phases are recorded
+	 * in histograms that can be read at any time, from any thread.
+	 *
+	 * \param val - measure latencies, disabled by default.
+	 */
+	void set_latency_instrumentation( bool val );
+
+	/*! \brief Get snapshot of latency histogram of given phase.
+	 */
+	LatencyHistogram latency_histogram( LATENCY_PHASE phase ) const;
+
+	void reset_latency_histograms( void );
+
+	/*! \brief Get human readable summary of all latency histograms.
+	 */
+	std::string latency_report( void ) const;
+
+	/*! \brief Write latency summary to given file when replxx is destroyed.
+	 *
+	 * \param filename - file to write to, empty name disables the summary.
+	 */
+	void set_latency_report_file( std::string const& filename );
+
 	void clear_screen( void );
 	int install_window_change_handler( void );
 
@@ -0,0 +1,71 @@
+#ifndef REPLXX_CALLBACKBUDGET_HXX_INCLUDED
+#define REPLXX_CALLBACKBUDGET_HXX_INCLUDED 1
+
+#include <chrono>
+
+#include "replxx.hxx"
+
+namespace replxx {
+
+// Time budget of a callback called on every refresh of the input line.
+//
+// Every OVERRUN_LIMIT consecutive calls over the budget move the callback
+// one degradation level further, a call within budget resets the count.
+// Degradation is never lifted automatically, only by setting a new budget.
+class CallbackBudget {
+public:
+	typedef std::chrono::steady_clock clock_t;
+	static int const OVERRUN_LIMIT = 3;
+private:
+	int long long _budget; // microseconds, 0 means unlimited
+	Replxx::CALLBACK_DEGRADATION _degradation;
+	int _overruns;
+	int _largeBuffer; // callback is off for buffers at least this long
+public:
+	CallbackBudget( void )
+		: _budget( 0 )
+		, _degradation( Replxx::CALLBACK_DEGRADATION::NONE )
+		, _overruns( 0 )
+		, _largeBuffer( 0 ) {
+	}
+	void set( int long long budget_ ) {
+		_budget = budget_ > 0 ? budget_ : 0;
+		_degradation = Replxx::CALLBACK_DEGRADATION::NONE;
+		_overruns = 0;
+		_largeBuffer = 0;
+	}
+	bool is_set( void ) const {
+		return ( _budget > 0 );
+	}
+	Replxx::CALLBACK_DEGRADATION degradation( void ) const {
+		return ( _degradation );
+	}
+	bool is_off_for( int bufferLength_ ) const {
+		return ( ( _degradation == Replxx::CALLBACK_DEGRADATION::LARGE_BUFFER_OFF ) && ( bufferLength_ >= _largeBuffer ) );
+	}
+	// Account a call that started at start_, returns its duration in microseconds
+	// if it was over the budget and -1 otherwise.
+	int long long account( clock_t::time_point start_, int bufferLength_ ) {
+		int long long duration( std::chrono::duration_cast<std::chrono::microseconds>( clock_t::now() - start_ ).count() );
+		if ( duration <= _budget ) {
+			_overruns = 0;
+			return ( -1 );
+		}
+		++ _overruns;
+		if ( _overruns >= OVERRUN_LIMIT ) {
+			_overruns = 0;
+			if ( _degradation != Replxx::CALLBACK_DEGRADATION::LARGE_BUFFER_OFF ) {
+				_degradation = static_cast<Replxx::CALLBACK_DEGRADATION>( static_cast<int>( _degradation ) + 1 );
+				_largeBuffer = bufferLength_;
+			} else if ( bufferLength_ < _largeBuffer ) {
+				_largeBuffer = bufferLength_;
+			}
+		}
+		return ( duration );
+	}
+};
+
+}
+
+#endif
+
@@ -0,0 +1,118 @@
+#ifndef REPLXX_CANDIDATES_HXX_INCLUDED
+#define REPLXX_CANDIDATES_HXX_INCLUDED 1
+
+#include <vector>
+#include <algorithm>
+
+#include "replxx.hxx"
+#include "conversion.hxx"
+#include "unicodestring.hxx"
+
+namespace replxx {
+
+// Completions or hints returned by user callback.
+//
+// Candidates stay in UTF-8 in the sink user callback filled, a candidate
+// is converted to UTF-32 on first access only, so for a long list only
+// candidates that end up on the screen are ever converted.
+// Lengths and common prefix are computed on UTF-8 bytes directly.
+class CandidateList {
+	typedef std::vector<UnicodeString> decoded_t;
+	Replxx::Candidates _candidates;
+	mutable decoded_t _decoded;
+	mutable std::vector<bool> _isDecoded;
+	int _commonPrefix; // in bytes, -1 if not known up front
+public:
+	CandidateList( void )
+		: _candidates()
+		, _decoded()
+		, _isDecoded()
+		, _commonPrefix( -1 ) {
+	}
+	// Sink for user callback, drops previous candidates.
+	Replxx::Candidates& sink( void ) {
+		_candidates.clear();
+		_decoded.clear();
+		_isDecoded.clear();
+		_commonPrefix = -1;
+		return ( _candidates );
+	}
+	// Sink for candidates that arrive in batches, keeps previous candidates.
+	Replxx::Candidates& append_sink( void ) {
+		_decoded.clear();
+		_isDecoded.clear();
+		_commonPrefix = -1;
+		return ( _candidates );
+	}
+	// Common prefix (in bytes) already known by the source of candidates.
+	void set_common_prefix( int bytes_ ) {
+		_commonPrefix = bytes_;
+	}
+	// Candidates as returned by user callback.
+	Replxx::Candidates const& candidates( void ) const {
+		return ( _candidates );
+	}
+	int size( void ) const {
+		return ( _candidates.size() );
+	}
+	bool empty( void ) const {
+		return ( _candidates.size() == 0 );
+	}
+	UnicodeString const& operator[]( int index_ ) const {
+		if ( _isDecoded.empty() ) {
+			_decoded.resize( _candidates.size() );
+			_isDecoded.resize( _candidates.size() );
+		}
+		if ( ! _isDecoded[index_] ) {
+			_decoded[index_] = UnicodeString( _candidates.get( index_ ).data() );
+			_isDecoded[index_] = true;
+		}
+		return ( _decoded[index_] );
+	}
+	// Length of candidate in code points.
+	int length( int index_ ) const {
+		Replxx::StringView c( _candidates.get( index_ ) );
+		return ( code_points( c.data(), c.size() ) );
+	}
+	// Length of prefix common to all candidates in code points.
+	int longest_common_prefix( void ) const {
+		int count( _candidates.size() );
+		if ( count < 1 ) {
+			return ( 0 );
+		}
+		Replxx::StringView sample( _candidates.get( 0 ) );
+		if ( _commonPrefix >= 0 ) {
+			return ( code_points( sample.data(), _commonPrefix ) );
+		}
+		int prefix( sample.size() );
+		for ( int i( 1 ); ( i < count ) && ( prefix > 0 ); ++ i ) {
+			Replxx::StringView c( _candidates.get( i ) );
+			int len( std::min( prefix, c.size() ) );
+			int b( 0 );
+			while ( ( b < len ) && ( sample.data()[b] == c.data()[b] ) ) {
+				++ b;
+			}
+			prefix = b;
+		}
+		// do not split a multi-byte character
+		while ( ( prefix > 0 ) && ( prefix < sample.size() ) && ! is_lead_byte( sample.data()[prefix] ) ) {
+			-- prefix;
+		}
+		return ( code_points( sample.data(), prefix ) );
+	}
+private:
+	static int code_points( char const* data_, int size_ ) {
+		int count( 0 );
+		for ( int i( 0 ); i < size_; ++ i ) {
+			if ( is_lead_byte( data_[i] ) ) {
+				++ count;
+			}
+		}
+		return ( count );
+	}
+};
+
+}
+
+#endif
+
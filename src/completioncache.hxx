@@ -0,0 +1,116 @@
+#ifndef REPLXX_COMPLETIONCACHE_HXX_INCLUDED
+#define REPLXX_COMPLETIONCACHE_HXX_INCLUDED 1
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstring>
+
+#include "replxx.hxx"
+#include "conversion.hxx"
+#include "candidates.hxx"
+
+namespace replxx {
+
+// Last completion list returned by user callback.
+//
+// When user types more characters of the same word the cached list is
+// filtered locally instead of calling the callback again, this assumes
+// the callback returns candidates that start with completion context.
+// Cached list is dropped after TTL expires or after invalidate(),
+// invalidate() may be called from any thread.
+class CompletionCache {
+	typedef std::chrono::steady_clock clock_t;
+	std::string _input;      // input the list was returned for
+	int _wordLen;            // word length before cursor (in code points) for _input
+	int _contextLen;         // context length returned by user callback
+	int _contextStart;       // byte offset of context in _input
+	Replxx::Candidates _candidates;
+	clock_t::time_point _time;
+	int _generation;
+	bool _valid;
+	std::atomic<int> _currentGeneration;
+public:
+	CompletionCache( void )
+		: _input()
+		, _wordLen( 0 )
+		, _contextLen( 0 )
+		, _contextStart( 0 )
+		, _candidates()
+		, _time()
+		, _generation( 0 )
+		, _valid( false )
+		, _currentGeneration( 0 ) {
+	}
+	// Generation to be passed to store(), must be taken before calling user callback.
+	int generation( void ) const {
+		return ( _currentGeneration.load() );
+	}
+	void invalidate( void ) {
+		++ _currentGeneration;
+	}
+	void store( std::string const& input_, int wordLen_, int contextLen_, CandidateList const& completions_, int generation_ ) {
+		_input.assign( input_ );
+		_wordLen = wordLen_;
+		_contextLen = contextLen_;
+		_contextStart = static_cast<int>( _input.length() );
+		for ( int i( 0 ); ( i < contextLen_ ) && ( _contextStart > 0 ); ) {
+			-- _contextStart;
+			if ( is_lead_byte( _input[_contextStart] ) ) {
+				++ i;
+			}
+		}
+		_candidates = completions_.candidates();
+		_time = clock_t::now();
+		_generation = generation_;
+		_valid = true;
+	}
+	// Fill completions_ from cache if input_ only extends word cached list was returned for.
+	// wordLen_ is word length before cursor for input_, contextLen_ is set as user callback would.
+	bool lookup( std::string const& input_, int wordLen_, int& contextLen_, int ttl_, CandidateList& completions_ ) {
+		if ( ! _valid ) {
+			return ( false );
+		}
+		if (
+			( _generation != _currentGeneration.load() )
+			|| ( ( ttl_ >= 0 ) && ( clock_t::now() - _time > std::chrono::milliseconds( ttl_ ) ) )
+		) {
+			clear();
+			return ( false );
+		}
+		if ( ( input_.length() < _input.length() ) || ( input_.compare( 0, _input.length(), _input ) != 0 ) ) {
+			return ( false );
+		}
+		int extra( 0 );
+		for ( std::string::size_type i( _input.length() ); i < input_.length(); ++ i ) {
+			if ( is_lead_byte( input_[i] ) ) {
+				++ extra;
+			}
+		}
+		// word break typed since, it is a different word now
+		if ( wordLen_ != ( _wordLen + extra ) ) {
+			return ( false );
+		}
+		char const* prefix( input_.c_str() + _contextStart );
+		size_t prefixLen( input_.length() - static_cast<size_t>( _contextStart ) );
+		Replxx::Candidates& out( completions_.sink() );
+		for ( int i( 0 ), count( _candidates.size() ); i < count; ++ i ) {
+			Replxx::StringView c( _candidates.get( i ) );
+			if ( ( static_cast<size_t>( c.size() ) >= prefixLen ) && ( memcmp( c.data(), prefix, prefixLen ) == 0 ) ) {
+				out.add( c.data(), c.size() );
+			}
+		}
+		contextLen_ = _contextLen + extra;
+		return ( true );
+	}
+	void clear( void ) {
+		_valid = false;
+		_input.clear();
+		_candidates.clear();
+	}
+};
+
+}
+
+#endif
+
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+
+#include "replxx.hxx"
+#include "conversion.hxx"
+#include "fuzzymatcher.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+// Orders words against a prefix: word is "equal" to prefix if it starts with it.
+class PrefixCompare {
+	char const* _words;
+	size_t _prefixLen;
+public:
+	PrefixCompare( char const* words_, size_t prefixLen_ )
+		: _words( words_ )
+		, _prefixLen( prefixLen_ ) {
+	}
+	bool operator()( int word_, char const* prefix_ ) const {
+		return ( strncmp( _words + word_, prefix_, _prefixLen ) < 0 );
+	}
+	bool operator()( char const* prefix_, int word_ ) const {
+		return ( strncmp( prefix_, _words + word_, _prefixLen ) < 0 );
+	}
+};
+
+}
+
+// Words are kept in one buffer, each NUL terminated, so they can be compared in place.
+class Replxx::CompletionIndex::CompletionIndexImpl {
+public:
+	std::string _words;
+	mutable std::vector<int> _offsets;
+	mutable std::vector<uint64_t> _masks; // characters present in each word, for fuzzy search
+	mutable std::atomic<bool> _sorted;
+	mutable std::mutex _sortMutex;
+public:
+	CompletionIndexImpl( void )
+		: _words()
+		, _offsets()
+		, _masks()
+		, _sorted( true )
+		, _sortMutex() {
+	}
+	char const* word( int index_ ) const {
+		return ( _words.data() + _offsets[index_] );
+	}
+	void sort( void ) const;
+	void range( StringView prefix, int& first, int& last ) const;
+};
+
+namespace {
+void delete_CompletionIndexImpl( Replxx::CompletionIndex::CompletionIndexImpl* impl_ ) {
+	delete impl_;
+}
+}
+
+Replxx::CompletionIndex::CompletionIndex( void )
+	: _impl( new CompletionIndexImpl(), delete_CompletionIndexImpl ) {
+}
+
+void Replxx::CompletionIndex::add( char const* word_, int size_ ) {
+	if ( size_ <= 0 ) {
+		return;
+	}
+	_impl->_offsets.push_back( static_cast<int>( _impl->_words.length() ) );
+	_impl->_words.append( word_, static_cast<size_t>( size_ ) );
+	_impl->_words.push_back( 0 );
+	_impl->_sorted = false;
+}
+
+void Replxx::CompletionIndex::add( char const* word_ ) {
+	add( word_, static_cast<int>( strlen( word_ ) ) );
+}
+
+void Replxx::CompletionIndex::add( std::string const& word_ ) {
+	add( word_.data(), static_cast<int>( word_.length() ) );
+}
+
+int Replxx::CompletionIndex::load( std::string const& filename ) {
+	ifstream wordsFile( filename );
+	if ( ! wordsFile ) {
+		return ( -1 );
+	}
+	string line;
+	while ( getline( wordsFile, line ) ) {
+		string::size_type eol( line.find_first_of( "\r\n" ) );
+		if ( eol != string::npos ) {
+			line.erase( eol );
+		}
+		add( line );
+	}
+	_impl->sort();
+	return ( 0 );
+}
+
+int Replxx::CompletionIndex::size( void ) const {
+	_impl->sort();
+	return ( static_cast<int>( _impl->_offsets.size() ) );
+}
+
+void Replxx::CompletionIndex::clear( void ) {
+	_impl->_words.clear();
+	_impl->_offsets.clear();
+	_impl->_masks.clear();
+	_impl->_sorted = true;
+}
+
+int Replxx::CompletionIndex::complete( StringView prefix_, Candidates& completions_ ) const {
+	int first( 0 );
+	int last( 0 );
+	_impl->range( prefix_, first, last );
+	for ( int i( first ); i < last; ++ i ) {
+		char const* word( _impl->word( i ) );
+		completions_.add( word, static_cast<int>( strlen( word ) ) );
+	}
+	return ( last - first );
+}
+
+int Replxx::CompletionIndex::longest_common_prefix( StringView prefix_ ) const {
+	int first( 0 );
+	int last( 0 );
+	_impl->range( prefix_, first, last );
+	if ( first == last ) {
+		return ( -1 );
+	}
+	// words are sorted so the first and the last match differ the most
+	char const* a( _impl->word( first ) );
+	char const* b( _impl->word( last - 1 ) );
+	int len( 0 );
+	while ( ( a[len] != 0 ) && ( a[len] == b[len] ) ) {
+		++ len;
+	}
+	// do not split a multi-byte character
+	while ( ( len > 0 ) && ( a[len] != 0 ) && ! is_lead_byte( a[len] ) ) {
+		-- len;
+	}
+	return ( len );
+}
+
+int Replxx::CompletionIndex::complete_fuzzy( StringView pattern_, Candidates& completions_, int maxResults_ ) const {
+	_impl->sort();
+	FuzzyMatcher matcher;
+	matcher.set_pattern( pattern_.data(), pattern_.size() );
+	CompletionIndexImpl const& impl( *_impl );
+	for ( int i( 0 ), count( static_cast<int>( impl._offsets.size() ) ); i < count; ++ i ) {
+		// length is needed only for words that get scanned
+		if ( matcher.may_match( impl._masks[i] ) ) {
+			char const* word( impl.word( i ) );
+			matcher.offer( word, static_cast<int>( strlen( word ) ), impl._masks[i], i, maxResults_ );
+		}
+	}
+	return (
+		matcher.take(
+			completions_,
+			[&impl]( int index_ ) {
+				char const* word( impl.word( index_ ) );
+				return ( StringView( word, static_cast<int>( strlen( word ) ) ) );
+			}
+		)
+	);
+}
+
+void Replxx::CompletionIndex::CompletionIndexImpl::sort( void ) const {
+	if ( _sorted.load( std::memory_order_acquire ) ) {
+		return;
+	}
+	// first queries of a shared index may race for sorting it
+	std::lock_guard<std::mutex> l( _sortMutex );
+	if ( _sorted.load( std::memory_order_relaxed ) ) {
+		return;
+	}
+	char const* words( _words.data() );
+	std::sort(
+		_offsets.begin(), _offsets.end(),
+		[words]( int l, int r ) {
+			return ( strcmp( words + l, words + r ) < 0 );
+		}
+	);
+	_offsets.erase(
+		std::unique(
+			_offsets.begin(), _offsets.end(),
+			[words]( int l, int r ) {
+				return ( strcmp( words + l, words + r ) == 0 );
+			}
+		),
+		_offsets.end()
+	);
+	_masks.resize( _offsets.size() );
+	for ( size_t i( 0 ); i < _offsets.size(); ++ i ) {
+		char const* word( words + _offsets[i] );
+		_masks[i] = FuzzyMatcher::text_mask( word, static_cast<int>( strlen( word ) ) );
+	}
+	_sorted.store( true, std::memory_order_release );
+}
+
+void Replxx::CompletionIndex::CompletionIndexImpl::range( StringView prefix_, int& first_, int& last_ ) const {
+	sort();
+	// prefix must be NUL terminated for strncmp()
+	string prefix( prefix_.data(), static_cast<size_t>( prefix_.size() ) );
+	pair<vector<int>::const_iterator, vector<int>::const_iterator> r(
+		equal_range(
+			_offsets.cbegin(), _offsets.cend(), prefix.c_str(),
+			PrefixCompare( _words.data(), prefix.length() )
+		)
+	);
+	first_ = static_cast<int>( r.first - _offsets.cbegin() );
+	last_ = static_cast<int>( r.second - _offsets.cbegin() );
+}
+
+}
+
@@ -0,0 +1,124 @@
+#ifndef REPLXX_COMPLETIONMENU_HXX_INCLUDED
+#define REPLXX_COMPLETIONMENU_HXX_INCLUDED 1
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "candidates.hxx"
+#include "fuzzymatcher.hxx"
+
+namespace replxx {
+
+// Selectable list of completions shown below input line.
+//
+// Menu is a window of at most _rows entries over list of indices of
+// matching completions, only entries in the window are ever rendered,
+// so moving selection, paging and filtering cost O(rows) in rendering
+// regardless of number of completions.
+class CompletionMenu {
+	std::vector<int> _items;   // indices of completions matching filter
+	std::vector<int> _scratch;
+	int _rows;                 // maximum number of visible entries
+	int _top;                  // first visible entry
+	int _selected;
+	int _contextLen;           // completion context length in code points
+	bool _open;
+public:
+	CompletionMenu( void )
+		: _items()
+		, _scratch()
+		, _rows( 0 )
+		, _top( 0 )
+		, _selected( 0 )
+		, _contextLen( 0 )
+		, _open( false ) {
+	}
+	void open( int count_, int rows_, int contextLen_ ) {
+		_items.resize( static_cast<size_t>( count_ ) );
+		for ( int i( 0 ); i < count_; ++ i ) {
+			_items[i] = i;
+		}
+		_rows = std::max( rows_, 1 );
+		_top = 0;
+		_selected = 0;
+		_contextLen = contextLen_;
+		_open = true;
+	}
+	void close( void ) {
+		_open = false;
+		_items.clear();
+	}
+	bool is_open( void ) const {
+		return ( _open );
+	}
+	// Keep completions starting with UTF-8 encoded prefix_, or matching it if fuzzy_ matcher is given,
+	// narrow_ filters current entries only, otherwise all completions are filtered.
+	void filter( CandidateList const& completions_, char const* prefix_, int prefixLen_, bool narrow_, int contextLen_, FuzzyMatcher* fuzzy_ ) {
+		_scratch.clear();
+		if ( fuzzy_ ) {
+			fuzzy_->set_pattern( prefix_, prefixLen_ );
+		}
+		int count( narrow_ ? static_cast<int>( _items.size() ) : completions_.size() );
+		for ( int i( 0 ); i < count; ++ i ) {
+			int index( narrow_ ? _items[i] : i );
+			Replxx::StringView c( completions_.candidates().get( index ) );
+			bool matches(
+				fuzzy_
+					? ( fuzzy_->score( c.data(), c.size() ) >= 0 )
+					: ( ( c.size() >= prefixLen_ ) && ( memcmp( c.data(), prefix_, static_cast<size_t>( prefixLen_ ) ) == 0 ) )
+			);
+			if ( matches ) {
+				_scratch.push_back( index );
+			}
+		}
+		_items.swap( _scratch );
+		_top = 0;
+		_selected = 0;
+		_contextLen = contextLen_;
+	}
+	void move( int delta_ ) {
+		int count( size() );
+		if ( count == 0 ) {
+			return;
+		}
+		if ( ( delta_ == 1 ) || ( delta_ == -1 ) ) {
+			// single steps wrap around
+			_selected = ( _selected + delta_ + count ) % count;
+		} else {
+			_selected = std::min( std::max( _selected + delta_, 0 ), count - 1 );
+		}
+		if ( _selected < _top ) {
+			_top = _selected;
+		} else if ( _selected >= ( _top + _rows ) ) {
+			_top = _selected - _rows + 1;
+		}
+	}
+	int size( void ) const {
+		return ( static_cast<int>( _items.size() ) );
+	}
+	int rows( void ) const {
+		return ( _rows );
+	}
+	int top( void ) const {
+		return ( _top );
+	}
+	int visible( void ) const {
+		return ( std::min( _rows, size() - _top ) );
+	}
+	int selected( void ) const {
+		return ( _selected );
+	}
+	// Index of completion shown in given entry.
+	int item( int entry_ ) const {
+		return ( _items[entry_] );
+	}
+	int context_length( void ) const {
+		return ( _contextLen );
+	}
+};
+
+}
+
+#endif
+
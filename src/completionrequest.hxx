@@ -0,0 +1,117 @@
+#ifndef REPLXX_COMPLETIONREQUEST_HXX_INCLUDED
+#define REPLXX_COMPLETIONREQUEST_HXX_INCLUDED 1
+
+#include <mutex>
+#include <string>
+
+#include "replxx.hxx"
+#include "candidates.hxx"
+#include "io.hxx"
+
+namespace replxx {
+
+// Completion request filled by asynchronous completer, possibly from other thread.
+//
+// Candidates added since replxx last looked are kept in a batch,
+// completer wakes replxx up through terminal event pipe, a burst
+// of batches results in a single wake-up until replxx takes them.
+// Once replxx stops waiting the request is detached from the terminal,
+// so completer may keep (and use) the request after that.
+class AsyncCompletionRequest : public Replxx::CompletionRequest {
+	std::string const _input;
+	mutable std::mutex _mutex;
+	int _contextLen;
+	Replxx::Candidates _batch; // candidates not taken by replxx yet
+	bool _finished;
+	bool _cancelled;
+	bool _notified;            // wake-up is pending
+	Terminal* _terminal;
+public:
+	AsyncCompletionRequest( std::string const& input_, int contextLen_, Terminal& terminal_ )
+		: _input( input_ )
+		, _mutex()
+		, _contextLen( contextLen_ )
+		, _batch()
+		, _finished( false )
+		, _cancelled( false )
+		, _notified( false )
+		, _terminal( &terminal_ ) {
+	}
+	std::string const& input( void ) const override {
+		return ( _input );
+	}
+	int context_length( void ) const override {
+		std::lock_guard<std::mutex> l( _mutex );
+		return ( _contextLen );
+	}
+	void set_context_length( int contextLen_ ) override {
+		std::lock_guard<std::mutex> l( _mutex );
+		_contextLen = contextLen_;
+	}
+	bool add( char const* text_, int size_ ) override {
+		std::lock_guard<std::mutex> l( _mutex );
+		if ( _cancelled ) {
+			return ( false );
+		}
+		_batch.add( text_, size_ );
+		notify();
+		return ( true );
+	}
+	bool add( Replxx::Candidates const& batch_ ) override {
+		std::lock_guard<std::mutex> l( _mutex );
+		if ( _cancelled ) {
+			return ( false );
+		}
+		for ( int i( 0 ), count( batch_.size() ); i < count; ++ i ) {
+			Replxx::StringView c( batch_.get( i ) );
+			_batch.add( c.data(), c.size() );
+		}
+		notify();
+		return ( true );
+	}
+	void finish( void ) override {
+		std::lock_guard<std::mutex> l( _mutex );
+		_finished = true;
+		notify();
+	}
+	bool is_cancelled( void ) const override {
+		std::lock_guard<std::mutex> l( _mutex );
+		return ( _cancelled );
+	}
+	// Append candidates added since last call to completions_, true if there were any.
+	bool take( CandidateList& completions_, int& contextLen_, bool& finished_ ) {
+		std::lock_guard<std::mutex> l( _mutex );
+		_notified = false;
+		contextLen_ = _contextLen;
+		finished_ = _finished;
+		int count( _batch.size() );
+		if ( count == 0 ) {
+			return ( false );
+		}
+		Replxx::Candidates& out( completions_.append_sink() );
+		for ( int i( 0 ); i < count; ++ i ) {
+			Replxx::StringView c( _batch.get( i ) );
+			out.add( c.data(), c.size() );
+		}
+		_batch.clear();
+		return ( true );
+	}
+	// Called when replxx stops waiting, completer is told to stop unless it has finished already.
+	void cancel( void ) {
+		std::lock_guard<std::mutex> l( _mutex );
+		_cancelled = ! _finished;
+		_terminal = nullptr;
+	}
+private:
+	void notify( void ) {
+		if ( ! _notified && _terminal ) {
+			_notified = true;
+			_terminal->notify_event( Terminal::EVENT_TYPE::MESSAGE );
+		}
+	}
+};
+
+}
+
+#endif
+
@@ -4,6 +4,15 @@
 #include <cctype>
 #include <locale.h>
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define REPLXX_HAVE_SSE2 1
+#include <emmintrin.h>
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define REPLXX_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
 #include "conversion.hxx"
 
 #ifdef _WIN32
@@ -41,16 +50,301 @@ bool is8BitEncoding( is_8bit_encoding() );
 
 }
 
+namespace {
+
+// Fast paths convert leading run of ASCII characters and return number
+// of characters converted, everything else goes through scalar code.
+typedef int ( *ascii8to32_t )( UTF32*, UTF8 const*, int );
+typedef int ( *ascii32to8_t )( UTF8*, UTF32 const*, int );
+
+// Consecutive ASCII characters seen before vector fast path is tried again,
+// text with short ASCII runs is faster to convert one character at a time.
+static int const ASCII_RUN( 16 );
+
+// Stops at non-ASCII byte and at NUL byte.
+int ascii8to32_scalar( UTF32* dst_, UTF8 const* src_, int count_ ) {
+	int i( 0 );
+	for ( ; ( i < count_ ) && ( static_cast<UTF8>( src_[i] - 1 ) < 0x7f ); ++ i ) {
+		dst_[i] = src_[i];
+	}
+	return ( i );
+}
+
+int ascii32to8_scalar( UTF8* dst_, UTF32 const* src_, int count_ ) {
+	int i( 0 );
+	for ( ; ( i < count_ ) && ( src_[i] < 0x80 ); ++ i ) {
+		dst_[i] = static_cast<UTF8>( src_[i] );
+	}
+	return ( i );
+}
+
+#ifdef REPLXX_HAVE_SSE2
+
+int ascii8to32_sse2( UTF32* dst_, UTF8 const* src_, int count_ ) {
+	__m128i const zero( _mm_setzero_si128() );
+	int i( 0 );
+	for ( ; ( i + 16 ) <= count_; i += 16 ) {
+		__m128i bytes( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src_ + i ) ) );
+		// high bit set for non-ASCII and for NUL bytes
+		if ( _mm_movemask_epi8( _mm_or_si128( bytes, _mm_cmpeq_epi8( bytes, zero ) ) ) != 0 ) {
+			break;
+		}
+		__m128i lo( _mm_unpacklo_epi8( bytes, zero ) );
+		__m128i hi( _mm_unpackhi_epi8( bytes, zero ) );
+		__m128i* dst( reinterpret_cast<__m128i*>( dst_ + i ) );
+		_mm_storeu_si128( dst, _mm_unpacklo_epi16( lo, zero ) );
+		_mm_storeu_si128( dst + 1, _mm_unpackhi_epi16( lo, zero ) );
+		_mm_storeu_si128( dst + 2, _mm_unpacklo_epi16( hi, zero ) );
+		_mm_storeu_si128( dst + 3, _mm_unpackhi_epi16( hi, zero ) );
+	}
+	return ( i + ascii8to32_scalar( dst_ + i, src_ + i, count_ - i ) );
+}
+
+int ascii32to8_sse2( UTF8* dst_, UTF32 const* src_, int count_ ) {
+	__m128i const nonAscii( _mm_set1_epi32( ~0x7f ) );
+	__m128i const zero( _mm_setzero_si128() );
+	int i( 0 );
+	for ( ; ( i + 16 ) <= count_; i += 16 ) {
+		__m128i const* src( reinterpret_cast<__m128i const*>( src_ + i ) );
+		__m128i a( _mm_loadu_si128( src ) );
+		__m128i b( _mm_loadu_si128( src + 1 ) );
+		__m128i c( _mm_loadu_si128( src + 2 ) );
+		__m128i d( _mm_loadu_si128( src + 3 ) );
+		__m128i all( _mm_or_si128( _mm_or_si128( a, b ), _mm_or_si128( c, d ) ) );
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( all, nonAscii ), zero ) ) != 0xffff ) {
+			break;
+		}
+		// values are below 0x80 so saturating packs are plain truncations
+		__m128i bytes( _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( dst_ + i ), bytes );
+	}
+	return ( i + ascii32to8_scalar( dst_ + i, src_ + i, count_ - i ) );
+}
+
+#endif
+
+#ifdef REPLXX_HAVE_AVX2
+
+__attribute__(( target( "avx2" ) ))
+int ascii8to32_avx2( UTF32* dst_, UTF8 const* src_, int count_ ) {
+	__m256i const zero( _mm256_setzero_si256() );
+	int i( 0 );
+	for ( ; ( i + 32 ) <= count_; i += 32 ) {
+		__m256i bytes( _mm256_loadu_si256( reinterpret_cast<__m256i const*>( src_ + i ) ) );
+		if ( _mm256_movemask_epi8( _mm256_or_si256( bytes, _mm256_cmpeq_epi8( bytes, zero ) ) ) != 0 ) {
+			break;
+		}
+		__m256i* dst( reinterpret_cast<__m256i*>( dst_ + i ) );
+		for ( int j( 0 ); j < 4; ++ j ) {
+			__m128i part( _mm_loadl_epi64( reinterpret_cast<__m128i const*>( src_ + i + j * 8 ) ) );
+			_mm256_storeu_si256( dst + j, _mm256_cvtepu8_epi32( part ) );
+		}
+	}
+	// leave AVX state clean before running legacy SSE code, otherwise every SSE instruction pays for it
+	_mm256_zeroupper();
+	return ( i + ascii8to32_sse2( dst_ + i, src_ + i, count_ - i ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+int ascii32to8_avx2( UTF8* dst_, UTF32 const* src_, int count_ ) {
+	__m256i const nonAscii( _mm256_set1_epi32( ~0x7f ) );
+	// packs work within 128-bit lanes, this puts 4-byte groups back in order
+	__m256i const order( _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 ) );
+	int i( 0 );
+	for ( ; ( i + 32 ) <= count_; i += 32 ) {
+		__m256i const* src( reinterpret_cast<__m256i const*>( src_ + i ) );
+		__m256i a( _mm256_loadu_si256( src ) );
+		__m256i b( _mm256_loadu_si256( src + 1 ) );
+		__m256i c( _mm256_loadu_si256( src + 2 ) );
+		__m256i d( _mm256_loadu_si256( src + 3 ) );
+		__m256i all( _mm256_or_si256( _mm256_or_si256( a, b ), _mm256_or_si256( c, d ) ) );
+		if ( ! _mm256_testz_si256( all, nonAscii ) ) {
+			break;
+		}
+		__m256i bytes( _mm256_packus_epi16( _mm256_packs_epi32( a, b ), _mm256_packs_epi32( c, d ) ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst_ + i ), _mm256_permutevar8x32_epi32( bytes, order ) );
+	}
+	_mm256_zeroupper();
+	return ( i + ascii32to8_sse2( dst_ + i, src_ + i, count_ - i ) );
+}
+
+#endif
+
+simd::ISA supported_isa( void ) {
+#if defined( REPLXX_HAVE_AVX2 )
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		return ( simd::ISA::AVX2 );
+	}
+#endif
+#if defined( REPLXX_HAVE_SSE2 )
+	return ( simd::ISA::SSE2 );
+#else
+	return ( simd::ISA::NONE );
+#endif
+}
+
+simd::ISA activeIsa( simd::ISA::NONE );
+ascii8to32_t ascii8to32( &ascii8to32_scalar );
+ascii32to8_t ascii32to8( &ascii32to8_scalar );
+
+ConversionResult convert8to32( UTF8 const** sourceStart_, UTF8 const* sourceEnd_, UTF32** targetStart_, UTF32* targetEnd_ ) {
+	ConversionResult res( conversionOK );
+	UTF8 const* source( *sourceStart_ );
+	UTF32* target( *targetStart_ );
+	UTF8 const* nul( nullptr );
+	while ( source < sourceEnd_ ) {
+		int n( ascii8to32( target, source, static_cast<int>( std::min<ptrdiff_t>( sourceEnd_ - source, targetEnd_ - target ) ) ) );
+		source += n;
+		target += n;
+		if ( source == sourceEnd_ ) {
+			break;
+		}
+		if ( *source == 0 ) {
+			// text ends at NUL byte
+			break;
+		}
+		if ( ! nul ) {
+			UTF8 const* p( static_cast<UTF8 const*>( memchr( source, 0, static_cast<size_t>( sourceEnd_ - source ) ) ) );
+			nul = p ? p : sourceEnd_;
+		}
+		// Run of non-ASCII bytes goes to the scalar converter with the real
+		// end of text, so sequence validation is exactly as before; output is
+		// capped at number of lead bytes in the run to get back to fast path.
+		int leads( 0 );
+		for ( UTF8 const* p( source ); ( p < nul ) && ( *p >= 0x80 ); ++ p ) {
+			if ( *p >= 0xc0 ) {
+				++ leads;
+			}
+		}
+		leads = std::max( leads, 1 );
+		UTF32* limit( ( targetEnd_ - target ) > leads ? target + leads : targetEnd_ );
+		res = ConvertUTF8toUTF32( &source, nul, &target, limit, lenientConversion );
+		if ( ( res == targetExhausted ) && ( limit != targetEnd_ ) ) {
+			res = conversionOK;
+			continue;
+		}
+		if ( res != conversionOK ) {
+			break;
+		}
+	}
+	*sourceStart_ = source;
+	*targetStart_ = target;
+	return ( res );
+}
+
+// Same results as ConvertUTF32toUTF8() with lenientConversion.
+ConversionResult convert32to8( UTF32 const** sourceStart_, UTF32 const* sourceEnd_, UTF8** targetStart_, UTF8* targetEnd_ ) {
+	static UTF8 const firstByteMark[] = { 0x00, 0x00, 0xc0, 0xe0, 0xf0 };
+	ConversionResult res( conversionOK );
+	UTF32 const* source( *sourceStart_ );
+	UTF8* target( *targetStart_ );
+	int asciiRun( ASCII_RUN );
+	while ( source < sourceEnd_ ) {
+		UTF32 ch( *source );
+		if ( ch < 0x80 ) {
+			if ( asciiRun >= ASCII_RUN ) {
+				int n( ascii32to8( target, source, static_cast<int>( std::min<ptrdiff_t>( sourceEnd_ - source, targetEnd_ - target ) ) ) );
+				source += n;
+				target += n;
+				asciiRun = 0;
+				if ( n > 0 ) {
+					continue;
+				}
+			}
+			if ( target >= targetEnd_ ) {
+				res = targetExhausted;
+				break;
+			}
+			*target ++ = static_cast<UTF8>( ch );
+			++ source;
+			++ asciiRun;
+			continue;
+		}
+		asciiRun = 0;
+		int bytes( 0 );
+		if ( ch < 0x800 ) {
+			bytes = 2;
+		} else if ( ch < 0x10000 ) {
+			bytes = 3;
+		} else if ( ch <= UNI_MAX_LEGAL_UTF32 ) {
+			bytes = 4;
+		} else {
+			bytes = 3;
+			ch = UNI_REPLACEMENT_CHAR;
+			res = sourceIllegal;
+		}
+		if ( ( targetEnd_ - target ) < bytes ) {
+			res = targetExhausted;
+			break;
+		}
+		for ( int i( bytes - 1 ); i > 0; -- i ) {
+			target[i] = static_cast<UTF8>( 0x80 | ( ch & 0x3f ) );
+			ch >>= 6;
+		}
+		target[0] = static_cast<UTF8>( ch | firstByteMark[bytes] );
+		target += bytes;
+		++ source;
+	}
+	*sourceStart_ = source;
+	*targetStart_ = target;
+	return ( res );
+}
+
+}
+
+namespace simd {
+
+ISA isa( void ) {
+	return ( activeIsa );
+}
+
+ISA set_isa( ISA isa_ ) {
+	ISA supported( supported_isa() );
+	if ( static_cast<int>( isa_ ) > static_cast<int>( supported ) ) {
+		isa_ = supported;
+	}
+	activeIsa = isa_;
+	switch ( isa_ ) {
+#ifdef REPLXX_HAVE_AVX2
+		case ( ISA::AVX2 ): {
+			ascii8to32 = &ascii8to32_avx2;
+			ascii32to8 = &ascii32to8_avx2;
+		} break;
+#endif
+#ifdef REPLXX_HAVE_SSE2
+		case ( ISA::SSE2 ): {
+			ascii8to32 = &ascii8to32_sse2;
+			ascii32to8 = &ascii32to8_sse2;
+		} break;
+#endif
+		default: {
+			ascii8to32 = &ascii8to32_scalar;
+			ascii32to8 = &ascii32to8_scalar;
+		}
+	}
+	return ( isa_ );
+}
+
+namespace {
+ISA const initialIsa( set_isa( ISA::AVX2 ) );
+}
+
+}
+
 ConversionResult copyString8to32(char32_t* dst, int dstSize, int& dstCount, const char* src) {
+	return ( copyString8to32( dst, dstSize, dstCount, src, static_cast<int>( strlen( src ) ) ) );
+}
+
+ConversionResult copyString8to32( char32_t* dst, int dstSize, int& dstCount, char const* src, int srcSize ) {
 	ConversionResult res = ConversionResult::conversionOK;
 	if ( ! locale::is8BitEncoding ) {
 		const UTF8* sourceStart = reinterpret_cast<const UTF8*>(src);
-		const UTF8* sourceEnd = sourceStart + strlen(src);
+		const UTF8* sourceEnd = sourceStart + srcSize;
 		UTF32* targetStart = reinterpret_cast<UTF32*>(dst);
 		UTF32* targetEnd = targetStart + dstSize;
 
-		res = ConvertUTF8toUTF32(
-				&sourceStart, sourceEnd, &targetStart, targetEnd, lenientConversion);
+		res = convert8to32( &sourceStart, sourceEnd, &targetStart, targetEnd );
 
 		if (res == conversionOK) {
 			dstCount = targetStart - reinterpret_cast<UTF32*>(dst);
@@ -60,7 +354,7 @@ ConversionResult copyString8to32(char32_t* dst, int dstSize, int& dstCount, cons
 			}
 		}
 	} else {
-		for ( dstCount = 0; ( dstCount < dstSize ) && src[dstCount]; ++ dstCount ) {
+		for ( dstCount = 0; ( dstCount < dstSize ) && ( dstCount < srcSize ) && src[dstCount]; ++ dstCount ) {
 			dst[dstCount] = src[dstCount];
 		}
 	}
@@ -82,8 +376,7 @@ void copyString32to8(
 		UTF8* targetStart = reinterpret_cast<UTF8*>(dst);
 		UTF8* targetEnd = targetStart + dstSize;
 
-		ConversionResult res = ConvertUTF32toUTF8(
-				&sourceStart, sourceEnd, &targetStart, targetEnd, lenientConversion);
+		ConversionResult res = convert32to8( &sourceStart, sourceEnd, &targetStart, targetEnd );
 
 		if (res == conversionOK) {
 			int resCount( targetStart - reinterpret_cast<UTF8*>( dst ) );
@@ -9,12 +9,32 @@ typedef unsigned char uchar8_t;
 
 ConversionResult copyString8to32( char32_t* dst, int dstSize, int& dstCount, char const* src );
 ConversionResult copyString8to32( char32_t* dst, int dstSize, int& dstCount, uchar8_t const* src );
+// Converts at most srcSize bytes, stops at NUL byte, no separate strlen() pass.
+ConversionResult copyString8to32( char32_t* dst, int dstSize, int& dstCount, char const* src, int srcSize );
 void copyString32to8( char* dst, int dstSize, char32_t const* src, int srcSize, int* dstCount = nullptr );
 
 namespace locale {
 extern bool is8BitEncoding;
 }
 
+namespace simd {
+// Instruction set used by ASCII fast paths of conversion routines,
+// best one supported by the CPU is selected at startup.
+enum class ISA {
+	NONE,
+	SSE2,
+	AVX2
+};
+ISA isa( void );
+// Used by benchmarks, returns ISA actually selected (capped by CPU support).
+ISA set_isa( ISA );
+}
+
+// First byte of an UTF-8 sequence (every byte in 8-bit locale encoding).
+inline bool is_lead_byte( char c_ ) {
+	return ( locale::is8BitEncoding || ( ( static_cast<unsigned char>( c_ ) & 0xc0 ) != 0x80 ) );
+}
+
 }
 
 #endif
@@ -0,0 +1,322 @@
+#ifndef REPLXX_EDITBUFFER_HXX_INCLUDED
+#define REPLXX_EDITBUFFER_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+#include "unicodestring.hxx"
+
+namespace replxx {
+
+// Text of the line being edited stored in a gap buffer.
+//
+// Characters live in a single array with a gap (unused space) placed
+// at the last edit position:
+//   [0, _gapStart) - text before the gap,
+//   [_gapEnd, size) - text after the gap.
+// Inserting or erasing at the gap only moves gap boundaries, moving
+// the gap costs the distance it moves, so a series of edits around
+// the cursor costs O(1) amortized regardless of the line length.
+//
+// Text is accessible as two contiguous segments (head() and tail()),
+// get() closes the gap and returns whole text as a single array.
+//
+// UTF-8 encoded copy of the text is kept in sync with every edit so
+// it never has to be re-encoded as a whole. It is a gap buffer of its own,
+// its gap follows the edits just like the gap of the text, utf8() closes
+// the gap by moving it to the end. Byte offset of a character is found
+// by walking UTF-8 sequences from the last edit position, so it costs
+// the distance from the last edit, not the line length.
+class EditBuffer {
+	typedef std::vector<char32_t> data_buffer_t;
+	static int const MIN_GAP = 64;
+	data_buffer_t _data;
+	int _gapStart;
+	int _gapEnd;
+	mutable std::string _utf8;   // UTF-8 text with a gap, the gap is cut off by utf8()
+	mutable int _utf8GapStart;   // byte offsets of the gap in _utf8
+	mutable int _utf8GapEnd;
+	mutable int _anchorPos;  // character position of the last edit
+	mutable int _anchorByte; // its byte offset in UTF-8 text (gap excluded)
+	std::vector<char> _encoded;
+public:
+	EditBuffer( void )
+		: _data()
+		, _gapStart( 0 )
+		, _gapEnd( 0 )
+		, _utf8()
+		, _utf8GapStart( 0 )
+		, _utf8GapEnd( 0 )
+		, _anchorPos( 0 )
+		, _anchorByte( 0 )
+		, _encoded() {
+	}
+
+	EditBuffer& assign( std::string const& str_ ) {
+		return ( assign_utf8( str_.c_str(), static_cast<int>( str_.length() ) ) );
+	}
+
+	EditBuffer& assign( char const* str_ ) {
+		return ( assign_utf8( str_, static_cast<int>( strlen( str_ ) ) ) );
+	}
+
+	EditBuffer& assign( UnicodeString const& str_ ) {
+		clear();
+		return ( insert( 0, str_, 0, str_.length() ) );
+	}
+
+	EditBuffer& insert( int pos_, char32_t c_ ) {
+		return ( insert( pos_, &c_, 1 ) );
+	}
+
+	EditBuffer& insert( int pos_, UnicodeString const& str_, int offset_, int len_ ) {
+		return ( insert( pos_, str_.get() + offset_, len_ ) );
+	}
+
+	EditBuffer& insert( int pos_, char32_t const* str_, int len_ ) {
+		int byte( utf8_offset( pos_ ) );
+		int size( encode( str_, len_ ) );
+		utf8_replace( byte, 0, size );
+		_anchorPos = pos_ + len_;
+		_anchorByte = byte + size;
+		open_gap( pos_, len_ );
+		std::copy( str_, str_ + len_, _data.begin() + _gapStart );
+		_gapStart += len_;
+		return ( *this );
+	}
+
+	// Replace single character.
+	void set( int pos_, char32_t c_ ) {
+		int byte( utf8_offset( pos_ ) );
+		int end( utf8_offset( pos_ + 1 ) );
+		int size( encode( &c_, 1 ) );
+		utf8_replace( byte, end - byte, size );
+		_anchorPos = pos_;
+		_anchorByte = byte;
+		_data[pos_ < _gapStart ? pos_ : pos_ + gap_length()] = c_;
+	}
+
+	EditBuffer& erase( int pos_ ) {
+		return ( erase( pos_, 1 ) );
+	}
+
+	EditBuffer& erase( int pos_, int len_ ) {
+		int byte( utf8_offset( pos_ ) );
+		utf8_replace( byte, utf8_offset( pos_ + len_ ) - byte, 0 );
+		_anchorPos = pos_;
+		_anchorByte = byte;
+		if ( ( pos_ + len_ ) == _gapStart ) {
+			// erase right in front of the gap (backspace)
+			_gapStart = pos_;
+		} else {
+			move_gap( pos_ );
+			_gapEnd += len_;
+		}
+		return ( *this );
+	}
+
+	int length( void ) const {
+		return ( static_cast<int>( _data.size() ) - gap_length() );
+	}
+
+	void clear( void ) {
+		_gapStart = 0;
+		_gapEnd = static_cast<int>( _data.size() );
+		_utf8.clear();
+		_utf8GapStart = 0;
+		_utf8GapEnd = 0;
+		_anchorPos = 0;
+		_anchorByte = 0;
+	}
+
+	char32_t const& operator[]( int pos_ ) const {
+		return ( _data[pos_ < _gapStart ? pos_ : pos_ + gap_length()] );
+	}
+
+	// Text before the gap.
+	char32_t const* head( void ) const {
+		return ( _data.data() );
+	}
+
+	int head_length( void ) const {
+		return ( _gapStart );
+	}
+
+	// Text after the gap.
+	char32_t const* tail( void ) const {
+		return ( _data.data() + _gapEnd );
+	}
+
+	int tail_length( void ) const {
+		return ( static_cast<int>( _data.size() ) - _gapEnd );
+	}
+
+	// Whole text encoded in UTF-8 (or in 8-bit locale encoding),
+	// moves the gap of UTF-8 copy to the end.
+	std::string const& utf8( void ) const {
+		if ( _utf8GapEnd < static_cast<int>( _utf8.length() ) ) {
+			move_utf8_gap( utf8_length() );
+		}
+		_utf8.resize( static_cast<size_t>( _utf8GapStart ) );
+		_utf8GapEnd = _utf8GapStart;
+		return ( _utf8 );
+	}
+
+	// Byte offset of character at pos_ in utf8().
+	int utf8_offset( int pos_ ) const {
+		int len( length() );
+		if ( pos_ >= len ) {
+			return ( utf8_length() );
+		}
+		// walk from the closest known position: start, last edit or end
+		int p( 0 );
+		int b( 0 );
+		int fromAnchor( pos_ > _anchorPos ? pos_ - _anchorPos : _anchorPos - pos_ );
+		if ( ( len - pos_ ) < std::min( pos_, fromAnchor ) ) {
+			p = len;
+			b = utf8_length();
+		} else if ( fromAnchor < pos_ ) {
+			p = _anchorPos;
+			b = _anchorByte;
+		}
+		while ( p < pos_ ) {
+			++ b;
+			while ( ! is_lead_byte( utf8_byte( b ) ) ) {
+				++ b;
+			}
+			++ p;
+		}
+		while ( p > pos_ ) {
+			-- b;
+			while ( ! is_lead_byte( utf8_byte( b ) ) ) {
+				-- b;
+			}
+			-- p;
+		}
+		_anchorPos = p;
+		_anchorByte = b;
+		return ( b );
+	}
+
+	// Whole text as a contiguous array, moves the gap to the end.
+	char32_t const* get( void ) {
+		move_gap( length() );
+		return ( _data.data() );
+	}
+
+	// Part of the text as a contiguous array, moves the gap out
+	// of the requested range only if it splits the range.
+	char32_t const* get( int pos_, int len_ ) {
+		if ( ( pos_ < _gapStart ) && ( ( pos_ + len_ ) > _gapStart ) ) {
+			move_gap( ( _gapStart - pos_ ) < ( pos_ + len_ - _gapStart ) ? pos_ : pos_ + len_ );
+		}
+		return ( _data.data() + ( pos_ < _gapStart ? pos_ : pos_ + gap_length() ) );
+	}
+
+private:
+	EditBuffer& assign_utf8( char const* str_, int byteCount_ ) {
+		if ( static_cast<int>( _data.size() ) < byteCount_ ) {
+			_data.resize( byteCount_ );
+		}
+		int len( 0 );
+		copyString8to32( _data.data(), byteCount_, len, str_, byteCount_ );
+		_gapStart = len;
+		_gapEnd = static_cast<int>( _data.size() );
+		int size( encode( _data.data(), len ) );
+		_utf8.assign( _encoded.data(), static_cast<size_t>( size ) );
+		_utf8GapStart = size;
+		_utf8GapEnd = size;
+		_anchorPos = 0;
+		_anchorByte = 0;
+		return ( *this );
+	}
+
+	// Encode text into _encoded, returns number of bytes.
+	int encode( char32_t const* str_, int len_ ) {
+		int size( len_ * 4 + 1 );
+		if ( static_cast<int>( _encoded.size() ) < size ) {
+			_encoded.resize( static_cast<size_t>( size ) );
+		}
+		int count( 0 );
+		copyString32to8( _encoded.data(), size, str_, len_, &count );
+		return ( count );
+	}
+
+	int gap_length( void ) const {
+		return ( _gapEnd - _gapStart );
+	}
+
+	int utf8_length( void ) const {
+		return ( static_cast<int>( _utf8.length() ) - ( _utf8GapEnd - _utf8GapStart ) );
+	}
+
+	// Byte of UTF-8 text at given offset, gap excluded.
+	char utf8_byte( int byte_ ) const {
+		return ( _utf8[static_cast<size_t>( byte_ < _utf8GapStart ? byte_ : byte_ + ( _utf8GapEnd - _utf8GapStart ) )] );
+	}
+
+	// Replace erase_ bytes of UTF-8 text at byte_ with size_ bytes from _encoded,
+	// costs the distance the gap moves, not the text length.
+	void utf8_replace( int byte_, int erase_, int size_ ) {
+		move_utf8_gap( byte_ );
+		_utf8GapEnd += erase_;
+		if ( ( _utf8GapEnd - _utf8GapStart ) < size_ ) {
+			// growing shifts the tail, gap at least as large as the tail
+			// makes that cost amortized O(1) over edits that follow
+			int grow( std::max( static_cast<int>( _utf8.length() ) - _utf8GapEnd, size_ + MIN_GAP ) );
+			_utf8.insert( static_cast<size_t>( _utf8GapEnd ), static_cast<size_t>( grow ), '\0' );
+			_utf8GapEnd += grow;
+		}
+		std::copy( _encoded.data(), _encoded.data() + size_, &_utf8[static_cast<size_t>( _utf8GapStart )] );
+		_utf8GapStart += size_;
+	}
+
+	void move_utf8_gap( int byte_ ) const {
+		char* s( &_utf8[0] );
+		if ( byte_ < _utf8GapStart ) {
+			std::copy_backward( s + byte_, s + _utf8GapStart, s + _utf8GapEnd );
+			_utf8GapEnd -= ( _utf8GapStart - byte_ );
+			_utf8GapStart = byte_;
+		} else if ( byte_ > _utf8GapStart ) {
+			int len( byte_ - _utf8GapStart );
+			std::copy( s + _utf8GapEnd, s + _utf8GapEnd + len, s + _utf8GapStart );
+			_utf8GapEnd += len;
+			_utf8GapStart = byte_;
+		}
+	}
+
+	void move_gap( int pos_ ) {
+		if ( pos_ < _gapStart ) {
+			std::copy_backward( _data.begin() + pos_, _data.begin() + _gapStart, _data.begin() + _gapEnd );
+			_gapEnd -= ( _gapStart - pos_ );
+			_gapStart = pos_;
+		} else if ( pos_ > _gapStart ) {
+			int len( pos_ - _gapStart );
+			std::copy( _data.begin() + _gapEnd, _data.begin() + _gapEnd + len, _data.begin() + _gapStart );
+			_gapEnd += len;
+			_gapStart = pos_;
+		}
+	}
+
+	// Move the gap to pos_ and make sure it can hold len_ characters.
+	void open_gap( int pos_, int len_ ) {
+		move_gap( pos_ );
+		if ( gap_length() >= len_ ) {
+			return;
+		}
+		int tailLen( tail_length() );
+		int size( std::max( static_cast<int>( _data.size() ) * 2, length() + len_ + MIN_GAP ) );
+		data_buffer_t data( size );
+		std::copy( _data.begin(), _data.begin() + _gapStart, data.begin() );
+		std::copy( _data.begin() + _gapEnd, _data.end(), data.end() - tailLen );
+		_data.swap( data );
+		_gapEnd = size - tailLen;
+	}
+};
+
+}
+
+#endif
+
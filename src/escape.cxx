@@ -1,694 +1,251 @@
 #include "escape.hxx"
-#include "io.hxx"
 #include "replxx.hxx"
 
 #ifndef _WIN32
 
 namespace replxx {
 
-namespace EscapeSequenceProcessing { // move these out of global namespace
-
 // This chunk of code does parsing of the escape sequences sent by various Linux
 // terminals.
 //
-// It handles arrow keys, Home, End and Delete keys by interpreting the
-// sequences sent by
-// gnome terminal, xterm, rxvt, konsole, aterm and yakuake including the Alt and
-// Ctrl key
+// It handles arrow keys, Home, End, Insert, Delete, Page Up/Down and function
+// keys by interpreting the sequences sent by gnome terminal, xterm, rxvt,
+// konsole, aterm and yakuake including the Shift, Alt and Ctrl key
 // combinations that are understood by replxx.
 //
-// The parsing uses tables, a bunch of intermediate dispatch routines and a
-// doDispatch
-// loop that reads the tables and sends control to "deeper" routines to continue
-// the
-// parsing.	The starting call to doDispatch( c, initialDispatch ) will
-// eventually return
-// either a character (with optional CTRL and META bits set), or -1 if parsing
-// fails, or
-// zero if an attempt to read from the keyboard fails.
-//
-// This is rather sloppy escape sequence processing, since we're not paying
-// attention to what the
-// actual TERM is set to and are processing all key sequences for all terminals,
-// but it works with
-// the most common keystrokes on the most common terminals.	It's intricate, but
-// the nested 'if'
-// statements required to do it directly would be worse.	This way has the
-// advantage of allowing
-// changes and extensions without having to touch a lot of code.
-
-
-static char32_t thisKeyMetaCtrl = 0;	// holds pre-set Meta and/or Ctrl modifiers
-
-// This dispatch routine is given a dispatch table and then farms work out to
-// routines
-// listed in the table based on the character it is called with.	The dispatch
-// routines can
-// read more input characters to decide what should eventually be returned.
-// Eventually,
-// a called routine returns either a character or -1 to indicate parsing
-// failure.
-//
-char32_t doDispatch(char32_t c, CharacterDispatch& dispatchTable) {
-	for (unsigned int i = 0; i < dispatchTable.len; ++i) {
-		if (static_cast<unsigned char>(dispatchTable.chars[i]) == c) {
-			return dispatchTable.dispatch[i](c);
+// Instead of hard coding every known sequence the decoder follows generic
+// structure of the sequences:
+//   CSI = ESC [ <parameter bytes 0x30-0x3f>* <intermediate bytes 0x20-0x2f>* <final byte 0x40-0x7e>
+//   SS3 = ESC O <modifier digit>? <final byte>
+// and uses small tables to map final byte (or first numeric parameter for
+// `ESC [ n ~` sequences) onto a key, modifiers are taken from second
+// numeric parameter.
+
+char32_t const EscapeSequenceDecoder::INVALID;
+
+namespace {
+
+struct FinalKey {
+	char32_t final;
+	char32_t key;
+};
+
+// Final bytes of `ESC [ ... <final>` sequences.
+FinalKey const csiFinalKeys[] = {
+	{ 'A', Replxx::KEY::UP },
+	{ 'B', Replxx::KEY::DOWN },
+	{ 'C', Replxx::KEY::RIGHT },
+	{ 'D', Replxx::KEY::LEFT },
+	{ 'H', Replxx::KEY::HOME },
+	{ 'F', Replxx::KEY::END },
+	{ 'P', Replxx::KEY::F1 },
+	{ 'Q', Replxx::KEY::F2 },
+	{ 'R', Replxx::KEY::F3 },
+	{ 'S', Replxx::KEY::F4 }
+};
+
+// Final bytes of `ESC O <final>` sequences,
+// rxvt sends lower case letters for Ctrl modified arrows.
+FinalKey const ss3FinalKeys[] = {
+	{ 'A', Replxx::KEY::UP },
+	{ 'B', Replxx::KEY::DOWN },
+	{ 'C', Replxx::KEY::RIGHT },
+	{ 'D', Replxx::KEY::LEFT },
+	{ 'H', Replxx::KEY::HOME },
+	{ 'F', Replxx::KEY::END },
+	{ 'P', Replxx::KEY::F1 },
+	{ 'Q', Replxx::KEY::F2 },
+	{ 'R', Replxx::KEY::F3 },
+	{ 'S', Replxx::KEY::F4 },
+	{ 'a', Replxx::KEY::control( Replxx::KEY::UP ) },
+	{ 'b', Replxx::KEY::control( Replxx::KEY::DOWN ) },
+	{ 'c', Replxx::KEY::control( Replxx::KEY::RIGHT ) },
+	{ 'd', Replxx::KEY::control( Replxx::KEY::LEFT ) }
+};
+
+// `ESC [ n ~` sequences indexed by `n`.
+char32_t const tildeKeys[] = {
+	0,                       //  0
+	Replxx::KEY::HOME,       //  1
+	Replxx::KEY::INSERT,     //  2
+	Replxx::KEY::DELETE,     //  3
+	Replxx::KEY::END,        //  4
+	Replxx::KEY::PAGE_UP,    //  5
+	Replxx::KEY::PAGE_DOWN,  //  6
+	Replxx::KEY::HOME,       //  7, rxvt
+	Replxx::KEY::END,        //  8, rxvt
+	0,                       //  9
+	0,                       // 10
+	Replxx::KEY::F1,         // 11, rxvt
+	Replxx::KEY::F2,         // 12, rxvt
+	Replxx::KEY::F3,         // 13, rxvt
+	Replxx::KEY::F4,         // 14, rxvt
+	Replxx::KEY::F5,         // 15
+	0,                       // 16
+	Replxx::KEY::F6,         // 17
+	Replxx::KEY::F7,         // 18
+	Replxx::KEY::F8,         // 19
+	Replxx::KEY::F9,         // 20
+	Replxx::KEY::F10,        // 21
+	0,                       // 22
+	Replxx::KEY::F11,        // 23
+	Replxx::KEY::F12         // 24
+};
+
+template<int N>
+char32_t find_key( FinalKey const (&table_)[N], char32_t final_ ) {
+	for ( FinalKey const& fk : table_ ) {
+		if ( fk.final == final_ ) {
+			return ( fk.key );
 		}
 	}
-	return dispatchTable.dispatch[dispatchTable.len](c);
-}
-
-// Final dispatch routines -- return something
-//
-static char32_t normalKeyRoutine(char32_t c) { return thisKeyMetaCtrl | c; }
-static char32_t upArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::UP;;
-}
-static char32_t downArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::DOWN;
-}
-static char32_t rightArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::RIGHT;
-}
-static char32_t leftArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::LEFT;
-}
-static char32_t homeKeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::HOME; }
-static char32_t endKeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::END; }
-static char32_t f1KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F1; }
-static char32_t f2KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F2; }
-static char32_t f3KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F3; }
-static char32_t f4KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F4; }
-static char32_t f5KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F5; }
-static char32_t f6KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F6; }
-static char32_t f7KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F7; }
-static char32_t f8KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F8; }
-static char32_t f9KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F9; }
-static char32_t f10KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F10; }
-static char32_t f11KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F11; }
-static char32_t f12KeyRoutine(char32_t) { return thisKeyMetaCtrl | Replxx::KEY::F12; }
-static char32_t pageUpKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::PAGE_UP;
-}
-static char32_t pageDownKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::PAGE_DOWN;
-}
-static char32_t deleteCharRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::BACKSPACE;
-}	// key labeled Backspace
-static char32_t insertKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::INSERT;
-}	// key labeled Delete
-static char32_t deleteKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::DELETE;
-}	// key labeled Delete
-static char32_t ctrlUpArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::BASE_CONTROL | Replxx::KEY::UP;
-}
-static char32_t ctrlDownArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::BASE_CONTROL | Replxx::KEY::DOWN;
-}
-static char32_t ctrlRightArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::BASE_CONTROL | Replxx::KEY::RIGHT;
-}
-static char32_t ctrlLeftArrowKeyRoutine(char32_t) {
-	return thisKeyMetaCtrl | Replxx::KEY::BASE_CONTROL | Replxx::KEY::LEFT;
-}
-static char32_t escFailureRoutine(char32_t) {
-	beep();
-	return -1;
-}
-
-// Handle ESC [ 1 ; 2 or 3 (or 5) <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket1Semicolon2or3or5Routines[] = {
-	upArrowKeyRoutine,
-	downArrowKeyRoutine,
-	rightArrowKeyRoutine,
-	leftArrowKeyRoutine,
-	f1KeyRoutine,
-	f2KeyRoutine,
-	f3KeyRoutine,
-	f4KeyRoutine,
-	escFailureRoutine
-};
-static CharacterDispatch escLeftBracket1Semicolon2or3or5Dispatch = {
-		8, "ABCDPQRS", escLeftBracket1Semicolon2or3or5Routines
-};
-
-// Handle ESC [ 1 ; <more stuff> escape sequences
-//
-static char32_t escLeftBracket1Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket1Semicolon2or3or5Dispatch);
-}
-static char32_t escLeftBracket1Semicolon3Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_META;
-	return doDispatch(c, escLeftBracket1Semicolon2or3or5Dispatch);
-}
-static char32_t escLeftBracket1Semicolon5Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_CONTROL;
-	return doDispatch(c, escLeftBracket1Semicolon2or3or5Dispatch);
-}
-static CharacterDispatchRoutine escLeftBracket1SemicolonRoutines[] = {
-	escLeftBracket1Semicolon2Routine,
-	escLeftBracket1Semicolon3Routine,
-	escLeftBracket1Semicolon5Routine,
-	escFailureRoutine
-};
-static CharacterDispatch escLeftBracket1SemicolonDispatch = {
-	3, "235", escLeftBracket1SemicolonRoutines
-};
-
-// Handle ESC [ 1 ; <more stuff> escape sequences
-//
-static char32_t escLeftBracket1SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket1SemicolonDispatch);
-}
-
-
-// (S)-F5
-static CharacterDispatchRoutine escLeftBracket15Semicolon2Routines[] = {
-	f5KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket15Semicolon2Dispatch = {
-	1, "~", escLeftBracket15Semicolon2Routines
-};
-static char32_t escLeftBracket15Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket15Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket15SemicolonRoutines[] = {
-	escLeftBracket15Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket15SemicolonDispatch = {
-	1, "2", escLeftBracket15SemicolonRoutines
-};
-static char32_t escLeftBracket15SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket15SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket15Routines[] = {
-	f5KeyRoutine, escLeftBracket15SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket15Dispatch = {
-	2, "~;", escLeftBracket15Routines
-};
-static char32_t escLeftBracket15Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket15Dispatch);
-}
-
-// (S)-F6
-static CharacterDispatchRoutine escLeftBracket17Semicolon2Routines[] = {
-	f6KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket17Semicolon2Dispatch = {
-	1, "~", escLeftBracket17Semicolon2Routines
-};
-static char32_t escLeftBracket17Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket17Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket17SemicolonRoutines[] = {
-	escLeftBracket17Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket17SemicolonDispatch = {
-	1, "2", escLeftBracket17SemicolonRoutines
-};
-static char32_t escLeftBracket17SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket17SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket17Routines[] = {
-	f6KeyRoutine, escLeftBracket17SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket17Dispatch = {
-	2, "~;", escLeftBracket17Routines
-};
-static char32_t escLeftBracket17Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket17Dispatch);
-}
-
-// (S)-F7
-static CharacterDispatchRoutine escLeftBracket18Semicolon2Routines[] = {
-	f7KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket18Semicolon2Dispatch = {
-	1, "~", escLeftBracket18Semicolon2Routines
-};
-static char32_t escLeftBracket18Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket18Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket18SemicolonRoutines[] = {
-	escLeftBracket18Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket18SemicolonDispatch = {
-	1, "2", escLeftBracket18SemicolonRoutines
-};
-static char32_t escLeftBracket18SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket18SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket18Routines[] = {
-	f7KeyRoutine, escLeftBracket18SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket18Dispatch = {
-	2, "~;", escLeftBracket18Routines
-};
-static char32_t escLeftBracket18Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket18Dispatch);
-}
-
-// (S)-F8
-static CharacterDispatchRoutine escLeftBracket19Semicolon2Routines[] = {
-	f8KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket19Semicolon2Dispatch = {
-	1, "~", escLeftBracket19Semicolon2Routines
-};
-static char32_t escLeftBracket19Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket19Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket19SemicolonRoutines[] = {
-	escLeftBracket19Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket19SemicolonDispatch = {
-	1, "2", escLeftBracket19SemicolonRoutines
-};
-static char32_t escLeftBracket19SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket19SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket19Routines[] = {
-	f8KeyRoutine, escLeftBracket19SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket19Dispatch = {
-	2, "~;", escLeftBracket19Routines
-};
-static char32_t escLeftBracket19Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket19Dispatch);
-}
-
-// Handle ESC [ 1 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket1Routines[] = {
-	homeKeyRoutine, escLeftBracket1SemicolonRoutine,
-	escLeftBracket15Routine,
-	escLeftBracket17Routine,
-	escLeftBracket18Routine,
-	escLeftBracket19Routine,
-	escFailureRoutine
-};
-static CharacterDispatch escLeftBracket1Dispatch = {
-	6, "~;5789", escLeftBracket1Routines
-};
-
-// Handle ESC [ 2 <more stuff> escape sequences
-//
-
-// (S)-F9
-static CharacterDispatchRoutine escLeftBracket20Semicolon2Routines[] = {
-	f9KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket20Semicolon2Dispatch = {
-	1, "~", escLeftBracket20Semicolon2Routines
-};
-static char32_t escLeftBracket20Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket20Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket20SemicolonRoutines[] = {
-	escLeftBracket20Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket20SemicolonDispatch = {
-	1, "2", escLeftBracket20SemicolonRoutines
-};
-static char32_t escLeftBracket20SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket20SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket20Routines[] = {
-	f9KeyRoutine, escLeftBracket20SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket20Dispatch = {
-	2, "~;", escLeftBracket20Routines
-};
-static char32_t escLeftBracket20Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket20Dispatch);
-}
-
-// (S)-F10
-static CharacterDispatchRoutine escLeftBracket21Semicolon2Routines[] = {
-	f10KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket21Semicolon2Dispatch = {
-	1, "~", escLeftBracket21Semicolon2Routines
-};
-static char32_t escLeftBracket21Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket21Semicolon2Dispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket21SemicolonRoutines[] = {
-	escLeftBracket21Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket21SemicolonDispatch = {
-	1, "2", escLeftBracket21SemicolonRoutines
-};
-static char32_t escLeftBracket21SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket21SemicolonDispatch);
-}
-
-static CharacterDispatchRoutine escLeftBracket21Routines[] = {
-	f10KeyRoutine, escLeftBracket21SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket21Dispatch = {
-	2, "~;", escLeftBracket21Routines
-};
-static char32_t escLeftBracket21Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket21Dispatch);
+	return ( 0 );
 }
 
-// (S)-F11
-static CharacterDispatchRoutine escLeftBracket23Semicolon2Routines[] = {
-	f11KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket23Semicolon2Dispatch = {
-	1, "~", escLeftBracket23Semicolon2Routines
-};
-static char32_t escLeftBracket23Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket23Semicolon2Dispatch);
+inline bool is_parameter_byte( char32_t c ) {
+	return ( ( c >= 0x30 ) && ( c <= 0x3f ) );
 }
 
-static CharacterDispatchRoutine escLeftBracket23SemicolonRoutines[] = {
-	escLeftBracket23Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket23SemicolonDispatch = {
-	1, "2", escLeftBracket23SemicolonRoutines
-};
-static char32_t escLeftBracket23SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket23SemicolonDispatch);
+inline bool is_intermediate_byte( char32_t c ) {
+	return ( ( c >= 0x20 ) && ( c <= 0x2f ) );
 }
 
-static CharacterDispatchRoutine escLeftBracket23Routines[] = {
-	f11KeyRoutine, escLeftBracket23SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket23Dispatch = {
-	2, "~;", escLeftBracket23Routines
-};
-static char32_t escLeftBracket23Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket23Dispatch);
+inline bool is_final_byte( char32_t c ) {
+	return ( ( c >= 0x40 ) && ( c <= 0x7e ) );
 }
 
-// (S)-F12
-static CharacterDispatchRoutine escLeftBracket24Semicolon2Routines[] = {
-	f12KeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket24Semicolon2Dispatch = {
-	1, "~", escLeftBracket24Semicolon2Routines
-};
-static char32_t escLeftBracket24Semicolon2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	thisKeyMetaCtrl |= Replxx::KEY::BASE_SHIFT;
-	return doDispatch(c, escLeftBracket24Semicolon2Dispatch);
 }
 
-static CharacterDispatchRoutine escLeftBracket24SemicolonRoutines[] = {
-	escLeftBracket24Semicolon2Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket24SemicolonDispatch = {
-	1, "2", escLeftBracket24SemicolonRoutines
-};
-static char32_t escLeftBracket24SemicolonRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket24SemicolonDispatch);
+EscapeSequenceDecoder::EscapeSequenceDecoder( void )
+	: _state( STATE::GROUND )
+	, _modifiers( 0 )
+	, _params()
+	, _paramCount( 0 )
+	, _unsupported( false ) {
 }
 
-static CharacterDispatchRoutine escLeftBracket24Routines[] = {
-	f12KeyRoutine, escLeftBracket24SemicolonRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket24Dispatch = {
-	2, "~;", escLeftBracket24Routines
-};
-static char32_t escLeftBracket24Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket24Dispatch);
+void EscapeSequenceDecoder::reset( void ) {
+	_state = STATE::GROUND;
+	_modifiers = 0;
+	for ( int& p : _params ) {
+		p = 0;
+	}
+	_paramCount = 0;
+	_unsupported = false;
+}
+
+bool EscapeSequenceDecoder::decode( char32_t code_, char32_t& key_ ) {
+	switch ( _state ) {
+		case ( STATE::GROUND ): {
+			if ( code_ == 0x1b ) {
+				_state = STATE::ESCAPE;
+				return ( false );
+			}
+			return ( finish( code_ == 0x7f ? Replxx::KEY::BACKSPACE : code_, key_ ) );
+		}
+		case ( STATE::ESCAPE ): {
+			if ( code_ == '[' ) {
+				_state = STATE::CSI;
+				_paramCount = 1;
+				return ( false );
+			}
+			if ( code_ == 'O' ) {
+				_state = STATE::SS3;
+				return ( false );
+			}
+			// ESC is a Meta prefix for the next key,
+			// another ESC keeps us in escape processing mode.
+			_modifiers = Replxx::KEY::BASE_META;
+			if ( code_ == 0x1b ) {
+				return ( false );
+			}
+			return ( finish( code_ == 0x7f ? Replxx::KEY::BACKSPACE : code_, key_ ) );
+		}
+		case ( STATE::CSI ): {
+			if ( ( code_ >= '0' ) && ( code_ <= '9' ) ) {
+				if ( _paramCount <= MAX_PARAMS ) {
+					int& p( _params[_paramCount - 1] );
+					p = p * 10 + static_cast<int>( code_ - '0' );
+					if ( p > 0xffff ) {
+						_unsupported = true;
+					}
+				}
+			} else if ( code_ == ';' ) {
+				++ _paramCount;
+			} else if ( is_parameter_byte( code_ ) || is_intermediate_byte( code_ ) ) {
+				_unsupported = true;
+			} else if ( is_final_byte( code_ ) ) {
+				return ( finish_csi( code_, key_ ) );
+			} else {
+				// Not a part of a valid sequence, drop whatever we got so far.
+				return ( finish( INVALID, key_ ) );
+			}
+			return ( false );
+		}
+		case ( STATE::SS3 ): {
+			if ( ( code_ >= '0' ) && ( code_ <= '9' ) ) {
+				_params[1] = _params[1] * 10 + static_cast<int>( code_ - '0' );
+				_paramCount = 2;
+				if ( _params[1] > 0xffff ) {
+					_unsupported = true;
+				}
+				return ( false );
+			}
+			return ( finish_ss3( code_, key_ ) );
+		}
+	}
+	return ( false );
 }
 
-// Handle ESC [ 2 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket2Routines[] = {
-	insertKeyRoutine,
-	escLeftBracket20Routine,
-	escLeftBracket21Routine,
-	escLeftBracket23Routine,
-	escLeftBracket24Routine,
-	escFailureRoutine
-};
-static CharacterDispatch escLeftBracket2Dispatch = {
-	5, "~0134", escLeftBracket2Routines
-};
-
-// Handle ESC [ 3 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket3Routines[] = {
-	deleteKeyRoutine, escFailureRoutine
-};
-
-static CharacterDispatch escLeftBracket3Dispatch = {
-	1, "~", escLeftBracket3Routines
-};
-
-// Handle ESC [ 4 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket4Routines[] = {
-	endKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket4Dispatch = {
-	1, "~", escLeftBracket4Routines
-};
-
-// Handle ESC [ 5 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket5Routines[] = {
-	pageUpKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket5Dispatch = {
-	1, "~", escLeftBracket5Routines
-};
-
-// Handle ESC [ 6 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket6Routines[] = {
-	pageDownKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket6Dispatch = {
-	1, "~", escLeftBracket6Routines
-};
-
-// Handle ESC [ 7 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket7Routines[] = {
-	homeKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket7Dispatch = {
-	1, "~", escLeftBracket7Routines
-};
-
-// Handle ESC [ 8 <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracket8Routines[] = {
-	endKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracket8Dispatch = {
-	1, "~", escLeftBracket8Routines
-};
-
-// Handle ESC [ <digit> escape sequences
-//
-static char32_t escLeftBracket0Routine(char32_t c) {
-	return escFailureRoutine(c);
-}
-static char32_t escLeftBracket1Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket1Dispatch);
-}
-static char32_t escLeftBracket2Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket2Dispatch);
-}
-static char32_t escLeftBracket3Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket3Dispatch);
-}
-static char32_t escLeftBracket4Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket4Dispatch);
-}
-static char32_t escLeftBracket5Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket5Dispatch);
-}
-static char32_t escLeftBracket6Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket6Dispatch);
-}
-static char32_t escLeftBracket7Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket7Dispatch);
-}
-static char32_t escLeftBracket8Routine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracket8Dispatch);
-}
-static char32_t escLeftBracket9Routine(char32_t c) {
-	return escFailureRoutine(c);
+char32_t EscapeSequenceDecoder::modifiers( void ) const {
+	char32_t m( _modifiers );
+	if ( ( _paramCount < 2 ) || ( _params[1] < 2 ) ) {
+		return ( m );
+	}
+	int mod( _params[1] - 1 );
+	if ( mod & 1 ) {
+		m |= Replxx::KEY::BASE_SHIFT;
+	}
+	if ( mod & 2 ) {
+		m |= Replxx::KEY::BASE_META;
+	}
+	if ( mod & 4 ) {
+		m |= Replxx::KEY::BASE_CONTROL;
+	}
+	return ( m );
 }
 
-// Handle ESC [ <more stuff> escape sequences
-//
-static CharacterDispatchRoutine escLeftBracketRoutines[] = {
-	upArrowKeyRoutine,      downArrowKeyRoutine,    rightArrowKeyRoutine,
-	leftArrowKeyRoutine,    homeKeyRoutine,         endKeyRoutine,
-	escLeftBracket0Routine, escLeftBracket1Routine, escLeftBracket2Routine,
-	escLeftBracket3Routine, escLeftBracket4Routine, escLeftBracket5Routine,
-	escLeftBracket6Routine, escLeftBracket7Routine, escLeftBracket8Routine,
-	escLeftBracket9Routine, escFailureRoutine
-};
-static CharacterDispatch escLeftBracketDispatch = {16, "ABCDHF0123456789",
-																									 escLeftBracketRoutines};
-
-// Handle ESC O <char> escape sequences
-//
-static CharacterDispatchRoutine escORoutines[] = {
-	upArrowKeyRoutine,       downArrowKeyRoutine,     rightArrowKeyRoutine,
-	leftArrowKeyRoutine,     homeKeyRoutine,          endKeyRoutine,
-	f1KeyRoutine,            f2KeyRoutine,            f3KeyRoutine,
-	f4KeyRoutine,
-	ctrlUpArrowKeyRoutine,   ctrlDownArrowKeyRoutine, ctrlRightArrowKeyRoutine,
-	ctrlLeftArrowKeyRoutine, escFailureRoutine
-};
-static CharacterDispatch escODispatch = {14, "ABCDHFPQRSabcd", escORoutines};
-
-// Initial ESC dispatch -- could be a Meta prefix or the start of an escape
-// sequence
-//
-static char32_t escLeftBracketRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escLeftBracketDispatch);
-}
-static char32_t escORoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escODispatch);
+bool EscapeSequenceDecoder::finish_csi( char32_t final_, char32_t& key_ ) {
+	if ( _unsupported || ( _paramCount > MAX_PARAMS ) ) {
+		return ( finish( INVALID, key_ ) );
+	}
+	char32_t key( 0 );
+	if ( final_ == '~' ) {
+		int n( _params[0] );
+		if ( n < static_cast<int>( sizeof ( tildeKeys ) / sizeof ( tildeKeys[0] ) ) ) {
+			key = tildeKeys[n];
+		}
+	} else if ( _params[0] <= 1 ) {
+		key = find_key( csiFinalKeys, final_ );
+	}
+	return ( finish( key ? modifiers() | key : INVALID, key_ ) );
 }
-static char32_t setMetaRoutine(char32_t c);	// need forward reference
-static CharacterDispatchRoutine escRoutines[] = {
-	escLeftBracketRoutine, escORoutine, setMetaRoutine
-};
-static CharacterDispatch escDispatch = {2, "[O", escRoutines};
 
-// Initial dispatch -- we are not in the middle of anything yet
-//
-static char32_t escRoutine(char32_t c) {
-	c = read_unicode_character();
-	if (c == 0) return 0;
-	return doDispatch(c, escDispatch);
+bool EscapeSequenceDecoder::finish_ss3( char32_t final_, char32_t& key_ ) {
+	char32_t key( _unsupported ? 0 : find_key( ss3FinalKeys, final_ ) );
+	return ( finish( key ? modifiers() | key : INVALID, key_ ) );
 }
-static CharacterDispatchRoutine initialRoutines[] = {
-	escRoutine, deleteCharRoutine, normalKeyRoutine
-};
-static CharacterDispatch initialDispatch = {2, "\x1B\x7F", initialRoutines};
 
-// Special handling for the ESC key because it does double duty
-//
-static char32_t setMetaRoutine(char32_t c) {
-	thisKeyMetaCtrl = Replxx::KEY::BASE_META;
-	if (c == 0x1B) {	// another ESC, stay in ESC processing mode
-		c = read_unicode_character();
-		if (c == 0) return 0;
-		return doDispatch(c, escDispatch);
-	}
-	return doDispatch(c, initialDispatch);
+void EscapeSequenceDecoder::flush( char32_t& key_ ) {
+	finish( _state == STATE::ESCAPE ? static_cast<char32_t>( Replxx::KEY::ESCAPE ) : INVALID, key_ );
 }
 
-char32_t doDispatch(char32_t c) {
-	EscapeSequenceProcessing::thisKeyMetaCtrl = 0;	// no modifiers yet at initialDispatch
-	return doDispatch(c, initialDispatch);
+bool EscapeSequenceDecoder::finish( char32_t key_, char32_t& out_ ) {
+	out_ = ( key_ != INVALID ) ? ( _modifiers | key_ ) : INVALID;
+	reset();
+	return ( true );
 }
 
-}	// namespace EscapeSequenceProcessing // move these out of global namespace
-
 }
 
 #endif /* #ifndef _WIN32 */
@@ -3,34 +3,60 @@
 
 namespace replxx {
 
-namespace EscapeSequenceProcessing {
-
-// This is a typedef for the routine called by doDispatch().	It takes the
-// current character
-// as input, does any required processing including reading more characters and
-// calling other
-// dispatch routines, then eventually returns the final (possibly extended or
-// special) character.
+// Incremental decoder of the key sequences sent by terminals.
 //
-typedef char32_t (*CharacterDispatchRoutine)(char32_t);
-
-// This structure is used by doDispatch() to hold a list of characters to test
-// for and
-// a list of routines to call if the character matches.	The dispatch routine
-// list is one
-// longer than the character list; the final entry is used if no character
-// matches.
+// Decoder is fed with code points one at a time and reports a key as soon
+// as a complete sequence has been seen, so it never reads from the terminal
+// by itself and never blocks. All decoding state lives in the object,
+// independent decoders can run concurrently.
+//
+// Recognized sequences:
+//   ESC <key>                        - Meta modified <key>
+//   ESC [ <params> <final>           - CSI (ECMA-48) sequences, e.g. arrows,
+//                                      Home/End, F1-F4, ESC [ n ~ editing and
+//                                      function keys
+//   ESC O [<mod>] <final>            - SS3 sequences
+// where optional <params> is `n` or `n;mod` and `mod` is the xterm modifier
+// parameter (1 + Shift:1 | Alt:2 | Control:4).
+// Unrecognized CSI sequences are consumed up to and including their
+// final byte and reported as an invalid key.
 //
-struct CharacterDispatch {
-	unsigned int len;                   // length of the chars list
-	const char* chars;                  // chars to test
-	CharacterDispatchRoutine* dispatch; // array of routines to call
+class EscapeSequenceDecoder {
+public:
+	static char32_t const INVALID = static_cast<char32_t>( -1 );
+private:
+	enum class STATE {
+		GROUND,
+		ESCAPE,
+		CSI,
+		SS3
+	};
+	static int const MAX_PARAMS = 2;
+	STATE _state;
+	char32_t _modifiers;      // modifiers collected so far (e.g. Meta from ESC prefix)
+	int _params[MAX_PARAMS];  // numeric parameters of current CSI/SS3 sequence
+	int _paramCount;
+	bool _unsupported;        // sequence has private or intermediate bytes
+public:
+	EscapeSequenceDecoder( void );
+	// Feed next code point into the decoder.
+	// Returns true and sets key_ if code point completed a key sequence,
+	// key_ is set to INVALID if sequence was not recognized.
+	bool decode( char32_t code_, char32_t& key_ );
+	bool pending( void ) const {
+		return ( _state != STATE::GROUND );
+	}
+	// Give up on pending sequence, e.g. when the rest of it did not arrive in time,
+	// lone ESC is reported as ESC key, incomplete CSI/SS3 sequence as an invalid key.
+	void flush( char32_t& key_ );
+	void reset( void );
+private:
+	bool finish_csi( char32_t, char32_t& );
+	bool finish_ss3( char32_t, char32_t& );
+	bool finish( char32_t, char32_t& );
+	char32_t modifiers( void ) const;
 };
 
-char32_t doDispatch(char32_t c);
-
-}
-
 }
 
 #endif
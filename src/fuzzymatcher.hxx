@@ -0,0 +1,212 @@
+#ifndef REPLXX_FUZZYMATCHER_HXX_INCLUDED
+#define REPLXX_FUZZYMATCHER_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include "replxx.hxx"
+
+namespace replxx {
+
+// Ranks candidates by how well pattern matches them as a subsequence.
+//
+// Matching is ASCII case insensitive, other bytes must match exactly.
+// Matched characters at word boundaries (start of text, after separator,
+// camelCase hump, start of digits) and runs of consecutive matches score
+// higher, gaps between matches lower the score.
+// Every candidate has a bitmask of characters it contains, candidates
+// missing a character of the pattern are rejected without scanning them.
+class FuzzyMatcher {
+public:
+	typedef uint64_t mask_t;
+	static int const SCORE_MATCH = 16;
+	static int const BONUS_START = 10;
+	static int const BONUS_SEPARATOR = 8;
+	static int const BONUS_CAMEL = 7;
+	static int const BONUS_CONSECUTIVE = 4;
+	static int const BONUS_CASE = 1;
+	static int const PENALTY_GAP_START = 3;
+	static int const PENALTY_GAP = 1;
+private:
+	struct Match {
+		int score;
+		int size;
+		int index;
+		// better matches go first
+		bool operator < ( Match const& other_ ) const {
+			if ( score != other_.score ) {
+				return ( score > other_.score );
+			}
+			if ( size != other_.size ) {
+				return ( size < other_.size );
+			}
+			return ( index < other_.index );
+		}
+	};
+	std::string _pattern;
+	mask_t _mask;
+	std::vector<Match> _top; // heap of best matches, worst on top
+public:
+	FuzzyMatcher( void )
+		: _pattern()
+		, _mask( 0 )
+		, _top() {
+	}
+	static mask_t char_mask( char c_ ) {
+		unsigned char c( static_cast<unsigned char>( fold( c_ ) ) );
+		if ( ( c >= 'a' ) && ( c <= 'z' ) ) {
+			return ( mask_t( 1 ) << ( c - 'a' ) );
+		}
+		if ( ( c >= '0' ) && ( c <= '9' ) ) {
+			return ( mask_t( 1 ) << ( 26 + c - '0' ) );
+		}
+		if ( c < 0x80 ) {
+			return ( mask_t( 1 ) << ( 36 + c % 27 ) );
+		}
+		return ( mask_t( 1 ) << 63 );
+	}
+	static mask_t text_mask( char const* text_, int size_ ) {
+		mask_t mask( 0 );
+		for ( int i( 0 ); i < size_; ++ i ) {
+			mask |= char_mask( text_[i] );
+		}
+		return ( mask );
+	}
+	void set_pattern( char const* pattern_, int size_ ) {
+		_pattern.assign( pattern_, static_cast<size_t>( size_ ) );
+		_mask = text_mask( pattern_, size_ );
+	}
+	// False if text with given mask lacks some character of the pattern.
+	bool may_match( mask_t mask_ ) const {
+		return ( ( _mask & ~mask_ ) == 0 );
+	}
+	// Score of the match, -1 if pattern is not a subsequence of text_.
+	int score( char const* text_, int size_, mask_t mask_ ) const {
+		if ( ! may_match( mask_ ) ) {
+			return ( -1 );
+		}
+		int patternSize( static_cast<int>( _pattern.length() ) );
+		if ( patternSize == 0 ) {
+			return ( 0 );
+		}
+		// first position where whole pattern is matched
+		int p( 0 );
+		int end( 0 );
+		for ( ; ( end < size_ ) && ( p < patternSize ); ++ end ) {
+			if ( fold( text_[end] ) == fold( _pattern[p] ) ) {
+				++ p;
+			}
+		}
+		if ( p < patternSize ) {
+			return ( -1 );
+		}
+		// shortest match ending there
+		int start( end );
+		for ( p = patternSize - 1; p >= 0; -- p ) {
+			do {
+				-- start;
+			} while ( fold( text_[start] ) != fold( _pattern[p] ) );
+		}
+		int score( 0 );
+		bool inRun( false );
+		bool inGap( false );
+		p = 0;
+		for ( int i( start ); i < end; ++ i ) {
+			if ( ( p < patternSize ) && ( fold( text_[i] ) == fold( _pattern[p] ) ) ) {
+				int bonus( boundary_bonus( text_, i ) );
+				if ( inRun ) {
+					bonus = std::max( bonus, BONUS_CONSECUTIVE );
+				}
+				score += SCORE_MATCH + bonus + ( text_[i] == _pattern[p] ? BONUS_CASE : 0 );
+				inRun = true;
+				inGap = false;
+				++ p;
+			} else {
+				score -= inGap ? PENALTY_GAP : PENALTY_GAP_START;
+				inRun = false;
+				inGap = true;
+			}
+		}
+		return ( std::max( score, 0 ) );
+	}
+	int score( char const* text_, int size_ ) const {
+		return ( score( text_, size_, text_mask( text_, size_ ) ) );
+	}
+	// Add at most maxResults_ best matching candidates to out_, best first.
+	int rank( Replxx::Candidates const& candidates_, Replxx::Candidates& out_, int maxResults_ ) {
+		_top.clear();
+		for ( int i( 0 ), count( candidates_.size() ); i < count; ++ i ) {
+			Replxx::StringView c( candidates_.get( i ) );
+			offer( c.data(), c.size(), text_mask( c.data(), c.size() ), i, maxResults_ );
+		}
+		return ( take( out_, [&candidates_]( int index_ ) { return ( candidates_.get( index_ ) ); } ) );
+	}
+	// Consider candidate for top maxResults_ matches.
+	void offer( char const* text_, int size_, mask_t mask_, int index_, int maxResults_ ) {
+		if ( maxResults_ <= 0 ) {
+			return;
+		}
+		int s( score( text_, size_, mask_ ) );
+		if ( s < 0 ) {
+			return;
+		}
+		Match m{ s, size_, index_ };
+		if ( static_cast<int>( _top.size() ) < maxResults_ ) {
+			_top.push_back( m );
+			std::push_heap( _top.begin(), _top.end() );
+		} else if ( m < _top.front() ) {
+			std::pop_heap( _top.begin(), _top.end() );
+			_top.back() = m;
+			std::push_heap( _top.begin(), _top.end() );
+		}
+	}
+	// Move offered matches to out_, best first, get_( index ) gives candidate text.
+	template<typename get_t>
+	int take( Replxx::Candidates& out_, get_t get_ ) {
+		std::sort_heap( _top.begin(), _top.end() );
+		for ( Match const& m : _top ) {
+			Replxx::StringView c( get_( m.index ) );
+			out_.add( c.data(), c.size() );
+		}
+		int count( static_cast<int>( _top.size() ) );
+		_top.clear();
+		return ( count );
+	}
+private:
+	static char fold( char c_ ) {
+		return ( ( c_ >= 'A' ) && ( c_ <= 'Z' ) ? static_cast<char>( c_ - 'A' + 'a' ) : c_ );
+	}
+	static bool is_lower( char c_ ) {
+		return ( ( c_ >= 'a' ) && ( c_ <= 'z' ) );
+	}
+	static bool is_upper( char c_ ) {
+		return ( ( c_ >= 'A' ) && ( c_ <= 'Z' ) );
+	}
+	static bool is_digit( char c_ ) {
+		return ( ( c_ >= '0' ) && ( c_ <= '9' ) );
+	}
+	static bool is_separator( char c_ ) {
+		return ( ( c_ == '_' ) || ( c_ == '-' ) || ( c_ == '.' ) || ( c_ == '/' ) || ( c_ == ' ' ) || ( c_ == ':' ) );
+	}
+	static int boundary_bonus( char const* text_, int i_ ) {
+		if ( i_ == 0 ) {
+			return ( BONUS_START );
+		}
+		char prev( text_[i_ - 1] );
+		char cur( text_[i_] );
+		if ( is_separator( prev ) ) {
+			return ( BONUS_SEPARATOR );
+		}
+		if ( ( is_lower( prev ) && is_upper( cur ) ) || ( ! is_digit( prev ) && is_digit( cur ) ) ) {
+			return ( BONUS_CAMEL );
+		}
+		return ( 0 );
+	}
+};
+
+}
+
+#endif
+
@@ -31,6 +31,7 @@
 #include "escape.hxx"
 #include "replxx.hxx"
 #include "util.hxx"
+#include "latency.hxx"
 
 using namespace std;
 
@@ -61,9 +62,125 @@ bool is_a_tty( int fd_ ) {
 
 bool in( is_a_tty( 0 ) );
 bool out( is_a_tty( 1 ) );
+#ifndef _WIN32
+std::atomic<int> resizeGeneration( 0 );
+#endif
+
+}
+
+#ifndef _WIN32
+
+TtyBackend::TtyBackend( void )
+	: _in( 0 )
+	, _out( 1 )
+	, _standard( true )
+	, _inTty( tty::in )
+	, _outTty( tty::out )
+	, _origTermios() {
+}
+
+void TtyBackend::set_fds( int in_, int out_ ) {
+	_in = in_;
+	_out = out_;
+	_standard = false;
+	_inTty = tty::is_a_tty( in_ );
+	_outTty = tty::is_a_tty( out_ );
+}
+
+/**
+ * SIGWINCH is delivered for the controlling terminal only,
+ * screen size changes of other descriptors are reported with window_changed().
+ */
+int TtyBackend::resize_generation( void ) const {
+	return ( _standard ? tty::resizeGeneration.load() : 0 );
+}
+
+int TtyBackend::read( char* data_, int size_ ) {
+	ssize_t nread( 0 );
+	/* Continue reading if interrupted by signal. */
+	do {
+		nread = ::read( _in, data_, static_cast<size_t>( size_ ) );
+	} while ( ( nread == -1 ) && ( errno == EINTR ) );
+	return ( static_cast<int>( nread ) );
+}
+
+int TtyBackend::write( char const* data_, int size_ ) {
+	return ( static_cast<int>( ::write( _out, data_, static_cast<size_t>( size_ ) ) ) );
+}
+
+bool TtyBackend::input_ready( void ) {
+	fd_set fdSet;
+	FD_ZERO( &fdSet );
+	FD_SET( _in, &fdSet );
+	timeval tv{ 0, 0 };
+	return ( select( _in + 1, &fdSet, nullptr, nullptr, &tv ) > 0 );
+}
+
+int TtyBackend::input_fd( void ) {
+	return ( _in );
+}
+
+int TtyBackend::screen_columns( void ) {
+	struct winsize ws;
+	return ( ( ioctl( _out, TIOCGWINSZ, &ws ) == -1 ) ? 80 : ws.ws_col );
+}
+
+int TtyBackend::screen_rows( void ) {
+	struct winsize ws;
+	return ( ( ioctl( _out, TIOCGWINSZ, &ws ) == -1 ) ? 24 : ws.ws_row );
+}
 
+namespace {
+inline int notty( void ) {
+	errno = ENOTTY;
+	return ( -1 );
+}
 }
 
+int TtyBackend::enable_raw_mode( void ) {
+	struct termios raw;
+
+	if ( ! _inTty ) {
+		/* socket of remote session, peer is responsible for raw mode */
+		return ( _standard ? notty() : 0 );
+	}
+	if ( tcgetattr( _in, &_origTermios ) == -1 ) {
+		return ( notty() );
+	}
+
+	raw = _origTermios; /* modify the original mode */
+	/* input modes: no break, no CR to NL, no parity check, no strip char,
+	 * no start/stop output control. */
+	raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+	/* output modes - disable post processing */
+	// this is wrong, we don't want raw output, it turns newlines into straight
+	// linefeeds
+	// raw.c_oflag &= ~(OPOST);
+	/* control modes - set 8 bit chars */
+	raw.c_cflag |= (CS8);
+	/* local modes - echoing off, canonical off, no extended functions,
+	 * no signal chars (^Z,^C) */
+	raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+	/* control chars - set return condition: min number of bytes and timer.
+	 * We want read to return every single byte, without timeout. */
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0; /* 1 byte, no timer */
+
+	/* put terminal in raw mode after flushing */
+	if ( tcsetattr( _in, TCSADRAIN, &raw ) < 0 ) {
+		return ( notty() );
+	}
+	return ( 0 );
+}
+
+void TtyBackend::disable_raw_mode( void ) {
+	if ( _inTty ) {
+		static_cast<void>( tcsetattr( _in, TCSADRAIN, &_origTermios ) == 0 );
+	}
+}
+
+#endif
+
 Terminal::Terminal( void )
 #ifdef _WIN32
 	: _consoleOut()
@@ -75,10 +192,27 @@ Terminal::Terminal( void )
 	, _interrupt( INVALID_HANDLE_VALUE )
 	, _events()
 #else
-	: _origTermios()
+	: _tty()
+	, _fdTty()
+	, _backend( &_tty )
 	, _interrupt()
+	, _inputNotified( false )
+	, _inputBuffer()
+	, _inputHead( 0 )
+	, _inputTail( 0 )
+	, _utf8Pending( 0 )
+	, _utf8CodePoint( 0 )
+	, _utf8Lower( 0x80 )
+	, _utf8Upper( 0xbf )
+	, _escapeDecoder()
+	, _escapeTimeout( 0 )
+	, _escapeDeadline()
+	, _recorder()
+	, _resized( false )
+	, _recordedGeneration( 0 )
 #endif
-	, _rawMode( false ) {
+	, _rawMode( false )
+	, _latency( nullptr ) {
 #ifdef _WIN32
 	_interrupt = CreateEvent( nullptr, true, false, TEXT( "replxx_interrupt_event" ) );
 #else
@@ -93,6 +227,7 @@ Terminal::~Terminal( void ) {
 #ifdef _WIN32
 	CloseHandle( _interrupt );
 #else
+	_backend->set_input_notifier( nullptr );
 	static_cast<void>( ::close( _interrupt[0] ) == 0 );
 	static_cast<void>( ::close( _interrupt[1] ) == 0 );
 #endif
@@ -104,23 +239,15 @@ void Terminal::write32( char32_t const* text32, int len32 ) {
 	int count8 = 0;
 
 	copyString32to8(text8.get(), len8, text32, len32, &count8);
-	int nWritten( 0 );
-#ifdef _WIN32
-	nWritten = win_write( text8.get(), count8 );
-#else
-	nWritten = write( 1, text8.get(), count8 );
-#endif
-	if ( nWritten != count8 ) {
-		throw std::runtime_error( "write failed" );
-	}
-	return;
+	write8( text8.get(), count8 );
 }
 
 void Terminal::write8( char const* data_, int size_ ) {
+	LatencyTimer timer( _latency, Replxx::LATENCY_PHASE::WRITE, size_ );
 #ifdef _WIN32
 	int nWritten( win_write( data_, size_ ) );
 #else
-	int nWritten( write( 1, data_, size_ ) );
+	int nWritten( _backend->write( data_, size_ ) );
 #endif
 	if ( nWritten != size_ ) {
 		throw std::runtime_error( "write failed" );
@@ -135,8 +262,7 @@ int Terminal::get_screen_columns( void ) {
 	GetConsoleScreenBufferInfo( _consoleOut, &inf );
 	cols = inf.dwSize.X;
 #else
-	struct winsize ws;
-	cols = ( ioctl( 1, TIOCGWINSZ, &ws ) == -1 ) ? 80 : ws.ws_col;
+	cols = _backend->screen_columns();
 #endif
 	// cols is 0 in certain circumstances like inside debugger, which creates
 	// further issues
@@ -150,19 +276,11 @@ int Terminal::get_screen_rows( void ) {
 	GetConsoleScreenBufferInfo( _consoleOut, &inf );
 	rows = 1 + inf.srWindow.Bottom - inf.srWindow.Top;
 #else
-	struct winsize ws;
-	rows = (ioctl(1, TIOCGWINSZ, &ws) == -1) ? 24 : ws.ws_row;
+	rows = _backend->screen_rows();
 #endif
 	return (rows > 0) ? rows : 24;
 }
 
-namespace {
-inline int notty( void ) {
-	errno = ENOTTY;
-	return ( -1 );
-}
-}
-
 int Terminal::enable_raw_mode( void ) {
 	if ( ! _rawMode ) {
 #ifdef _WIN32
@@ -176,36 +294,8 @@ int Terminal::enable_raw_mode( void ) {
 			_oldMode & ~( ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT )
 		);
 #else
-		struct termios raw;
-
-		if ( ! tty::in ) {
-			return ( notty() );
-		}
-		if ( tcgetattr( 0, &_origTermios ) == -1 ) {
-			return ( notty() );
-		}
-
-		raw = _origTermios; /* modify the original mode */
-		/* input modes: no break, no CR to NL, no parity check, no strip char,
-		 * no start/stop output control. */
-		raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-		/* output modes - disable post processing */
-		// this is wrong, we don't want raw output, it turns newlines into straight
-		// linefeeds
-		// raw.c_oflag &= ~(OPOST);
-		/* control modes - set 8 bit chars */
-		raw.c_cflag |= (CS8);
-		/* local modes - echoing off, canonical off, no extended functions,
-		 * no signal chars (^Z,^C) */
-		raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
-		/* control chars - set return condition: min number of bytes and timer.
-		 * We want read to return every single byte, without timeout. */
-		raw.c_cc[VMIN] = 1;
-		raw.c_cc[VTIME] = 0; /* 1 byte, no timer */
-
-		/* put terminal in raw mode after flushing */
-		if ( tcsetattr(0, TCSADRAIN, &raw) < 0 ) {
-			return ( notty() );
+		if ( _backend->enable_raw_mode() == -1 ) {
+			return ( -1 );
 		}
 #endif
 		_rawMode = true;
@@ -222,62 +312,266 @@ void Terminal::disable_raw_mode(void) {
 		_consoleIn = 0;
 		_consoleOut = 0;
 #else
-		if ( tcsetattr( 0, TCSADRAIN, &_origTermios ) == -1 ) {
-			return;
-		}
+		_backend->disable_raw_mode();
 #endif
 		_rawMode = false;
 	}
 }
 
+char32_t const Terminal::INPUT_PENDING;
+
+bool Terminal::has_custom_backend( void ) const {
+#ifdef _WIN32
+	return ( false );
+#else
+	return ( _backend != &_tty );
+#endif
+}
+
+/**
+ * Custom backends are terminals by definition, sessions on descriptors
+ * given with set_fds() are interactive even over a socket.
+ */
+bool Terminal::in_tty( void ) const {
+#ifdef _WIN32
+	return ( tty::in );
+#else
+	return ( ( _backend != &_tty ) || _tty.in_tty() );
+#endif
+}
+
+bool Terminal::out_tty( void ) const {
+#ifdef _WIN32
+	return ( tty::out );
+#else
+	return ( ( _backend != &_tty ) || _tty.out_tty() );
+#endif
+}
+
 #ifndef _WIN32
 
+void Terminal::set_backend( Replxx::TerminalBackend* backend_ ) {
+	_backend->set_input_notifier( nullptr );
+	_backend = backend_ ? backend_ : &_tty;
+	_backend->set_input_notifier( [this]() { notify_input(); } );
+	_inputHead = _inputTail = 0;
+	_utf8Pending = 0;
+	_utf8Lower = 0x80;
+	_utf8Upper = 0xbf;
+	_escapeDecoder.reset();
+	_escapeDeadline = std::chrono::steady_clock::time_point();
+	_resized = false;
+	_recordedGeneration = resize_generation();
+}
+
+/**
+ * Use given descriptors as terminal, e.g. pty or socket of a remote session.
+ */
+void Terminal::set_fds( int in_, int out_ ) {
+	_fdTty.set_fds( in_, out_ );
+	set_backend( &_fdTty );
+}
+
+/**
+ * Record all input read from the terminal and screen size changes to a file.
+ */
+int Terminal::start_recording( std::string const& filename_ ) {
+	if ( _recorder.open( filename_ ) != 0 ) {
+		return ( -1 );
+	}
+	_recordedGeneration = resize_generation();
+	_recorder.resize( get_screen_columns(), get_screen_rows() );
+	return ( 0 );
+}
+
+void Terminal::stop_recording( void ) {
+	_recorder.close();
+}
+
+/**
+ * Record current screen size, called only when it may have changed.
+ */
+void Terminal::record_resize( void ) {
+	if ( _recorder.is_open() ) {
+		_recorder.resize( get_screen_columns(), get_screen_rows() );
+	}
+}
+
+/**
+ * Generation of screen size changes reported with SIGWINCH, constant unless on standard terminal.
+ */
+int Terminal::resize_generation( void ) const {
+	return ( _backend == &_tty ? _tty.resize_generation() : 0 );
+}
+
+/**
+ * Check if terminal has bytes to read without blocking.
+ */
+bool Terminal::input_ready( void ) const {
+	return ( _backend->input_ready() );
+}
+
+/**
+ * Read all bytes currently available from the terminal into the input ring
+ * buffer with a single read() call.
+ *
+ * @return	number of bytes read, 0 on EOF, -1 on error
+ */
+int Terminal::fill_input_buffer( void ) {
+	unsigned offset( _inputTail & ( INPUT_BUFFER_SIZE - 1 ) );
+	unsigned space( INPUT_BUFFER_SIZE - ( _inputTail - _inputHead ) );
+	if ( space > ( INPUT_BUFFER_SIZE - offset ) ) {
+		space = INPUT_BUFFER_SIZE - offset;
+	}
+	if ( space == 0 ) {
+		return ( 0 );
+	}
+	int nread( _backend->read( reinterpret_cast<char*>( _inputBuffer + offset ), static_cast<int>( space ) ) );
+	if ( nread > 0 ) {
+		if ( _recorder.is_open() ) {
+			int generation( resize_generation() );
+			if ( generation != _recordedGeneration ) {
+				_recordedGeneration = generation;
+				record_resize();
+			}
+			_recorder.input( reinterpret_cast<char const*>( _inputBuffer + offset ), nread );
+		}
+		_inputTail += static_cast<unsigned>( nread );
+	} else if ( ( nread < 0 ) && ( errno == EINTR ) ) {
+		// only custom backends report EINTR, tty backend retries interrupted reads
+		_resized = true;
+		record_resize();
+	}
+	return ( nread );
+}
+
+/**
+ * Incremental UTF-8 decoder.
+ *
+ * Consumes one byte at a time, rejects overlong forms, surrogates
+ * and code points beyond U+10FFFF. Malformed sequences are dropped
+ * and decoding resynchronizes on the next lead byte.
+ *
+ * @param byte_ - next byte from the input stream
+ * @param codePoint_ - decoded code point, valid only if true is returned
+ * @return	true iff byte_ completed a code point
+ */
+bool Terminal::decode_utf8( uchar8_t byte_, char32_t& codePoint_ ) {
+	if ( _utf8Pending > 0 ) {
+		if ( ( byte_ >= _utf8Lower ) && ( byte_ <= _utf8Upper ) ) {
+			_utf8CodePoint = ( _utf8CodePoint << 6 ) | ( byte_ & 0x3f );
+			_utf8Lower = 0x80;
+			_utf8Upper = 0xbf;
+			if ( -- _utf8Pending == 0 ) {
+				codePoint_ = _utf8CodePoint;
+				return ( true );
+			}
+			return ( false );
+		}
+		_utf8Pending = 0; // malformed sequence, retry byte_ as a lead byte
+		_utf8Lower = 0x80;
+		_utf8Upper = 0xbf;
+	}
+	if ( byte_ <= 0x7f ) {
+		codePoint_ = byte_;
+		return ( true );
+	}
+	if ( ( byte_ >= 0xc2 ) && ( byte_ <= 0xdf ) ) {
+		_utf8Pending = 1;
+		_utf8CodePoint = byte_ & 0x1f;
+	} else if ( ( byte_ >= 0xe0 ) && ( byte_ <= 0xef ) ) {
+		_utf8Pending = 2;
+		_utf8CodePoint = byte_ & 0x0f;
+		if ( byte_ == 0xe0 ) {
+			_utf8Lower = 0xa0; // overlong
+		} else if ( byte_ == 0xed ) {
+			_utf8Upper = 0x9f; // surrogates
+		}
+	} else if ( ( byte_ >= 0xf0 ) && ( byte_ <= 0xf4 ) ) {
+		_utf8Pending = 3;
+		_utf8CodePoint = byte_ & 0x07;
+		if ( byte_ == 0xf0 ) {
+			_utf8Lower = 0x90; // overlong
+		} else if ( byte_ == 0xf4 ) {
+			_utf8Upper = 0x8f; // beyond U+10FFFF
+		}
+	}
+	return ( false );
+}
+
 /**
  * Read a UTF-8 sequence from the non-Windows keyboard and return the Unicode
- * (char32_t) character it
- * encodes
+ * (char32_t) character it encodes.
+ *
+ * Bytes are served from the input buffer, terminal is read only when
+ * the buffer runs dry.
  *
- * @return	char32_t Unicode character
+ * @param wait_ - block until a complete character is available
+ * @return	char32_t Unicode character, 0 on EOF or read error,
+ *          INPUT_PENDING if !wait_ and no complete character is available yet
  */
-char32_t read_unicode_character(void) {
-	static uchar8_t utf8String[5];
-	static size_t utf8Count = 0;
-	while (true) {
-		uchar8_t c;
-
-		/* Continue reading if interrupted by signal. */
-		ssize_t nread;
-		do {
-			nread = read(0, &c, 1);
-		} while ((nread == -1) && (errno == EINTR));
-
-		if (nread <= 0) return 0;
-		if (c <= 0x7F || locale::is8BitEncoding) {	// short circuit ASCII
-			utf8Count = 0;
-			return c;
-		} else if (utf8Count < sizeof(utf8String) - 1) {
-			utf8String[utf8Count++] = c;
-			utf8String[utf8Count] = 0;
-			char32_t unicodeChar[2];
-			int ucharCount( 0 );
-			ConversionResult res = copyString8to32(unicodeChar, 2, ucharCount, utf8String);
-			if (res == conversionOK && ucharCount) {
-				utf8Count = 0;
-				return unicodeChar[0];
+char32_t Terminal::read_unicode_character( bool wait_ ) {
+	while ( true ) {
+		if ( ! has_buffered_input() ) {
+			if ( ! wait_ && ! input_ready() ) {
+				return ( INPUT_PENDING );
 			}
-		} else {
-			utf8Count = 0;	// this shouldn't happen: got four bytes but no UTF-8 character
+			if ( fill_input_buffer() <= 0 ) {
+				return ( 0 );
+			}
+		}
+		uchar8_t c( _inputBuffer[_inputHead & ( INPUT_BUFFER_SIZE - 1 )] );
+		++ _inputHead;
+		if ( locale::is8BitEncoding ) {
+			return ( c );
+		}
+		char32_t codePoint( 0 );
+		if ( decode_utf8( c, codePoint ) ) {
+			return ( codePoint );
 		}
 	}
 }
 
 #endif	// #ifndef _WIN32
 
-void beep() {
+void Terminal::beep( void ) {
+#ifndef _WIN32
+	if ( has_custom_backend() ) {
+		// other sessions must not ring the bell of the process' own terminal
+		write8( "\x7", 1 );
+		return;
+	}
+#endif
 	fprintf(stderr, "\x7");	// ctrl-G == bell/beep
 	fflush(stderr);
 }
 
+void Terminal::set_escape_timeout( int timeout_ ) {
+#ifdef _WIN32
+	static_cast<void>( timeout_ );
+#else
+	_escapeTimeout = timeout_;
+#endif
+}
+
+// Milliseconds left until non-blocking read gives up on pending escape sequence,
+// -1 if no escape sequence is pending.
+int long Terminal::escape_time_left( void ) const {
+#ifdef _WIN32
+	return ( -1 );
+#else
+	if ( ! _escapeDecoder.pending() || ( _escapeTimeout == 0 ) || ( _escapeDeadline == std::chrono::steady_clock::time_point() ) ) {
+		return ( -1 );
+	}
+	int long left(
+		static_cast<int long>(
+			std::chrono::duration_cast<std::chrono::milliseconds>( _escapeDeadline - std::chrono::steady_clock::now() ).count()
+		)
+	);
+	return ( left > 0 ? left : 0 );
+#endif
+}
+
 // replxx_read_char -- read a keystroke or keychord from the keyboard, and translate it
 // into an encoded "keystroke".	When convenient, extended keys are translated into their
 // simpler Emacs keystrokes, so an unmodified "left arrow" becomes Ctrl-B.
@@ -285,7 +579,12 @@ void beep() {
 // A return value of zero means "no input available", and a return value of -1
 // means "invalid key".
 //
-char32_t Terminal::read_char( void ) {
+// With wait_ == false the call never blocks, INPUT_PENDING is returned if
+// the terminal has no more data to complete current key sequence,
+// partially decoded sequence is kept until next call.
+// Non-blocking reads are supported on POSIX terminals only.
+//
+char32_t Terminal::read_char( bool wait_ ) {
 	char32_t c( 0 );
 #ifdef _WIN32
 	INPUT_RECORD rec;
@@ -428,9 +727,21 @@ char32_t Terminal::read_char( void ) {
 	}
 
 #else
-	c = read_unicode_character();
-	if (c == 0) {
-		return 0;
+	if ( escape_time_left() == 0 ) {
+		// rest of the sequence did not arrive in time, e.g. ESC key was pressed on its own
+		char32_t key( 0 );
+		_escapeDecoder.flush( key );
+		_escapeDeadline = std::chrono::steady_clock::time_point();
+		return ( translate_key( key ) );
+	}
+	c = read_unicode_character( wait_ );
+	if ( c == 0 ) {
+		_escapeDecoder.reset();
+		_escapeDeadline = std::chrono::steady_clock::time_point();
+		return ( 0 );
+	}
+	if ( c == INPUT_PENDING ) {
+		return ( c );
 	}
 
 // If _DEBUG_LINUX_KEYBOARD is set, then ctrl-^ puts us into a keyboard
@@ -492,20 +803,53 @@ char32_t Terminal::read_char( void ) {
 	}
 #endif // __REPLXX_DEBUG__
 
-	c = EscapeSequenceProcessing::doDispatch(c);
-	if ( is_control_code( c ) ) {
-		c = Replxx::KEY::control( c + 0x40 );
+	char32_t key( 0 );
+	while ( ! _escapeDecoder.decode( c, key ) ) {
+		c = read_unicode_character( wait_ );
+		if ( c == 0 ) {
+			_escapeDecoder.reset();
+			_escapeDeadline = std::chrono::steady_clock::time_point();
+			return ( 0 );
+		}
+		if ( c == INPUT_PENDING ) {
+			// decoder keeps partial sequence until more input arrives or the escape timeout passes
+			if ( _escapeDeadline == std::chrono::steady_clock::time_point() ) {
+				_escapeDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( _escapeTimeout );
+			}
+			return ( c );
+		}
 	}
+	_escapeDeadline = std::chrono::steady_clock::time_point();
+	c = translate_key( key );
 #endif // #_WIN32
 	return ( c );
 }
 
-Terminal::EVENT_TYPE Terminal::wait_for_input( void ) {
+#ifndef _WIN32
+
+// Turn decoded key into key code reported to the editor.
+char32_t Terminal::translate_key( char32_t key_ ) {
+	if ( key_ == EscapeSequenceDecoder::INVALID ) {
+		beep();
+		return ( key_ );
+	}
+	if ( is_control_code( key_ ) ) {
+		key_ = Replxx::KEY::control( key_ + 0x40 );
+	}
+	return ( key_ );
+}
+
+#endif
+
+Terminal::EVENT_TYPE Terminal::wait_for_input( int long timeout_ ) {
 #ifdef _WIN32
 	std::array<HANDLE,2> handles = { _consoleIn, _interrupt };
 	while ( true ) {
-		DWORD event( WaitForMultipleObjects( handles.size (), handles.data(), false, INFINITE ) );
+		DWORD event( WaitForMultipleObjects( handles.size (), handles.data(), false, timeout_ >= 0 ? static_cast<DWORD>( timeout_ ) : INFINITE ) );
 		switch ( event ) {
+			case ( WAIT_TIMEOUT ): {
+				return ( EVENT_TYPE::TIMEOUT );
+			}
 			case ( WAIT_OBJECT_0 + 0 ): {
 				// peek events that will be skipped
 				INPUT_RECORD rec;
@@ -535,27 +879,49 @@ Terminal::EVENT_TYPE Terminal::wait_for_input( void ) {
 		}
 	}
 #else
+	if ( has_buffered_input() ) {
+		return ( EVENT_TYPE::KEY_PRESS );
+	}
 	fd_set fdSet;
-	int nfds( max( _interrupt[0], _interrupt[1] ) + 1 );
+	int inputFd( _backend->input_fd() );
+	int nfds( max( max( _interrupt[0], _interrupt[1] ), inputFd ) + 1 );
+	// backends without a descriptor are asked with input_ready(),
+	// they wake us up through _interrupt with notify_input()
+	bool noDescriptor( inputFd < 0 );
 	while ( true ) {
+		bool ready( noDescriptor && _backend->input_ready() );
 		FD_ZERO( &fdSet );
-		FD_SET( 0, &fdSet );
+		if ( inputFd >= 0 ) {
+			FD_SET( inputFd, &fdSet );
+		}
 		FD_SET( _interrupt[0], &fdSet );
-		int err( select( nfds, &fdSet, nullptr, nullptr, nullptr ) );
+		int long wait( ready ? 0 : timeout_ );
+		timeval tv{ wait / 1000, static_cast<suseconds_t>( ( wait % 1000 ) * 1000 ) };
+		int err( select( nfds, &fdSet, nullptr, nullptr, wait >= 0 ? &tv : nullptr ) );
 		if ( ( err == -1 ) && ( errno == EINTR ) ) {
 			continue;
 		}
-		if ( FD_ISSET( _interrupt[0], &fdSet ) ) {
+		if ( ( err == 0 ) && ! ready ) {
+			return ( EVENT_TYPE::TIMEOUT );
+		}
+		if ( ( err > 0 ) && FD_ISSET( _interrupt[0], &fdSet ) ) {
 			char data( 0 );
 			static_cast<void>( read( _interrupt[0], &data, 1 ) == 1 );
+			if ( data == 'i' ) {
+				_inputNotified = false;
+				continue;
+			}
 			if ( data == 'k' ) {
 				return ( EVENT_TYPE::KEY_PRESS );
 			}
 			if ( data == 'm' ) {
 				return ( EVENT_TYPE::MESSAGE );
 			}
+			if ( data == 'r' ) {
+				return ( EVENT_TYPE::RESIZE );
+			}
 		}
-		if ( FD_ISSET( 0, &fdSet ) ) {
+		if ( ready || ( ( err > 0 ) && ( inputFd >= 0 ) && FD_ISSET( inputFd, &fdSet ) ) ) {
 			return ( EVENT_TYPE::KEY_PRESS );
 		}
 	}
@@ -567,11 +933,24 @@ void Terminal::notify_event( EVENT_TYPE eventType_ ) {
 	_events.push_back( eventType_ );
 	SetEvent( _interrupt );
 #else
-	char data( eventType_ == EVENT_TYPE::KEY_PRESS ? 'k' : 'm' );
+	char data( eventType_ == EVENT_TYPE::KEY_PRESS ? 'k' : ( eventType_ == EVENT_TYPE::RESIZE ? 'r' : 'm' ) );
 	static_cast<void>( write( _interrupt[1], &data, 1 ) == 1 );
 #endif
 }
 
+#ifndef _WIN32
+
+// Called by backends without a descriptor, possibly from other threads,
+// one pending notification is enough to wake up wait_for_input().
+void Terminal::notify_input( void ) {
+	if ( ! _inputNotified.exchange( true ) ) {
+		char data( 'i' );
+		static_cast<void>( write( _interrupt[1], &data, 1 ) == 1 );
+	}
+}
+
+#endif
+
 /**
  * Clear the screen ONLY (no redisplay of anything)
  */
@@ -594,12 +973,13 @@ void Terminal::clear_screen( CLEAR_SCREEN clearScreen_ ) {
 	);
 	FillConsoleOutputCharacterA( _consoleOut, ' ', toWrite, coord, &nWritten );
 #else
+	LatencyTimer timer( _latency, Replxx::LATENCY_PHASE::WRITE );
 	if ( clearScreen_ == CLEAR_SCREEN::WHOLE ) {
 		char const clearCode[] = "\033c\033[H\033[2J\033[0m";
-		static_cast<void>( write(1, clearCode, sizeof ( clearCode ) - 1) >= 0 );
+		static_cast<void>( _backend->write( clearCode, sizeof ( clearCode ) - 1 ) >= 0 );
 	} else {
 		char const clearCode[] = "\033[J";
-		static_cast<void>( write(1, clearCode, sizeof ( clearCode ) - 1) >= 0 );
+		static_cast<void>( _backend->write( clearCode, sizeof ( clearCode ) - 1 ) >= 0 );
 	}
 #endif
 }
@@ -2,6 +2,8 @@
 #define REPLXX_IO_HXX_INCLUDED 1
 
 #include <deque>
+#include <atomic>
+#include <chrono>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -9,14 +11,57 @@
 #include <termios.h>
 #endif
 
+#include "replxx.hxx"
+#include "conversion.hxx"
+#include "escape.hxx"
+#include "session.hxx"
+
 namespace replxx {
 
+class Latency;
+
+#ifndef _WIN32
+
+/* Default terminal backend, standard input and output unless other descriptors are given. */
+class TtyBackend : public Replxx::TerminalBackend {
+	int _in;
+	int _out;
+	bool _standard; /* standard input and output, not descriptors given with set_fds() */
+	bool _inTty;    /* _in is a terminal, otherwise e.g. socket of remote session or redirected stdin */
+	bool _outTty;
+	struct termios _origTermios; /* in order to restore at exit */
+public:
+	TtyBackend( void );
+	void set_fds( int, int );
+	bool in_tty( void ) const {
+		return ( _inTty );
+	}
+	bool out_tty( void ) const {
+		return ( _outTty );
+	}
+	int resize_generation( void ) const;
+	int read( char*, int ) override;
+	int write( char const*, int ) override;
+	bool input_ready( void ) override;
+	int input_fd( void ) override;
+	int screen_columns( void ) override;
+	int screen_rows( void ) override;
+	int enable_raw_mode( void ) override;
+	void disable_raw_mode( void ) override;
+};
+
+#endif
+
 class Terminal {
 public:
 	enum class EVENT_TYPE {
 		KEY_PRESS,
-		MESSAGE
+		MESSAGE,
+		RESIZE,
+		TIMEOUT
 	};
+	/* Returned by non-blocking read_char() when key sequence is not complete yet. */
+	static char32_t const INPUT_PENDING = static_cast<char32_t>( -3 );
 private:
 #ifdef _WIN32
 	HANDLE _consoleOut;
@@ -29,10 +74,28 @@ private:
 	typedef std::deque<EVENT_TYPE> events_t;
 	events_t _events;
 #else
-	struct termios _origTermios; /* in order to restore at exit */
+	static int const INPUT_BUFFER_SIZE = 1024; /* must be a power of 2 */
+	TtyBackend _tty;
+	TtyBackend _fdTty;         /* terminal on descriptors given with set_fds() */
+	Replxx::TerminalBackend* _backend; /* _tty unless custom backend is set */
 	int _interrupt[2];
+	std::atomic<bool> _inputNotified; /* backend without descriptor has signaled _interrupt since last wait */
+	uchar8_t _inputBuffer[INPUT_BUFFER_SIZE]; /* ring buffer of raw bytes read from the terminal */
+	unsigned _inputHead;       /* next byte to decode */
+	unsigned _inputTail;       /* one past last byte read */
+	int _utf8Pending;          /* continuation bytes still expected in current UTF-8 sequence */
+	char32_t _utf8CodePoint;   /* code point accumulated so far */
+	uchar8_t _utf8Lower;       /* valid range for next continuation byte */
+	uchar8_t _utf8Upper;
+	EscapeSequenceDecoder _escapeDecoder;
+	int _escapeTimeout;        /* milliseconds non-blocking reads wait for the rest of escape sequence, 0 - indefinitely */
+	std::chrono::steady_clock::time_point _escapeDeadline; /* set while non-blocking reads wait for the rest of escape sequence */
+	SessionRecorder _recorder;
+	bool _resized;             /* custom backend reported screen size change */
+	int _recordedGeneration;   /* resize generation of screen size last recorded */
 #endif
 	bool _rawMode; /* for destructor to check if restore is needed */
+	Latency* _latency; /* writes are measured if set */
 public:
 	enum class CLEAR_SCREEN {
 		WHOLE,
@@ -47,25 +110,70 @@ public:
 	int get_screen_rows(void);
 	int enable_raw_mode(void);
 	void disable_raw_mode(void);
-	char32_t read_char(void);
+	char32_t read_char( bool wait_ = true );
 	void clear_screen( CLEAR_SCREEN );
-	EVENT_TYPE wait_for_input( void );
+	EVENT_TYPE wait_for_input( int long timeout_ = -1 );
 	void notify_event( EVENT_TYPE );
+#ifndef _WIN32
+	void notify_input( void );
+#endif
 	void jump_cursor( int, int );
+	void beep( void );
+	void set_escape_timeout( int );
+	int long escape_time_left( void ) const;
+	bool has_custom_backend( void ) const;
+	bool in_tty( void ) const;
+	bool out_tty( void ) const;
+	void set_latency( Latency* latency_ ) {
+		_latency = latency_;
+	}
+#ifndef _WIN32
+	void set_backend( Replxx::TerminalBackend* );
+	void set_fds( int, int );
+	int start_recording( std::string const& );
+	void stop_recording( void );
+	void record_resize( void );
+	int resize_generation( void ) const;
+	bool take_resize( void ) {
+		bool resized( _resized );
+		_resized = false;
+		return ( resized );
+	}
+	int input_fd( void ) const {
+		return ( _backend->input_fd() );
+	}
+	char32_t read_unicode_character( bool wait_ = true );
+	int event_fd( void ) const {
+		return ( _interrupt[0] );
+	}
+	bool has_buffered_input( void ) const {
+		return ( _inputHead != _inputTail );
+	}
+	/* Backends without a descriptor are always ready at end of input, only their buffered input counts. */
+	bool typeahead( void ) const {
+		return ( has_buffered_input() || ( ( _backend->input_fd() >= 0 ) && input_ready() ) );
+	}
+#endif
 private:
+#ifndef _WIN32
+	bool input_ready( void ) const;
+	int fill_input_buffer( void );
+	bool decode_utf8( uchar8_t, char32_t& );
+	char32_t translate_key( char32_t );
+#endif
 	Terminal( Terminal const& ) = delete;
 	Terminal& operator = ( Terminal const& ) = delete;
 	Terminal( Terminal&& ) = delete;
 	Terminal& operator = ( Terminal&& ) = delete;
 };
 
-void beep();
-char32_t read_unicode_character(void);
-
 namespace tty {
 
 extern bool in;
 extern bool out;
+#ifndef _WIN32
+extern std::atomic<int> resizeGeneration; /* bumped on every SIGWINCH */
+#endif
 
 }
 
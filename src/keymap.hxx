@@ -0,0 +1,131 @@
+#ifndef REPLXX_KEYMAP_HXX_INCLUDED
+#define REPLXX_KEYMAP_HXX_INCLUDED 1
+
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include "replxx.hxx"
+
+namespace replxx {
+
+// Maps key press codes onto small integer handler identifiers.
+//
+// Plain and modified (Shift/Control/Meta) ASCII codes and special keys
+// (Replxx::KEY::BASE range) are looked up in directly indexed array,
+// all other codes (e.g. non-ASCII characters) live in a sorted array
+// and are found with binary search.
+class KeyMap {
+public:
+	static int const NONE = 0;
+private:
+	static int const MODIFIER_SHIFT = 24;
+	static int const MODIFIER_COMBINATIONS = 8;
+	static int const ASCII_SIZE = 128;
+	static int const SPECIAL_SIZE = 64;
+	static int const DIRECT_SIZE = MODIFIER_COMBINATIONS * ( ASCII_SIZE + SPECIAL_SIZE );
+	typedef std::pair<char32_t, int> sparse_entry_t;
+	typedef std::vector<sparse_entry_t> sparse_t;
+	uint16_t _direct[DIRECT_SIZE];
+	sparse_t _sparse;
+public:
+	KeyMap( void )
+		: _direct()
+		, _sparse() {
+	}
+	int find( char32_t code_ ) const {
+		int slot( direct_slot( code_ ) );
+		if ( slot >= 0 ) {
+			return ( _direct[slot] );
+		}
+		sparse_t::const_iterator it( std::lower_bound( _sparse.begin(), _sparse.end(), sparse_entry_t( code_, NONE ) ) );
+		return ( ( it != _sparse.end() ) && ( it->first == code_ ) ? it->second : NONE );
+	}
+	void set( char32_t code_, int id_ ) {
+		int slot( direct_slot( code_ ) );
+		if ( slot >= 0 ) {
+			_direct[slot] = static_cast<uint16_t>( id_ );
+			return;
+		}
+		sparse_t::iterator it( std::lower_bound( _sparse.begin(), _sparse.end(), sparse_entry_t( code_, NONE ) ) );
+		if ( ( it != _sparse.end() ) && ( it->first == code_ ) ) {
+			it->second = id_;
+		} else {
+			_sparse.insert( it, sparse_entry_t( code_, id_ ) );
+		}
+	}
+private:
+	static int direct_slot( char32_t code_ ) {
+		char32_t const modifiers( Replxx::KEY::BASE_SHIFT | Replxx::KEY::BASE_CONTROL | Replxx::KEY::BASE_META );
+		if ( code_ & ~( modifiers | 0x00ffffff ) ) {
+			return ( -1 );
+		}
+		int combination( static_cast<int>( code_ >> MODIFIER_SHIFT ) );
+		char32_t key( code_ & 0x00ffffff );
+		if ( key < ASCII_SIZE ) {
+			return ( combination * ASCII_SIZE + static_cast<int>( key ) );
+		}
+		if ( ( key >= Replxx::KEY::BASE ) && ( key < ( Replxx::KEY::BASE + SPECIAL_SIZE ) ) ) {
+			return ( MODIFIER_COMBINATIONS * ASCII_SIZE + combination * SPECIAL_SIZE + static_cast<int>( key - Replxx::KEY::BASE ) );
+		}
+		return ( -1 );
+	}
+};
+
+// Trie of multi-key sequences.
+//
+// Nodes are identified by small integers (0 means no node), edges of all
+// nodes live in a single hash map keyed by (node, key code) pair, so finding
+// next node costs the same regardless of number of bound sequences.
+class KeySequenceTrie {
+	struct Node {
+		int _handler;  // handler id bound to sequence ending in this node, 0 if none
+		int _children; // number of sequences continuing past this node
+	};
+	typedef std::vector<Node> nodes_t;
+	typedef std::unordered_map<uint64_t, int> edges_t;
+	nodes_t _nodes;
+	edges_t _edges;
+public:
+	KeySequenceTrie( void )
+		: _nodes( 1, Node{ 0, 0 } )
+		, _edges() {
+	}
+	int new_node( void ) {
+		_nodes.push_back( Node{ 0, 0 } );
+		return ( static_cast<int>( _nodes.size() ) - 1 );
+	}
+	int child( int node_, char32_t code_ ) const {
+		edges_t::const_iterator it( _edges.find( edge( node_, code_ ) ) );
+		return ( it != _edges.end() ? it->second : 0 );
+	}
+	int add_child( int node_, char32_t code_ ) {
+		int c( child( node_, code_ ) );
+		if ( c == 0 ) {
+			c = new_node();
+			_edges.insert( std::make_pair( edge( node_, code_ ), c ) );
+			++ _nodes[node_]._children;
+		}
+		return ( c );
+	}
+	bool has_children( int node_ ) const {
+		return ( _nodes[node_]._children > 0 );
+	}
+	int handler( int node_ ) const {
+		return ( _nodes[node_]._handler );
+	}
+	void set_handler( int node_, int handler_ ) {
+		_nodes[node_]._handler = handler_;
+	}
+private:
+	static uint64_t edge( int node_, char32_t code_ ) {
+		return ( ( static_cast<uint64_t>( node_ ) << 32 ) | code_ );
+	}
+};
+
+}
+
+#endif
+
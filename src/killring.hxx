@@ -1,72 +1,179 @@
 #ifndef REPLXX_KILLRING_HXX_INCLUDED
 #define REPLXX_KILLRING_HXX_INCLUDED 1
 
+#include <deque>
 #include <vector>
+#include <string>
+#include <algorithm>
 
-#include "unicodestring.hxx"
+#include "conversion.hxx"
 
 namespace replxx {
 
+// Ring of killed texts, most recent first.
+//
+// Ring is bounded both by number of entries and by total memory taken by
+// entries, oldest entries are dropped first, the most recent entry is
+// always kept. Consecutive kills extend the most recent entry in place.
 class KillRing {
-	static const int capacity = 10;
-	int size;
-	int index;
-	char indexToSlot[10];
-	std::vector<UnicodeString> theRing;
-
 public:
+	// Killed text with spare room on both ends, consecutive kills
+	// grow it in either direction in amortized O(killed length).
+	class Text {
+		std::vector<char32_t> _data;
+		int _begin;
+		int _end;
+	public:
+		Text( char32_t const* text_, int len_ )
+			: _data( text_, text_ + len_ )
+			, _begin( 0 )
+			, _end( len_ ) {
+		}
+		void append( char32_t const* text_, int len_ ) {
+			if ( ( _end + len_ ) > static_cast<int>( _data.size() ) ) {
+				grow( 0, len_ );
+			}
+			std::copy( text_, text_ + len_, _data.begin() + _end );
+			_end += len_;
+		}
+		void prepend( char32_t const* text_, int len_ ) {
+			if ( _begin < len_ ) {
+				grow( len_, 0 );
+			}
+			_begin -= len_;
+			std::copy( text_, text_ + len_, _data.begin() + _begin );
+		}
+		char32_t const* get( void ) const {
+			return ( _data.data() + _begin );
+		}
+		int length( void ) const {
+			return ( _end - _begin );
+		}
+		// Memory taken by the text including spare room.
+		int bytes( void ) const {
+			return ( static_cast<int>( _data.size() * sizeof ( char32_t ) ) );
+		}
+	private:
+		// Make room for front_/back_ more characters, room on the growing side is at least doubled.
+		void grow( int front_, int back_ ) {
+			int len( length() );
+			int front( front_ > 0 ? std::max( front_, len ) : _begin );
+			int back( back_ > 0 ? std::max( back_, len ) : static_cast<int>( _data.size() ) - _end );
+			std::vector<char32_t> data( front + len + back );
+			std::copy( _data.begin() + _begin, _data.begin() + _end, data.begin() + front );
+			_data.swap( data );
+			_begin = front;
+			_end = front + len;
+		}
+	};
 	enum action { actionOther, actionKill, actionYank };
 	action lastAction;
 	size_t lastYankSize;
-
-	KillRing() : size(0), index(0), lastAction(actionOther) {
-		theRing.reserve(capacity);
+private:
+	typedef std::deque<Text> ring_t;
+	ring_t _ring;
+	int _index;          // entry to be yanked
+	int _maxSize;        // in entries
+	int _maxBytes;       // memory limit for all entries
+	int _bytes;          // memory taken by all entries
+	bool _clipboard;     // copy killed text to system clipboard
+	bool _clipboardPending;
+	std::vector<char> _utf8;
+public:
+	KillRing( void )
+		: lastAction( actionOther )
+		, lastYankSize( 0 )
+		, _ring()
+		, _index( 0 )
+		, _maxSize( 10 )
+		, _maxBytes( 1024 * 1024 )
+		, _bytes( 0 )
+		, _clipboard( false )
+		, _clipboardPending( false )
+		, _utf8() {
 	}
 
-	void kill(const char32_t* text, int textLen, bool forward) {
-		if (textLen == 0) {
+	void kill( char32_t const* text_, int textLen_, bool forward_ ) {
+		if ( ( textLen_ == 0 ) || ( _maxSize == 0 ) ) {
 			return;
 		}
-		UnicodeString killedText(text, textLen);
-		if (lastAction == actionKill && size > 0) {
-			int slot = indexToSlot[0];
-			int currentLen = static_cast<int>(theRing[slot].length());
-			UnicodeString temp;
-			if ( forward ) {
-				temp.append( theRing[slot].get(), currentLen ).append( killedText.get(), textLen );
+		if ( ( lastAction == actionKill ) && ! _ring.empty() ) {
+			Text& t( _ring.front() );
+			_bytes -= t.bytes();
+			if ( forward_ ) {
+				t.append( text_, textLen_ );
 			} else {
-				temp.append( killedText.get(), textLen ).append( theRing[slot].get(), currentLen );
+				t.prepend( text_, textLen_ );
 			}
-			theRing[slot] = temp;
+			_bytes += t.bytes();
 		} else {
-			if (size < capacity) {
-				if (size > 0) {
-					memmove(&indexToSlot[1], &indexToSlot[0], size);
-				}
-				indexToSlot[0] = size;
-				size++;
-				theRing.push_back(killedText);
-			} else {
-				int slot = indexToSlot[capacity - 1];
-				theRing[slot] = killedText;
-				memmove(&indexToSlot[1], &indexToSlot[0], capacity - 1);
-				indexToSlot[0] = slot;
-			}
-			index = 0;
+			_ring.emplace_front( text_, textLen_ );
+			_bytes += _ring.front().bytes();
+			_index = 0;
 		}
+		trim();
+		_clipboardPending = _clipboard;
 	}
 
-	UnicodeString* yank() { return (size > 0) ? &theRing[indexToSlot[index]] : 0; }
+	Text const* yank( void ) const {
+		return ( ! _ring.empty() ? &_ring[_index] : nullptr );
+	}
+
+	Text const* yankPop( void ) {
+		if ( _ring.empty() ) {
+			return ( nullptr );
+		}
+		++ _index;
+		if ( _index == static_cast<int>( _ring.size() ) ) {
+			_index = 0;
+		}
+		return ( &_ring[_index] );
+	}
+
+	void set_max_size( int maxSize_ ) {
+		_maxSize = maxSize_ > 0 ? maxSize_ : 0;
+		trim();
+	}
+
+	void set_max_bytes( int maxBytes_ ) {
+		_maxBytes = maxBytes_ > 0 ? maxBytes_ : 0;
+		trim();
+	}
+
+	void set_clipboard( bool clipboard_ ) {
+		_clipboard = clipboard_;
+		_clipboardPending = false;
+	}
+
+	// UTF-8 encoded text of the most recent kill if it has not been copied to system clipboard yet.
+	bool take_clipboard( std::string& utf8_ ) {
+		if ( ! _clipboardPending || _ring.empty() ) {
+			return ( false );
+		}
+		_clipboardPending = false;
+		Text const& t( _ring.front() );
+		int size( t.length() * 4 + 1 );
+		if ( static_cast<int>( _utf8.size() ) < size ) {
+			_utf8.resize( static_cast<size_t>( size ) );
+		}
+		int count( 0 );
+		copyString32to8( _utf8.data(), size, t.get(), t.length(), &count );
+		utf8_.assign( _utf8.data(), static_cast<size_t>( count ) );
+		return ( true );
+	}
 
-	UnicodeString* yankPop() {
-		if (size == 0) {
-			return 0;
+private:
+	void trim( void ) {
+		while (
+			( static_cast<int>( _ring.size() ) > _maxSize )
+			|| ( ( _ring.size() > 1 ) && ( _bytes > _maxBytes ) )
+		) {
+			_bytes -= _ring.back().bytes();
+			_ring.pop_back();
 		}
-		++index;
-		if (index == size) {
-			index = 0;
+		if ( _index >= static_cast<int>( _ring.size() ) ) {
+			_index = 0;
 		}
-		return &theRing[indexToSlot[index]];
 	}
 };
 
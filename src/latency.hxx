@@ -0,0 +1,124 @@
+#ifndef REPLXX_LATENCY_HXX_INCLUDED
+#define REPLXX_LATENCY_HXX_INCLUDED 1
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+#include "replxx.hxx"
+
+namespace replxx {
+
+// Latency histograms of key press processing phases.
+//
+// Durations are counted in power of two buckets of nanoseconds.
+// Every counter is a relaxed atomic, so input thread records without
+// taking any lock while histograms are read from any other thread,
+// a snapshot taken during recording may be off by the last measurement.
+class Latency {
+public:
+	typedef std::chrono::steady_clock clock_t;
+	static int const PHASE_COUNT = static_cast<int>( Replxx::LATENCY_PHASE::WRITE ) + 1;
+	static int const BUCKET_COUNT = Replxx::LatencyHistogram::BUCKET_COUNT;
+private:
+	struct Histogram {
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;
+		std::atomic<uint64_t> max;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> buckets[BUCKET_COUNT];
+	};
+	Histogram _histograms[PHASE_COUNT];
+public:
+	Latency( void ) {
+		reset();
+	}
+	void record( Replxx::LATENCY_PHASE phase_, clock_t::time_point start_, int bytes_ = 0 ) {
+		uint64_t ns( static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( clock_t::now() - start_ ).count() ) );
+		Histogram& h( _histograms[static_cast<int>( phase_ )] );
+		h.count.fetch_add( 1, std::memory_order_relaxed );
+		h.total.fetch_add( ns, std::memory_order_relaxed );
+		h.bytes.fetch_add( static_cast<uint64_t>( bytes_ ), std::memory_order_relaxed );
+		h.buckets[bucket( ns )].fetch_add( 1, std::memory_order_relaxed );
+		uint64_t longest( h.max.load( std::memory_order_relaxed ) );
+		while ( ( ns > longest ) && ! h.max.compare_exchange_weak( longest, ns, std::memory_order_relaxed ) ) {
+		}
+	}
+	Replxx::LatencyHistogram snapshot( Replxx::LATENCY_PHASE phase_ ) const {
+		Histogram const& h( _histograms[static_cast<int>( phase_ )] );
+		Replxx::LatencyHistogram s;
+		s.count = static_cast<int long long>( h.count.load( std::memory_order_relaxed ) );
+		s.total = static_cast<int long long>( h.total.load( std::memory_order_relaxed ) );
+		s.max = static_cast<int long long>( h.max.load( std::memory_order_relaxed ) );
+		s.bytes = static_cast<int long long>( h.bytes.load( std::memory_order_relaxed ) );
+		for ( int i( 0 ); i < BUCKET_COUNT; ++ i ) {
+			s.buckets[i] = static_cast<int long long>( h.buckets[i].load( std::memory_order_relaxed ) );
+		}
+		return ( s );
+	}
+	void reset( void ) {
+		for ( Histogram& h : _histograms ) {
+			h.count.store( 0, std::memory_order_relaxed );
+			h.total.store( 0, std::memory_order_relaxed );
+			h.max.store( 0, std::memory_order_relaxed );
+			h.bytes.store( 0, std::memory_order_relaxed );
+			for ( std::atomic<uint64_t>& b : h.buckets ) {
+				b.store( 0, std::memory_order_relaxed );
+			}
+		}
+	}
+	std::string report( void ) const {
+		static char const* const names[PHASE_COUNT] = { "read_key", "dispatch", "highlighter", "hint", "refresh", "write" };
+		char line[128];
+		snprintf( line, sizeof ( line ), "%-12s %11s %10s %10s %10s %10s %10s\n", "phase", "count", "mean ns", "p50 ns", "p99 ns", "max ns", "bytes" );
+		std::string r( line );
+		for ( int i( 0 ); i < PHASE_COUNT; ++ i ) {
+			Replxx::LatencyHistogram s( snapshot( static_cast<Replxx::LATENCY_PHASE>( i ) ) );
+			snprintf(
+				line, sizeof ( line ), "%-12s %11lld %10lld %10lld %10lld %10lld %10lld\n",
+				names[i], s.count, s.count > 0 ? s.total / s.count : 0,
+				s.percentile( 50 ), s.percentile( 99 ), s.max, s.bytes
+			);
+			r.append( line );
+		}
+		return ( r );
+	}
+private:
+	static int bucket( uint64_t ns_ ) {
+		int b( 0 );
+		while ( ( ns_ >>= 1 ) != 0 ) {
+			++ b;
+		}
+		return ( b < BUCKET_COUNT ? b : BUCKET_COUNT - 1 );
+	}
+};
+
+// Records time from construction to destruction, does nothing without latency_.
+class LatencyTimer {
+	Latency* _latency;
+	Replxx::LATENCY_PHASE _phase;
+	int _bytes;
+	Latency::clock_t::time_point _start;
+public:
+	LatencyTimer( Latency* latency_, Replxx::LATENCY_PHASE phase_, int bytes_ = 0 )
+		: _latency( latency_ )
+		, _phase( phase_ )
+		, _bytes( bytes_ )
+		, _start( latency_ ? Latency::clock_t::now() : Latency::clock_t::time_point() ) {
+	}
+	~LatencyTimer( void ) {
+		if ( _latency ) {
+			_latency->record( _phase, _start, _bytes );
+		}
+	}
+private:
+	LatencyTimer( LatencyTimer const& ) = delete;
+	LatencyTimer& operator = ( LatencyTimer const& ) = delete;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,96 @@
+#ifndef REPLXX_MESSAGEQUEUE_HXX_INCLUDED
+#define REPLXX_MESSAGEQUEUE_HXX_INCLUDED 1
+
+#include <atomic>
+#include <string>
+#include <cstring>
+
+namespace replxx {
+
+// Multiple producers, single consumer queue of messages printed
+// from other threads.
+//
+// Producers push messages onto lock-free intrusive stack,
+// consumer takes all pending messages at once.
+// Single wake-up flag coalesces notifications - only the producer that
+// finds the flag clear has to wake the consumer up, so a burst of messages
+// results in a single wake-up.
+class MessageQueue {
+	struct Message {
+		Message* _next;
+		int _size;
+		char* data( void ) {
+			return ( reinterpret_cast<char*>( this + 1 ) );
+		}
+		static Message* create( char const* data_, int size_ ) {
+			Message* m( reinterpret_cast<Message*>( new char[sizeof ( Message ) + static_cast<size_t>( size_ )] ) );
+			m->_next = nullptr;
+			m->_size = size_;
+			memcpy( m->data(), data_, static_cast<size_t>( size_ ) );
+			return ( m );
+		}
+		static void destroy( Message* m_ ) {
+			delete [] reinterpret_cast<char*>( m_ );
+		}
+	};
+	std::atomic<Message*> _head;
+	std::atomic<bool> _wakeupPending;
+public:
+	MessageQueue( void )
+		: _head( nullptr )
+		, _wakeupPending( false ) {
+	}
+	~MessageQueue( void ) {
+		release( _head.exchange( nullptr ) );
+	}
+	// Returns true iff consumer has to be woken up.
+	bool push( char const* data_, int size_ ) {
+		Message* m( Message::create( data_, size_ ) );
+		Message* head( _head.load( std::memory_order_relaxed ) );
+		do {
+			m->_next = head;
+		} while ( ! _head.compare_exchange_weak( head, m, std::memory_order_release, std::memory_order_relaxed ) );
+		return ( ! _wakeupPending.exchange( true, std::memory_order_acq_rel ) );
+	}
+	bool empty( void ) const {
+		return ( _head.load( std::memory_order_acquire ) == nullptr );
+	}
+	// Append all pending messages to out_ in the order they were pushed.
+	// Returns number of messages taken.
+	int take_all( std::string& out_ ) {
+		_wakeupPending.store( false, std::memory_order_release );
+		Message* m( _head.exchange( nullptr, std::memory_order_acquire ) );
+		Message* reversed( nullptr );
+		int size( 0 );
+		int count( 0 );
+		while ( m ) {
+			Message* next( m->_next );
+			m->_next = reversed;
+			reversed = m;
+			size += m->_size;
+			++ count;
+			m = next;
+		}
+		out_.reserve( out_.length() + static_cast<size_t>( size ) );
+		for ( m = reversed; m; m = m->_next ) {
+			out_.append( m->data(), static_cast<size_t>( m->_size ) );
+		}
+		release( reversed );
+		return ( count );
+	}
+private:
+	static void release( Message* m_ ) {
+		while ( m_ ) {
+			Message* next( m_->_next );
+			Message::destroy( m_ );
+			m_ = next;
+		}
+	}
+	MessageQueue( MessageQueue const& ) = delete;
+	MessageQueue& operator = ( MessageQueue const& ) = delete;
+};
+
+}
+
+#endif
+
@@ -49,7 +49,7 @@ void Prompt::set_text( UnicodeString const& text_ ) {
 	int len = 0;
 	int x = 0;
 
-	bool const strip = !tty::out;
+	bool const strip = !_terminal.out_tty();
 
 	while (in != text_.end()) {
 		char32_t c = *in;
@@ -113,7 +113,6 @@ void Prompt::set_text( UnicodeString const& text_ ) {
 const UnicodeString forwardSearchBasePrompt("(i-search)`");
 const UnicodeString reverseSearchBasePrompt("(reverse-i-search)`");
 const UnicodeString endSearchBasePrompt("': ");
-UnicodeString previousSearchText;	// remembered across invocations of replxx_input()
 
 DynamicPrompt::DynamicPrompt( Terminal& terminal_, int initialDirection )
 	: Prompt( terminal_ )
@@ -84,6 +84,7 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <cstdarg>
 
 #ifdef _WIN32
@@ -132,10 +133,101 @@ void Replxx::set_hint_callback( hint_callback_t const& fn ) {
 	_impl->set_hint_callback( fn );
 }
 
+void Replxx::set_completion_view_callback( completion_view_callback_t const& fn ) {
+	_impl->set_completion_view_callback( fn );
+}
+
+void Replxx::set_completion_index( CompletionIndex const* index ) {
+	_impl->set_completion_index( index );
+}
+
+void Replxx::set_async_completion_callback( async_completion_callback_t const& fn ) {
+	_impl->set_async_completion_callback( fn );
+}
+
+void Replxx::set_highlighter_view_callback( highlighter_view_callback_t const& fn ) {
+	_impl->set_highlighter_view_callback( fn );
+}
+
+void Replxx::set_hint_view_callback( hint_view_callback_t const& fn ) {
+	_impl->set_hint_view_callback( fn );
+}
+
+Replxx::Candidates::Candidates( void )
+	: _text()
+	, _offsets() {
+}
+
+void Replxx::Candidates::add( char const* text_, int size_ ) {
+	_offsets.push_back( static_cast<int>( _text.length() ) );
+	_text.append( text_, static_cast<size_t>( size_ ) );
+	// keep every candidate NUL terminated
+	_text.push_back( 0 );
+}
+
+void Replxx::Candidates::add( char const* text_ ) {
+	add( text_, static_cast<int>( strlen( text_ ) ) );
+}
+
+void Replxx::Candidates::add( std::string const& text_ ) {
+	add( text_.data(), static_cast<int>( text_.length() ) );
+}
+
+int Replxx::Candidates::size( void ) const {
+	return ( static_cast<int>( _offsets.size() ) );
+}
+
+Replxx::StringView Replxx::Candidates::get( int index_ ) const {
+	int start( _offsets[index_] );
+	int end( index_ + 1 < size() ? _offsets[index_ + 1] : static_cast<int>( _text.length() ) );
+	return ( StringView( _text.data() + start, end - start - 1 ) );
+}
+
+void Replxx::Candidates::clear( void ) {
+	_text.clear();
+	_offsets.clear();
+}
+
 char const* Replxx::input( std::string const& prompt ) {
 	return ( _impl->input( prompt ) );
 }
 
+bool Replxx::start_input( std::string const& prompt ) {
+	return ( _impl->start_input( prompt ) );
+}
+
+Replxx::INPUT_STATUS Replxx::process_input( char const*& line_ ) {
+	return ( _impl->process_input( line_ ) );
+}
+
+int Replxx::set_terminal( TerminalBackend* terminal_ ) {
+	return ( _impl->set_terminal( terminal_ ) );
+}
+
+int Replxx::set_terminal_fds( int in_, int out_ ) {
+	return ( _impl->set_terminal_fds( in_, out_ ) );
+}
+
+void Replxx::window_changed( void ) {
+	_impl->window_changed();
+}
+
+int Replxx::set_session_recording( std::string const& filename_ ) {
+	return ( _impl->set_session_recording( filename_ ) );
+}
+
+int Replxx::input_fd( void ) const {
+	return ( _impl->input_fd() );
+}
+
+int Replxx::event_fd( void ) const {
+	return ( _impl->event_fd() );
+}
+
+int Replxx::next_timeout( void ) const {
+	return ( _impl->next_timeout() );
+}
+
 void Replxx::history_add( std::string const& line ) {
 	_impl->history_add( line );
 }
@@ -172,6 +264,22 @@ void Replxx::set_completion_count_cutoff( int count ) {
 	_impl->set_completion_count_cutoff( count );
 }
 
+void Replxx::set_completion_cache_ttl( int milliseconds ) {
+	_impl->set_completion_cache_ttl( milliseconds );
+}
+
+void Replxx::set_completion_menu( int rows ) {
+	_impl->set_completion_menu( rows );
+}
+
+void Replxx::set_fuzzy_completion( int maxResults ) {
+	_impl->set_fuzzy_completion( maxResults );
+}
+
+void Replxx::invalidate_completion_cache( void ) {
+	_impl->invalidate_completion_cache();
+}
+
 void Replxx::set_double_tab_completion( bool val ) {
 	_impl->set_double_tab_completion( val );
 }
@@ -188,10 +296,85 @@ void Replxx::set_no_color( bool val ) {
 	_impl->set_no_color( val );
 }
 
+void Replxx::set_max_redraw_rate( int rate ) {
+	_impl->set_max_redraw_rate( rate );
+}
+
+void Replxx::set_callback_budget( BUDGETED_CALLBACK callback_, int microseconds_ ) {
+	_impl->set_callback_budget( callback_, microseconds_ );
+}
+
+void Replxx::set_callback_idle_period( int milliseconds_ ) {
+	_impl->set_callback_idle_period( milliseconds_ );
+}
+
+void Replxx::set_callback_budget_handler( callback_budget_handler_t const& handler_ ) {
+	_impl->set_callback_budget_handler( handler_ );
+}
+
+Replxx::CALLBACK_DEGRADATION Replxx::callback_degradation( BUDGETED_CALLBACK callback_ ) const {
+	return ( _impl->callback_degradation( callback_ ) );
+}
+
 void Replxx::set_max_history_size( int len ) {
 	_impl->set_max_history_size( len );
 }
 
+void Replxx::set_max_undo_size( int bytes ) {
+	_impl->set_max_undo_size( bytes );
+}
+
+void Replxx::set_max_kill_ring_size( int count ) {
+	_impl->set_max_kill_ring_size( count );
+}
+
+void Replxx::set_max_kill_ring_bytes( int bytes ) {
+	_impl->set_max_kill_ring_bytes( bytes );
+}
+
+void Replxx::set_kill_ring_clipboard( bool val ) {
+	_impl->set_kill_ring_clipboard( val );
+}
+
+void Replxx::set_latency_instrumentation( bool val ) {
+	_impl->set_latency_instrumentation( val );
+}
+
+Replxx::LatencyHistogram Replxx::latency_histogram( LATENCY_PHASE phase ) const {
+	return ( _impl->latency_histogram( phase ) );
+}
+
+void Replxx::reset_latency_histograms( void ) {
+	_impl->reset_latency_histograms();
+}
+
+std::string Replxx::latency_report( void ) const {
+	return ( _impl->latency_report() );
+}
+
+void Replxx::set_latency_report_file( std::string const& filename ) {
+	_impl->set_latency_report_file( filename );
+}
+
+int long long Replxx::LatencyHistogram::percentile( double p ) const {
+	if ( count <= 0 ) {
+		return ( 0 );
+	}
+	int long long rank( static_cast<int long long>( p * static_cast<double>( count ) / 100.0 + 0.5 ) );
+	if ( rank < 1 ) {
+		rank = 1;
+	}
+	int long long seen( 0 );
+	for ( int i( 0 ); i < BUCKET_COUNT; ++ i ) {
+		seen += buckets[i];
+		if ( seen >= rank ) {
+			int long long upper( ( 1LL << ( i + 1 ) ) - 1 );
+			return ( upper < max ? upper : max );
+		}
+	}
+	return ( max );
+}
+
 void Replxx::clear_screen( void ) {
 	_impl->clear_screen( 0 );
 }
@@ -208,6 +391,14 @@ void Replxx::bind_key( char32_t keyPress_, key_press_handler_t handler_ ) {
 	_impl->bind_key( keyPress_, handler_ );
 }
 
+void Replxx::bind_key_sequence( key_sequence_t const& keys_, key_press_handler_t handler_ ) {
+	_impl->bind_key_sequence( keys_, handler_ );
+}
+
+void Replxx::set_key_sequence_timeout( int milliseconds_ ) {
+	_impl->set_key_sequence_timeout( milliseconds_ );
+}
+
 int Replxx::install_window_change_handler( void ) {
 	return ( _impl->install_window_change_handler() );
 }
@@ -259,6 +450,17 @@ void replxx_bind_key( ::Replxx* replxx_, int code_, key_press_handler_t handler_
 	replxx->bind_key( code_, std::bind( key_press_handler_forwarder, handler_, _1, userData_ ) );
 }
 
+void replxx_bind_key_sequence( ::Replxx* replxx_, int const* codes_, int count_, key_press_handler_t handler_, void* userData_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx::Replxx::key_sequence_t keys( codes_, codes_ + ( count_ > 0 ? count_ : 0 ) );
+	replxx->bind_key_sequence( keys, std::bind( key_press_handler_forwarder, handler_, _1, userData_ ) );
+}
+
+void replxx_set_key_sequence_timeout( ::Replxx* replxx_, int milliseconds_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_key_sequence_timeout( milliseconds_ );
+}
+
 /**
  * replxx_set_preload_buffer provides text to be inserted into the command buffer
  *
@@ -287,6 +489,84 @@ char const* replxx_input( ::Replxx* replxx_, const char* prompt ) {
 	return ( replxx->input( prompt ) );
 }
 
+int replxx_start_input( ::Replxx* replxx_, const char* prompt ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->start_input( prompt ) ? 0 : -1 );
+}
+
+ReplxxInputStatus replxx_process_input( ::Replxx* replxx_, char const** line_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	char const* line( nullptr );
+	ReplxxInputStatus status( static_cast<ReplxxInputStatus>( replxx->process_input( line ) ) );
+	if ( line_ ) {
+		*line_ = line;
+	}
+	return ( status );
+}
+
+::ReplxxVirtualTerminal* replxx_virtual_terminal_init( int columns, int rows ) {
+	return ( reinterpret_cast<::ReplxxVirtualTerminal*>( new replxx::Replxx::VirtualTerminal( columns, rows ) ) );
+}
+
+void replxx_virtual_terminal_end( ::ReplxxVirtualTerminal* terminal_ ) {
+	delete reinterpret_cast<replxx::Replxx::VirtualTerminal*>( terminal_ );
+}
+
+void replxx_virtual_terminal_feed( ::ReplxxVirtualTerminal* terminal_, const char* data ) {
+	reinterpret_cast<replxx::Replxx::VirtualTerminal*>( terminal_ )->feed( data, static_cast<int>( strlen( data ) ) );
+}
+
+int replxx_virtual_terminal_line( ::ReplxxVirtualTerminal* terminal_, int y, char* buffer, int size ) {
+	std::string line( reinterpret_cast<replxx::Replxx::VirtualTerminal*>( terminal_ )->line( y ) );
+	if ( size > 0 ) {
+		int count( std::min( static_cast<int>( line.length() ), size - 1 ) );
+		memcpy( buffer, line.data(), static_cast<size_t>( count ) );
+		buffer[count] = 0;
+	}
+	return ( static_cast<int>( line.length() ) );
+}
+
+void replxx_virtual_terminal_cursor( ::ReplxxVirtualTerminal* terminal_, int* x, int* y ) {
+	replxx::Replxx::VirtualTerminal* terminal( reinterpret_cast<replxx::Replxx::VirtualTerminal*>( terminal_ ) );
+	*x = terminal->cursor_x();
+	*y = terminal->cursor_y();
+}
+
+int replxx_set_virtual_terminal( ::Replxx* replxx_, ::ReplxxVirtualTerminal* terminal_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->set_terminal( reinterpret_cast<replxx::Replxx::VirtualTerminal*>( terminal_ ) ) );
+}
+
+int replxx_set_terminal_fds( ::Replxx* replxx_, int in_, int out_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->set_terminal_fds( in_, out_ ) );
+}
+
+void replxx_window_changed( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->window_changed();
+}
+
+int replxx_set_session_recording( ::Replxx* replxx_, char const* filename_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->set_session_recording( filename_ ? filename_ : "" ) );
+}
+
+int replxx_input_fd( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->input_fd() );
+}
+
+int replxx_event_fd( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->event_fd() );
+}
+
+int replxx_next_timeout( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->next_timeout() );
+}
+
 int replxx_print( ::Replxx* replxx_, char const* format_, ... ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	::std::va_list ap;
@@ -306,26 +586,25 @@ int replxx_print( ::Replxx* replxx_, char const* format_, ... ) {
 }
 
 struct replxx_completions {
-	replxx::Replxx::completions_t data;
+	replxx::Replxx::Candidates& data;
 };
 
 struct replxx_hints {
-	replxx::Replxx::hints_t data;
+	replxx::Replxx::Candidates& data;
 };
 
-replxx::Replxx::completions_t completions_fwd( replxx_completion_callback_t fn, std::string const& input_, int& contextLen_, void* userData ) {
-	replxx_completions completions;
-	fn( input_.c_str(), &completions, &contextLen_, userData );
-	return ( completions.data );
+void completions_fwd( replxx_completion_callback_t fn, replxx::Replxx::StringView input_, int& contextLen_, replxx::Replxx::Candidates& completions_, void* userData ) {
+	replxx_completions completions{ completions_ };
+	fn( input_.data(), &completions, &contextLen_, userData );
 }
 
 /* Register a callback function to be called for tab-completion. */
 void replxx_set_completion_callback(::Replxx* replxx_, replxx_completion_callback_t* fn, void* userData) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_completion_callback( std::bind( &completions_fwd, fn, _1, _2, userData ) );
+	replxx->set_completion_view_callback( std::bind( &completions_fwd, fn, _1, _2, _3, userData ) );
 }
 
-void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input, replxx::Replxx::colors_t& colors, void* userData ) {
+void highlighter_fwd( replxx_highlighter_callback_t fn, replxx::Replxx::StringView input, replxx::Replxx::colors_t& colors, void* userData ) {
 	std::vector<ReplxxColor> colorsTmp( colors.size() );
 	std::transform(
 		colors.begin(),
@@ -335,7 +614,7 @@ void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input
 			return ( static_cast<ReplxxColor>( c ) );
 		}
 	);
-	fn( input.c_str(), colorsTmp.data(), colors.size(), userData );
+	fn( input.data(), colorsTmp.data(), colors.size(), userData );
 	std::transform(
 		colorsTmp.begin(),
 		colorsTmp.end(),
@@ -348,27 +627,94 @@ void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input
 
 void replxx_set_highlighter_callback( ::Replxx* replxx_, replxx_highlighter_callback_t* fn, void* userData ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_highlighter_callback( std::bind( &highlighter_fwd, fn, _1, _2, userData ) );
+	replxx->set_highlighter_view_callback( std::bind( &highlighter_fwd, fn, _1, _2, userData ) );
 }
 
-replxx::Replxx::hints_t hints_fwd( replxx_hint_callback_t fn, std::string const& input_, int& contextLen_, replxx::Replxx::Color& color_, void* userData ) {
-	replxx_hints hints;
+void hints_fwd( replxx_hint_callback_t fn, replxx::Replxx::StringView input_, int& contextLen_, replxx::Replxx::Color& color_, replxx::Replxx::Candidates& hints_, void* userData ) {
+	replxx_hints hints{ hints_ };
 	ReplxxColor c( static_cast<ReplxxColor>( color_ ) );
-	fn( input_.c_str(), &hints, &contextLen_, &c, userData );
-	return ( hints.data );
+	fn( input_.data(), &hints, &contextLen_, &c, userData );
 }
 
 void replxx_set_hint_callback( ::Replxx* replxx_, replxx_hint_callback_t* fn, void* userData ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_hint_callback( std::bind( &hints_fwd, fn, _1, _2, _3, userData ) );
+	replxx->set_hint_view_callback( std::bind( &hints_fwd, fn, _1, _2, _3, _4, userData ) );
 }
 
 void replxx_add_hint(replxx_hints* lh, const char* str) {
-	lh->data.emplace_back(str);
+	lh->data.add( str );
 }
 
 void replxx_add_completion(replxx_completions* lc, const char* str) {
-	lc->data.emplace_back(str);
+	lc->data.add( str );
+}
+
+::ReplxxCompletionIndex* replxx_completion_index_init( void ) {
+	return ( reinterpret_cast<::ReplxxCompletionIndex*>( new replxx::Replxx::CompletionIndex() ) );
+}
+
+void replxx_completion_index_end( ::ReplxxCompletionIndex* index_ ) {
+	delete reinterpret_cast<replxx::Replxx::CompletionIndex*>( index_ );
+}
+
+void replxx_completion_index_add( ::ReplxxCompletionIndex* index_, const char* word ) {
+	reinterpret_cast<replxx::Replxx::CompletionIndex*>( index_ )->add( word );
+}
+
+int replxx_completion_index_load( ::ReplxxCompletionIndex* index_, const char* filename ) {
+	return ( reinterpret_cast<replxx::Replxx::CompletionIndex*>( index_ )->load( filename ) );
+}
+
+int replxx_completion_index_complete( ::ReplxxCompletionIndex* index_, const char* prefix, replxx_completions* lc ) {
+	replxx::Replxx::StringView p( prefix, static_cast<int>( strlen( prefix ) ) );
+	return ( reinterpret_cast<replxx::Replxx::CompletionIndex*>( index_ )->complete( p, lc->data ) );
+}
+
+void replxx_set_completion_index( ::Replxx* replxx_, ::ReplxxCompletionIndex* index_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_completion_index( reinterpret_cast<replxx::Replxx::CompletionIndex const*>( index_ ) );
+}
+
+struct replxx_completion_request {
+	std::shared_ptr<replxx::Replxx::CompletionRequest> data;
+};
+
+void async_completions_fwd( replxx_async_completion_callback_t fn, std::shared_ptr<replxx::Replxx::CompletionRequest> const& request_, void* userData ) {
+	// released by completer with replxx_completion_request_release()
+	fn( new replxx_completion_request{ request_ }, userData );
+}
+
+void replxx_set_async_completion_callback( ::Replxx* replxx_, replxx_async_completion_callback_t* fn, void* userData ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_async_completion_callback( fn ? replxx::Replxx::async_completion_callback_t( std::bind( &async_completions_fwd, fn, _1, userData ) ) : nullptr );
+}
+
+char const* replxx_completion_request_input( replxx_completion_request* request_ ) {
+	return ( request_->data->input().c_str() );
+}
+
+int replxx_completion_request_context_length( replxx_completion_request* request_ ) {
+	return ( request_->data->context_length() );
+}
+
+void replxx_completion_request_set_context_length( replxx_completion_request* request_, int contextLen ) {
+	request_->data->set_context_length( contextLen );
+}
+
+int replxx_completion_request_add( replxx_completion_request* request_, const char* str ) {
+	return ( request_->data->add( str, static_cast<int>( strlen( str ) ) ) ? 1 : 0 );
+}
+
+void replxx_completion_request_finish( replxx_completion_request* request_ ) {
+	request_->data->finish();
+}
+
+int replxx_completion_request_is_cancelled( replxx_completion_request* request_ ) {
+	return ( request_->data->is_cancelled() ? 1 : 0 );
+}
+
+void replxx_completion_request_release( replxx_completion_request* request_ ) {
+	delete request_;
 }
 
 void replxx_history_add( ::Replxx* replxx_, const char* line ) {
@@ -381,6 +727,26 @@ void replxx_set_max_history_size( ::Replxx* replxx_, int len ) {
 	replxx->set_max_history_size( len );
 }
 
+void replxx_set_max_undo_size( ::Replxx* replxx_, int bytes ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_max_undo_size( bytes );
+}
+
+void replxx_set_max_kill_ring_size( ::Replxx* replxx_, int count ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_max_kill_ring_size( count );
+}
+
+void replxx_set_max_kill_ring_bytes( ::Replxx* replxx_, int bytes ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_max_kill_ring_bytes( bytes );
+}
+
+void replxx_set_kill_ring_clipboard( ::Replxx* replxx_, int val ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_kill_ring_clipboard( val ? true : false );
+}
+
 void replxx_set_max_hint_rows( ::Replxx* replxx_, int count ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	replxx->set_max_hint_rows( count );
@@ -391,6 +757,26 @@ void replxx_set_completion_count_cutoff( ::Replxx* replxx_, int count ) {
 	replxx->set_completion_count_cutoff( count );
 }
 
+void replxx_set_completion_cache_ttl( ::Replxx* replxx_, int milliseconds ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_completion_cache_ttl( milliseconds );
+}
+
+void replxx_set_completion_menu( ::Replxx* replxx_, int rows ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_completion_menu( rows );
+}
+
+void replxx_set_fuzzy_completion( ::Replxx* replxx_, int maxResults ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_fuzzy_completion( maxResults );
+}
+
+void replxx_invalidate_completion_cache( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->invalidate_completion_cache();
+}
+
 void replxx_set_word_break_characters( ::Replxx* replxx_, char const* breakChars_ ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	replxx->set_word_break_characters( breakChars_ );
@@ -411,6 +797,38 @@ void replxx_set_no_color( ::Replxx* replxx_, int val ) {
 	replxx->set_no_color( val ? true : false );
 }
 
+void replxx_set_callback_budget( ::Replxx* replxx_, ReplxxBudgetedCallback callback_, int microseconds_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_callback_budget( static_cast<replxx::Replxx::BUDGETED_CALLBACK>( callback_ ), microseconds_ );
+}
+
+void replxx_set_callback_idle_period( ::Replxx* replxx_, int milliseconds_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_callback_idle_period( milliseconds_ );
+}
+
+void callback_budget_fwd(
+	replxx_callback_budget_handler_t fn, replxx::Replxx::BUDGETED_CALLBACK callback_, replxx::Replxx::CALLBACK_DEGRADATION degradation_,
+	int long long duration_, int bufferLength_, void* userData
+) {
+	fn( static_cast<ReplxxBudgetedCallback>( callback_ ), static_cast<ReplxxCallbackDegradation>( degradation_ ), duration_, bufferLength_, userData );
+}
+
+void replxx_set_callback_budget_handler( ::Replxx* replxx_, replxx_callback_budget_handler_t* fn, void* userData ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_callback_budget_handler( fn ? replxx::Replxx::callback_budget_handler_t( std::bind( &callback_budget_fwd, fn, _1, _2, _3, _4, userData ) ) : nullptr );
+}
+
+ReplxxCallbackDegradation replxx_callback_degradation( ::Replxx* replxx_, ReplxxBudgetedCallback callback_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( static_cast<ReplxxCallbackDegradation>( replxx->callback_degradation( static_cast<replxx::Replxx::BUDGETED_CALLBACK>( callback_ ) ) ) );
+}
+
+void replxx_set_max_redraw_rate( ::Replxx* replxx_, int rate ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_max_redraw_rate( rate );
+}
+
 void replxx_set_beep_on_ambiguous_completion( ::Replxx* replxx_, int val ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	replxx->set_beep_on_ambiguous_completion( val ? true : false );
@@ -481,6 +899,44 @@ void replxx_debug_dump_print_codes(void) {
 }
 #endif // __REPLXX_DEBUG__
 
+void replxx_set_latency_instrumentation( ::Replxx* replxx_, int val ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_latency_instrumentation( val ? true : false );
+}
+
+void replxx_latency_histogram( ::Replxx* replxx_, ReplxxLatencyPhase phase, ReplxxLatencyHistogram* histogram ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx::Replxx::LatencyHistogram h( replxx->latency_histogram( static_cast<replxx::Replxx::LATENCY_PHASE>( phase ) ) );
+	histogram->count = h.count;
+	histogram->total = h.total;
+	histogram->max = h.max;
+	histogram->bytes = h.bytes;
+	for ( int i( 0 ); i < REPLXX_LATENCY_BUCKET_COUNT; ++ i ) {
+		histogram->buckets[i] = h.buckets[i];
+	}
+}
+
+void replxx_reset_latency_histograms( ::Replxx* replxx_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->reset_latency_histograms();
+}
+
+int replxx_latency_report( ::Replxx* replxx_, char* buffer, int size ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	std::string report( replxx->latency_report() );
+	if ( size > 0 ) {
+		int count( std::min( static_cast<int>( report.length() ), size - 1 ) );
+		memcpy( buffer, report.data(), static_cast<size_t>( count ) );
+		buffer[count] = 0;
+	}
+	return ( static_cast<int>( report.length() ) );
+}
+
+void replxx_set_latency_report_file( ::Replxx* replxx_, const char* filename ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_latency_report_file( filename ? filename : "" );
+}
+
 int replxx_install_window_change_handler( ::Replxx* replxx_ ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	return ( replxx->install_window_change_handler() );
@@ -2,6 +2,7 @@
 #include <memory>
 #include <cerrno>
 #include <iostream>
+#include <fstream>
 
 #ifdef _WIN32
 
@@ -34,14 +35,12 @@
 #include "replxx.hxx"
 
 using namespace std;
+using namespace std::placeholders;
 
 namespace replxx {
 
-#ifndef _WIN32
-
-bool gotResize = false;
-
-#endif
+int const KeyMap::NONE;
+int const FuzzyMatcher::BONUS_CONSECUTIVE;
 
 namespace {
 
@@ -54,9 +53,11 @@ char const defaultBreakChars[] = " \t\v\f\a\b\r\n`~!@#$%^&*()-=+[{]}\\|;:'\",<.>
 
 #ifndef _WIN32
 
+// Each instance on standard terminal compares SIGWINCH generation
+// with generation it has last redrawn for.
 static void WindowSizeChanged(int) {
-	// do nothing here but setting this flag
-	gotResize = true;
+	// do nothing here but bumping the generation
+	++ tty::resizeGeneration;
 }
 
 #endif
@@ -84,92 +85,138 @@ Replxx::ReplxxImpl::ReplxxImpl( FILE*, FILE*, FILE* )
 	, _charWidths()
 	, _display()
 	, _displayInputLength( 0 )
+	, _listing()
+	, _listingWidths()
 	, _hint()
+	, _hints()
+	, _completions()
 	, _pos( 0 )
 	, _prefix( 0 )
 	, _hintSelection( -1 )
 	, _history()
 	, _killRing()
+	, _undo()
 	, _maxHintRows( REPLXX_MAX_HINT_ROWS )
 	, _breakChars( defaultBreakChars )
 	, _completionCountCutoff( 100 )
 	, _doubleTabCompletion( false )
 	, _completeOnEmpty( true )
 	, _beepOnAmbiguousCompletion( false )
+	, _completionCache()
+	, _completionCacheTtl( 0 )
+	, _completionMenu()
+	, _completionMenuRows( 0 )
+	, _fuzzyMatcher()
+	, _fuzzyCompletion( 0 )
+	, _latency()
+	, _latencyInstrumentation( false )
+	, _latencyReportFile()
+	, _highlighterBudget()
+	, _hintBudget()
+	, _callbackBudgetHandler()
+	, _callbackIdlePeriod( 100 )
+	, _callbacksDeferred( false )
+	, _idleRefresh( false )
+	, _callbacksDeferredAt()
 	, _noColor( false )
+	, _keyMap()
 	, _keyPressHandlers()
+	, _keySequences()
+	, _keySequence()
+	, _keySequenceNode( 0 )
+	, _keySequenceTimeout( 1000 )
+	, _keySequenceDeadline()
 	, _terminal()
+	, _resizeGeneration( 0 )
+	, _windowChanged( false )
+	, _previousSearchText()
 	, _currentThread()
 	, _prompt( _terminal )
 	, _completionCallback( nullptr )
+	, _completionIndex( nullptr )
+	, _asyncCompletionCallback( nullptr )
+	, _completionRequest( nullptr )
 	, _highlighterCallback( nullptr )
 	, _hintCallback( nullptr )
 	, _keyPresses()
 	, _messages()
+	, _messageBuffer()
+	, _clipboardBuffer()
+	, _minRedrawInterval( 0 )
+	, _lastMessagesRedraw()
 	, _preloadedBuffer()
 	, _errorMessage()
 	, _mutex() {
-	using namespace std::placeholders;
-	bind_key( Replxx::KEY::control( 'A' ),                 std::bind( &ReplxxImpl::go_to_begining_of_line,     this, _1 ) );
-	bind_key( Replxx::KEY::HOME + 0,                       std::bind( &ReplxxImpl::go_to_begining_of_line,     this, _1 ) );
-	bind_key( Replxx::KEY::control( 'E' ),                 std::bind( &ReplxxImpl::go_to_end_of_line,          this, _1 ) );
-	bind_key( Replxx::KEY::END + 0,                        std::bind( &ReplxxImpl::go_to_end_of_line,          this, _1 ) );
-	bind_key( Replxx::KEY::control( 'B' ),                 std::bind( &ReplxxImpl::move_one_char_left,         this, _1 ) );
-	bind_key( Replxx::KEY::LEFT + 0,                       std::bind( &ReplxxImpl::move_one_char_left,         this, _1 ) );
-	bind_key( Replxx::KEY::control( 'F' ),                 std::bind( &ReplxxImpl::move_one_char_right,        this, _1 ) );
-	bind_key( Replxx::KEY::RIGHT + 0,                      std::bind( &ReplxxImpl::move_one_char_right,        this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'b' ),                    std::bind( &ReplxxImpl::move_one_word_left,         this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'B' ),                    std::bind( &ReplxxImpl::move_one_word_left,         this, _1 ) );
-	bind_key( Replxx::KEY::control( Replxx::KEY::LEFT ),   std::bind( &ReplxxImpl::move_one_word_left,         this, _1 ) );
-	bind_key( Replxx::KEY::meta( Replxx::KEY::LEFT ),      std::bind( &ReplxxImpl::move_one_word_left,         this, _1 ) ); // Emacs allows Meta, readline don't
-	bind_key( Replxx::KEY::meta( 'f' ),                    std::bind( &ReplxxImpl::move_one_word_right,        this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'F' ),                    std::bind( &ReplxxImpl::move_one_word_right,        this, _1 ) );
-	bind_key( Replxx::KEY::control( Replxx::KEY::RIGHT ),  std::bind( &ReplxxImpl::move_one_word_right,        this, _1 ) );
-	bind_key( Replxx::KEY::meta( Replxx::KEY::RIGHT ),     std::bind( &ReplxxImpl::move_one_word_right,        this, _1 ) ); // Emacs allows Meta, readline don't
-	bind_key( Replxx::KEY::meta( Replxx::KEY::BACKSPACE ), std::bind( &ReplxxImpl::kill_word_to_left,          this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'd' ),                    std::bind( &ReplxxImpl::kill_word_to_right,         this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'D' ),                    std::bind( &ReplxxImpl::kill_word_to_right,         this, _1 ) );
-	bind_key( Replxx::KEY::control( 'W' ),                 std::bind( &ReplxxImpl::kill_to_whitespace_to_left, this, _1 ) );
-	bind_key( Replxx::KEY::control( 'U' ),                 std::bind( &ReplxxImpl::kill_to_begining_of_line,   this, _1 ) );
-	bind_key( Replxx::KEY::control( 'K' ),                 std::bind( &ReplxxImpl::kill_to_end_of_line,        this, _1 ) );
-	bind_key( Replxx::KEY::control( 'Y' ),                 std::bind( &ReplxxImpl::yank,                       this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'y' ),                    std::bind( &ReplxxImpl::yank_cycle,                 this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'Y' ),                    std::bind( &ReplxxImpl::yank_cycle,                 this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'c' ),                    std::bind( &ReplxxImpl::capitalize_word,            this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'C' ),                    std::bind( &ReplxxImpl::capitalize_word,            this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'l' ),                    std::bind( &ReplxxImpl::lowercase_word,             this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'L' ),                    std::bind( &ReplxxImpl::lowercase_word,             this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'u' ),                    std::bind( &ReplxxImpl::uppercase_word,             this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'U' ),                    std::bind( &ReplxxImpl::uppercase_word,             this, _1 ) );
-	bind_key( Replxx::KEY::control( 'T' ),                 std::bind( &ReplxxImpl::transpose_characters,       this, _1 ) );
-	bind_key( Replxx::KEY::control( 'C' ),                 std::bind( &ReplxxImpl::abort_line,                 this, _1 ) );
-	bind_key( Replxx::KEY::control( 'D' ),                 std::bind( &ReplxxImpl::send_eof,                   this, _1 ) );
-	bind_key( 127,                                         std::bind( &ReplxxImpl::delete_character,           this, _1 ) );
-	bind_key( Replxx::KEY::DELETE + 0,                     std::bind( &ReplxxImpl::delete_character,           this, _1 ) );
-	bind_key( Replxx::KEY::BACKSPACE + 0,                  std::bind( &ReplxxImpl::backspace_character,        this, _1 ) );
-	bind_key( Replxx::KEY::control( 'J' ),                 std::bind( &ReplxxImpl::commit_line,                this, _1 ) );
-	bind_key( Replxx::KEY::ENTER + 0,                      std::bind( &ReplxxImpl::commit_line,                this, _1 ) );
-	bind_key( Replxx::KEY::control( 'L' ),                 std::bind( &ReplxxImpl::clear_screen,               this, _1 ) );
-	bind_key( Replxx::KEY::control( 'N' ),                 std::bind( &ReplxxImpl::history_next,               this, _1 ) );
-	bind_key( Replxx::KEY::control( 'P' ),                 std::bind( &ReplxxImpl::history_previous,           this, _1 ) );
-	bind_key( Replxx::KEY::DOWN + 0,                       std::bind( &ReplxxImpl::history_next,               this, _1 ) );
-	bind_key( Replxx::KEY::UP + 0,                         std::bind( &ReplxxImpl::history_previous,           this, _1 ) );
-	bind_key( Replxx::KEY::meta( '>' ),                    std::bind( &ReplxxImpl::history_last,               this, _1 ) );
-	bind_key( Replxx::KEY::meta( '<' ),                    std::bind( &ReplxxImpl::history_first,              this, _1 ) );
-	bind_key( Replxx::KEY::PAGE_DOWN + 0,                  std::bind( &ReplxxImpl::history_last,               this, _1 ) );
-	bind_key( Replxx::KEY::PAGE_UP + 0,                    std::bind( &ReplxxImpl::history_first,              this, _1 ) );
-	bind_key( Replxx::KEY::control( Replxx::KEY::UP ),     std::bind( &ReplxxImpl::hint_previous,              this, _1 ) );
-	bind_key( Replxx::KEY::control( Replxx::KEY::DOWN ),   std::bind( &ReplxxImpl::hint_next,                  this, _1 ) );
+	bind_action( Replxx::KEY::control( 'A' ),                 &ReplxxImpl::go_to_begining_of_line );
+	bind_action( Replxx::KEY::HOME + 0,                       &ReplxxImpl::go_to_begining_of_line );
+	bind_action( Replxx::KEY::control( 'E' ),                 &ReplxxImpl::go_to_end_of_line );
+	bind_action( Replxx::KEY::END + 0,                        &ReplxxImpl::go_to_end_of_line );
+	bind_action( Replxx::KEY::control( 'B' ),                 &ReplxxImpl::move_one_char_left );
+	bind_action( Replxx::KEY::LEFT + 0,                       &ReplxxImpl::move_one_char_left );
+	bind_action( Replxx::KEY::control( 'F' ),                 &ReplxxImpl::move_one_char_right );
+	bind_action( Replxx::KEY::RIGHT + 0,                      &ReplxxImpl::move_one_char_right );
+	bind_action( Replxx::KEY::meta( 'b' ),                    &ReplxxImpl::move_one_word_left );
+	bind_action( Replxx::KEY::meta( 'B' ),                    &ReplxxImpl::move_one_word_left );
+	bind_action( Replxx::KEY::control( Replxx::KEY::LEFT ),   &ReplxxImpl::move_one_word_left );
+	bind_action( Replxx::KEY::meta( Replxx::KEY::LEFT ),      &ReplxxImpl::move_one_word_left ); // Emacs allows Meta, readline don't
+	bind_action( Replxx::KEY::meta( 'f' ),                    &ReplxxImpl::move_one_word_right );
+	bind_action( Replxx::KEY::meta( 'F' ),                    &ReplxxImpl::move_one_word_right );
+	bind_action( Replxx::KEY::control( Replxx::KEY::RIGHT ),  &ReplxxImpl::move_one_word_right );
+	bind_action( Replxx::KEY::meta( Replxx::KEY::RIGHT ),     &ReplxxImpl::move_one_word_right ); // Emacs allows Meta, readline don't
+	bind_action( Replxx::KEY::meta( Replxx::KEY::BACKSPACE ), &ReplxxImpl::kill_word_to_left );
+	bind_action( Replxx::KEY::meta( 'd' ),                    &ReplxxImpl::kill_word_to_right );
+	bind_action( Replxx::KEY::meta( 'D' ),                    &ReplxxImpl::kill_word_to_right );
+	bind_action( Replxx::KEY::control( 'W' ),                 &ReplxxImpl::kill_to_whitespace_to_left );
+	bind_action( Replxx::KEY::control( 'U' ),                 &ReplxxImpl::kill_to_begining_of_line );
+	bind_action( Replxx::KEY::control( 'K' ),                 &ReplxxImpl::kill_to_end_of_line );
+	bind_action( Replxx::KEY::control( 'Y' ),                 &ReplxxImpl::yank );
+	bind_action( Replxx::KEY::meta( 'y' ),                    &ReplxxImpl::yank_cycle );
+	bind_action( Replxx::KEY::meta( 'Y' ),                    &ReplxxImpl::yank_cycle );
+	bind_action( Replxx::KEY::meta( 'c' ),                    &ReplxxImpl::capitalize_word );
+	bind_action( Replxx::KEY::meta( 'C' ),                    &ReplxxImpl::capitalize_word );
+	bind_action( Replxx::KEY::meta( 'l' ),                    &ReplxxImpl::lowercase_word );
+	bind_action( Replxx::KEY::meta( 'L' ),                    &ReplxxImpl::lowercase_word );
+	bind_action( Replxx::KEY::meta( 'u' ),                    &ReplxxImpl::uppercase_word );
+	bind_action( Replxx::KEY::meta( 'U' ),                    &ReplxxImpl::uppercase_word );
+	bind_action( Replxx::KEY::control( 'T' ),                 &ReplxxImpl::transpose_characters );
+	bind_action( Replxx::KEY::control( '_' ),                 &ReplxxImpl::undo );
+	bind_action( Replxx::KEY::meta( '_' ),                    &ReplxxImpl::redo );
+	bind_action( Replxx::KEY::control( 'C' ),                 &ReplxxImpl::abort_line );
+	bind_action( Replxx::KEY::control( 'D' ),                 &ReplxxImpl::send_eof );
+	bind_action( 127,                                         &ReplxxImpl::delete_character );
+	bind_action( Replxx::KEY::DELETE + 0,                     &ReplxxImpl::delete_character );
+	bind_action( Replxx::KEY::BACKSPACE + 0,                  &ReplxxImpl::backspace_character );
+	bind_action( Replxx::KEY::control( 'J' ),                 &ReplxxImpl::commit_line );
+	bind_action( Replxx::KEY::ENTER + 0,                      &ReplxxImpl::commit_line );
+	bind_action( Replxx::KEY::control( 'L' ),                 &ReplxxImpl::clear_screen );
+	bind_action( Replxx::KEY::control( 'N' ),                 &ReplxxImpl::history_next );
+	bind_action( Replxx::KEY::control( 'P' ),                 &ReplxxImpl::history_previous );
+	bind_action( Replxx::KEY::DOWN + 0,                       &ReplxxImpl::history_next );
+	bind_action( Replxx::KEY::UP + 0,                         &ReplxxImpl::history_previous );
+	bind_action( Replxx::KEY::meta( '>' ),                    &ReplxxImpl::history_last );
+	bind_action( Replxx::KEY::meta( '<' ),                    &ReplxxImpl::history_first );
+	bind_action( Replxx::KEY::PAGE_DOWN + 0,                  &ReplxxImpl::history_last );
+	bind_action( Replxx::KEY::PAGE_UP + 0,                    &ReplxxImpl::history_first );
+	bind_action( Replxx::KEY::control( Replxx::KEY::UP ),     &ReplxxImpl::hint_previous );
+	bind_action( Replxx::KEY::control( Replxx::KEY::DOWN ),   &ReplxxImpl::hint_next );
 #ifndef _WIN32
-	bind_key( Replxx::KEY::control( 'Z' ),                 std::bind( &ReplxxImpl::suspend,                    this, _1 ) );
+	bind_action( Replxx::KEY::control( 'Z' ),                 &ReplxxImpl::suspend );
 #endif
-	bind_key( Replxx::KEY::TAB + 0,                        std::bind( &ReplxxImpl::complete_line,              this, _1 ) );
-	bind_key( Replxx::KEY::control( 'R' ),                 std::bind( &ReplxxImpl::incremental_history_search, this, _1 ) );
-	bind_key( Replxx::KEY::control( 'S' ),                 std::bind( &ReplxxImpl::incremental_history_search, this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'p' ),                    std::bind( &ReplxxImpl::common_prefix_search,       this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'P' ),                    std::bind( &ReplxxImpl::common_prefix_search,       this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'n' ),                    std::bind( &ReplxxImpl::common_prefix_search,       this, _1 ) );
-	bind_key( Replxx::KEY::meta( 'N' ),                    std::bind( &ReplxxImpl::common_prefix_search,       this, _1 ) );
+	bind_action( Replxx::KEY::TAB + 0,                        &ReplxxImpl::complete_line );
+	bind_action( Replxx::KEY::control( 'R' ),                 &ReplxxImpl::incremental_history_search );
+	bind_action( Replxx::KEY::control( 'S' ),                 &ReplxxImpl::incremental_history_search );
+	bind_action( Replxx::KEY::meta( 'p' ),                    &ReplxxImpl::common_prefix_search );
+	bind_action( Replxx::KEY::meta( 'P' ),                    &ReplxxImpl::common_prefix_search );
+	bind_action( Replxx::KEY::meta( 'n' ),                    &ReplxxImpl::common_prefix_search );
+	bind_action( Replxx::KEY::meta( 'N' ),                    &ReplxxImpl::common_prefix_search );
+	_terminal.set_escape_timeout( _keySequenceTimeout );
+}
+
+Replxx::ReplxxImpl::~ReplxxImpl( void ) {
+	if ( ! _latencyReportFile.empty() ) {
+		std::ofstream report( _latencyReportFile );
+		report << _latency.report();
+	}
 }
 
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::invoke( Replxx::ACTION action, char32_t code ) {
@@ -210,15 +257,82 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::invoke( Replxx::ACTION action, char32_
 		case ( Replxx::ACTION::COMMIT_LINE ):                     return ( commit_line( code ) );
 		case ( Replxx::ACTION::ABORT_LINE ):                      return ( abort_line( code ) );
 		case ( Replxx::ACTION::SEND_EOF ):                        return ( send_eof( code ) );
+		case ( Replxx::ACTION::UNDO ):                            return ( undo( code ) );
+		case ( Replxx::ACTION::REDO ):                            return ( redo( code ) );
 	}
 	return ( Replxx::ACTION_RESULT::BAIL );
 }
 
 void Replxx::ReplxxImpl::bind_key( char32_t code_, Replxx::key_press_handler_t handler_ ) {
-	_keyPressHandlers[code_] = handler_;
+	int id( _keyMap.find( code_ ) );
+	if ( id != KeyMap::NONE ) {
+		KeyPressHandler& handler( _keyPressHandlers[id - 1] );
+		// user handlers and handlers of key sequence prefixes are never shared
+		// between keys so we can replace it in place
+		if ( ! handler._action || handler._sequences ) {
+			handler._action = nullptr;
+			handler._handler = handler_;
+			return;
+		}
+	}
+	_keyPressHandlers.push_back( KeyPressHandler{ nullptr, handler_, 0 } );
+	_keyMap.set( code_, static_cast<int>( _keyPressHandlers.size() ) );
+}
+
+void Replxx::ReplxxImpl::bind_key_sequence( Replxx::key_sequence_t const& keys_, Replxx::key_press_handler_t handler_ ) {
+	if ( keys_.empty() ) {
+		return;
+	}
+	if ( keys_.size() == 1 ) {
+		bind_key( keys_.front(), handler_ );
+		return;
+	}
+	int id( _keyMap.find( keys_.front() ) );
+	if ( ( id == KeyMap::NONE ) || ( _keyPressHandlers[id - 1]._action && ! _keyPressHandlers[id - 1]._sequences ) ) {
+		// first key needs its own handler, keep its current single key binding
+		KeyPressHandler handler( id != KeyMap::NONE ? _keyPressHandlers[id - 1] : KeyPressHandler{ nullptr, nullptr, 0 } );
+		_keyPressHandlers.push_back( handler );
+		id = static_cast<int>( _keyPressHandlers.size() );
+		_keyMap.set( keys_.front(), id );
+	}
+	if ( ! _keyPressHandlers[id - 1]._sequences ) {
+		_keyPressHandlers[id - 1]._sequences = _keySequences.new_node();
+	}
+	int node( _keyPressHandlers[id - 1]._sequences );
+	for ( Replxx::key_sequence_t::const_iterator it( keys_.begin() + 1 ); it != keys_.end(); ++ it ) {
+		node = _keySequences.add_child( node, *it );
+	}
+	int handlerId( _keySequences.handler( node ) );
+	if ( handlerId != KeyMap::NONE ) {
+		_keyPressHandlers[handlerId - 1]._handler = handler_;
+	} else {
+		_keyPressHandlers.push_back( KeyPressHandler{ nullptr, handler_, 0 } );
+		_keySequences.set_handler( node, static_cast<int>( _keyPressHandlers.size() ) );
+	}
+}
+
+void Replxx::ReplxxImpl::set_key_sequence_timeout( int timeout_ ) {
+	_keySequenceTimeout = timeout_ > 0 ? timeout_ : 0;
+	_terminal.set_escape_timeout( _keySequenceTimeout );
 }
 
-char32_t Replxx::ReplxxImpl::read_char( void ) {
+// Bind built-in action, handlers for built-in actions are shared between keys.
+void Replxx::ReplxxImpl::bind_action( char32_t code_, key_press_handler_raw_t action_ ) {
+	key_press_handlers_t::iterator it(
+		std::find_if(
+			_keyPressHandlers.begin(), _keyPressHandlers.end(),
+			[action_]( KeyPressHandler const& h ) { return ( h._action == action_ ); }
+		)
+	);
+	if ( it == _keyPressHandlers.end() ) {
+		it = _keyPressHandlers.insert( it, KeyPressHandler{ action_, nullptr, 0 } );
+	}
+	_keyMap.set( code_, static_cast<int>( it - _keyPressHandlers.begin() ) + 1 );
+}
+
+// idleRefresh_ - caller is the main editing loop, the line may be refreshed
+// with callbacks deferred by their budgets once input is idle.
+char32_t Replxx::ReplxxImpl::read_char( bool wait_, bool idleRefresh_ ) {
 	/* try scheduled key presses */ {
 		std::lock_guard<std::mutex> l( _mutex );
 		if ( !_keyPresses.empty() ) {
@@ -228,22 +342,67 @@ char32_t Replxx::ReplxxImpl::read_char( void ) {
 		}
 	}
 	while ( true ) {
-		Terminal::EVENT_TYPE eventType( _terminal.wait_for_input() );
+		if ( idleRefresh_ && take_resize() ) {
+			redraw_after_resize();
+		}
+		int long timeout( wait_ ? -1 : 0 );
+		if ( ! _messages.empty() ) {
+			// messages were deferred by redraw rate limit,
+			// without waiting next_timeout() tells when they are due
+			int long toRedraw( time_to_redraw() );
+			if ( toRedraw <= 0 ) {
+				flush_messages();
+			} else if ( wait_ ) {
+				timeout = toRedraw;
+			}
+		}
+		int long toSequenceTimeout( key_sequence_time_left() );
+		if ( toSequenceTimeout == 0 ) {
+			return ( static_cast<char32_t>( KEY_SEQUENCE_TIMEOUT ) );
+		}
+		if ( ( toSequenceTimeout > 0 ) && ( timeout != 0 ) && ( ( timeout < 0 ) || ( toSequenceTimeout < timeout ) ) ) {
+			timeout = toSequenceTimeout;
+		}
+		int long toEscapeTimeout( _terminal.escape_time_left() );
+		if ( toEscapeTimeout == 0 ) {
+			// terminal gives up on pending escape sequence
+			break;
+		}
+		if ( ( toEscapeTimeout > 0 ) && ( timeout != 0 ) && ( ( timeout < 0 ) || ( toEscapeTimeout < timeout ) ) ) {
+			timeout = toEscapeTimeout;
+		}
+		bool idle( _callbacksDeferred && idleRefresh_ );
+		if ( idle && ( timeout != 0 ) ) {
+			int long toIdle( max( time_to_idle(), 0L ) );
+			if ( ( timeout < 0 ) || ( toIdle < timeout ) ) {
+				timeout = toIdle;
+			}
+		}
+		flush_clipboard();
+		Terminal::EVENT_TYPE eventType( _terminal.wait_for_input( timeout ) );
 		if ( eventType == Terminal::EVENT_TYPE::KEY_PRESS ) {
 			break;
 		}
-		std::lock_guard<std::mutex> l( _mutex );
-		clear_self_to_end_of_screen();
-		while ( ! _messages.empty() ) {
-			string const& message( _messages.front() );
-			_terminal.write8( message.data(), message.length() );
-			_messages.pop_front();
+		if ( eventType == Terminal::EVENT_TYPE::TIMEOUT ) {
+			// without waiting there is no idle period to wait for, no input is enough
+			if ( idle && ( ! wait_ || ( time_to_idle() <= 0 ) ) ) {
+				_callbacksDeferred = false;
+				_idleRefresh = true;
+				refresh_line();
+				_idleRefresh = false;
+			}
+			if ( ! wait_ ) {
+				return ( Terminal::INPUT_PENDING );
+			}
+			continue;
 		}
-		_prompt.write();
-		for ( int i( _prompt._extraLines ); i < _prompt._cursorRowOffset; ++ i ) {
-			_terminal.write8( "\n", 1 );
+		if ( eventType == Terminal::EVENT_TYPE::RESIZE ) {
+			// redrawn at the top of the loop, or once back in the main editing loop
+			continue;
+		}
+		if ( time_to_redraw() <= 0 ) {
+			flush_messages();
 		}
-		refresh_line( HINT_ACTION::SKIP );
 	}
 	/* try scheduled key presses */ {
 		std::lock_guard<std::mutex> l( _mutex );
@@ -253,45 +412,259 @@ char32_t Replxx::ReplxxImpl::read_char( void ) {
 			return ( keyPress );
 		}
 	}
-	return ( _terminal.read_char() );
+	LatencyTimer timer( latency(), Replxx::LATENCY_PHASE::READ_KEY );
+	return ( _terminal.read_char( wait_ ) );
+}
+
+// Copy last killed text to system clipboard with OSC 52 escape sequence.
+// Done when waiting for input, not on kill itself, so a series
+// of consecutive kills ends up in a single clipboard update.
+void Replxx::ReplxxImpl::flush_clipboard( void ) {
+	if ( ! _killRing.take_clipboard( _clipboardBuffer ) ) {
+		return;
+	}
+	std::string seq( "\033]52;c;" );
+	base64_encode( _clipboardBuffer.data(), static_cast<int>( _clipboardBuffer.length() ), seq );
+	seq.append( "\007" );
+	_terminal.write8( seq.data(), static_cast<int>( seq.length() ) );
+}
+
+// Print all messages queued by other threads at once and redraw the prompt.
+void Replxx::ReplxxImpl::flush_messages( void ) {
+	_messageBuffer.clear();
+	if ( _messages.take_all( _messageBuffer ) == 0 ) {
+		return;
+	}
+	clear_self_to_end_of_screen();
+	_terminal.write8( _messageBuffer.data(), static_cast<int>( _messageBuffer.length() ) );
+	_prompt.write();
+	for ( int i( _prompt._extraLines ); i < _prompt._cursorRowOffset; ++ i ) {
+		_terminal.write8( "\n", 1 );
+	}
+	refresh_line( HINT_ACTION::SKIP );
+	_lastMessagesRedraw = std::chrono::steady_clock::now();
+}
+
+// Milliseconds left until input is idle long enough for deferred callbacks.
+int long Replxx::ReplxxImpl::time_to_idle( void ) const {
+	int long elapsed(
+		static_cast<int long>(
+			std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - _callbacksDeferredAt ).count()
+		)
+	);
+	return ( _callbackIdlePeriod - elapsed );
+}
+
+// Check if more input is already waiting to be processed.
+bool Replxx::ReplxxImpl::typeahead( void ) {
+	/* scheduled key presses */ {
+		std::lock_guard<std::mutex> l( _mutex );
+		if ( ! _keyPresses.empty() ) {
+			return ( true );
+		}
+	}
+#ifdef _WIN32
+	return ( false );
+#else
+	return ( _terminal.typeahead() );
+#endif
+}
+
+// Decide if callback with given budget may be called in current refresh.
+bool Replxx::ReplxxImpl::callback_allowed( CallbackBudget const& budget_ ) {
+	switch ( budget_.degradation() ) {
+		case ( Replxx::CALLBACK_DEGRADATION::NONE ): {
+			return ( true );
+		}
+		case ( Replxx::CALLBACK_DEGRADATION::SKIP_ON_TYPEAHEAD ): {
+			return ( ! typeahead() );
+		}
+		case ( Replxx::CALLBACK_DEGRADATION::DEBOUNCE ):
+		case ( Replxx::CALLBACK_DEGRADATION::LARGE_BUFFER_OFF ): {
+			if ( budget_.is_off_for( _data.length() ) ) {
+				return ( false );
+			}
+			if ( _idleRefresh ) {
+				return ( true );
+			}
+			_callbacksDeferred = true;
+			_callbacksDeferredAt = std::chrono::steady_clock::now();
+			return ( false );
+		}
+	}
+	return ( true );
+}
+
+void Replxx::ReplxxImpl::callback_finished( Replxx::BUDGETED_CALLBACK callback_, CallbackBudget& budget_, CallbackBudget::clock_t::time_point start_ ) {
+	int long long overrun( budget_.account( start_, _data.length() ) );
+	if ( ( overrun >= 0 ) && !! _callbackBudgetHandler ) {
+		_callbackBudgetHandler( callback_, budget_.degradation(), overrun, _data.length() );
+	}
+}
+
+// Milliseconds left until prompt may be redrawn again due to printed messages.
+int long Replxx::ReplxxImpl::time_to_redraw( void ) const {
+	if ( _minRedrawInterval <= 0 ) {
+		return ( 0 );
+	}
+	int long elapsed(
+		static_cast<int long>(
+			std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - _lastMessagesRedraw ).count()
+		)
+	);
+	return ( _minRedrawInterval - elapsed );
 }
 
 void Replxx::ReplxxImpl::clear( void ) {
 	_pos = 0;
 	_prefix = 0;
 	_data.clear();
+	_undo.clear();
 	_hintSelection = -1;
 	_hint = UnicodeString();
 	_display.clear();
 	_displayInputLength = 0;
 }
 
-Replxx::ReplxxImpl::completions_t Replxx::ReplxxImpl::call_completer( std::string const& input, int& contextLen_ ) const {
-	Replxx::completions_t completionsIntermediary(
-		!! _completionCallback
-			? _completionCallback( input, contextLen_ )
-			: Replxx::completions_t()
-	);
-	completions_t completions;
-	completions.reserve( completionsIntermediary.size() );
-	for ( std::string const& c : completionsIntermediary ) {
-		completions.emplace_back( c.c_str() );
+Replxx::ReplxxImpl::completions_t const& Replxx::ReplxxImpl::call_completer( std::string const& input, int& contextLen_ ) {
+	if ( _completionIndex ) {
+		// word before cursor is looked up as is
+		int start( static_cast<int>( input.length() ) );
+		for ( int i( 0 ); ( i < contextLen_ ) && ( start > 0 ); ) {
+			-- start;
+			if ( is_lead_byte( input[start] ) ) {
+				++ i;
+			}
+		}
+		Replxx::StringView prefix( input.c_str() + start, static_cast<int>( input.length() ) - start );
+		if ( _fuzzyCompletion > 0 ) {
+			_completionIndex->complete_fuzzy( prefix, _completions.sink(), _fuzzyCompletion );
+			return ( _completions );
+		}
+		_completionIndex->complete( prefix, _completions.sink() );
+		_completions.set_common_prefix( _completionIndex->longest_common_prefix( prefix ) );
+		return ( _completions );
+	}
+	if ( ( _completionCacheTtl == 0 ) || ( _fuzzyCompletion > 0 ) ) {
+		Replxx::Candidates& completions( _completions.sink() );
+		if ( !! _completionCallback ) {
+			_completionCallback( Replxx::StringView( input.c_str(), static_cast<int>( input.length() ) ), contextLen_, completions );
+		}
+		return ( _completions );
+	}
+	int wordLen( contextLen_ );
+	if ( _completionCache.lookup( input, wordLen, contextLen_, _completionCacheTtl, _completions ) ) {
+		return ( _completions );
 	}
-	return ( completions );
+	int generation( _completionCache.generation() );
+	Replxx::Candidates& completions( _completions.sink() );
+	if ( !! _completionCallback ) {
+		_completionCallback( Replxx::StringView( input.c_str(), static_cast<int>( input.length() ) ), contextLen_, completions );
+	}
+	_completionCache.store( input, wordLen, contextLen_, _completions, generation );
+	return ( _completions );
 }
 
-Replxx::ReplxxImpl::hints_t Replxx::ReplxxImpl::call_hinter( std::string const& input, int& contextLen, Replxx::Color& color ) const {
-	Replxx::hints_t hintsIntermediary(
-		!! _hintCallback
-			? _hintCallback( input, contextLen, color )
-			: Replxx::hints_t()
-	);
-	hints_t hints;
-	hints.reserve( hintsIntermediary.size() );
-	for ( std::string const& h : hintsIntermediary ) {
-		hints.emplace_back( h.c_str() );
+// Run asynchronous completer and wait for it to finish, candidates received
+// so far are shown as hints in the meantime.
+// Returns key pressed by user before completer finished, 0 otherwise.
+char32_t Replxx::ReplxxImpl::call_async_completer( std::string const& input, int& contextLen_ ) {
+	int wordLen( contextLen_ );
+	bool useCache( ( _completionCacheTtl != 0 ) && ( _fuzzyCompletion == 0 ) );
+	if ( useCache && _completionCache.lookup( input, wordLen, contextLen_, _completionCacheTtl, _completions ) ) {
+		return ( 0 );
 	}
-	return ( hints );
+	int generation( _completionCache.generation() );
+	_completions.sink();
+	std::shared_ptr<AsyncCompletionRequest> request( std::make_shared<AsyncCompletionRequest>( input, contextLen_, _terminal ) );
+	_completionRequest = request.get();
+	int hintSelection( _hintSelection );
+	bool shown( false );
+	bool finished( false );
+	char32_t c( 0 );
+	_asyncCompletionCallback( request );
+	while ( true ) {
+		if ( request->take( _completions, contextLen_, finished ) && ! finished ) {
+			refresh_line();
+			shown = true;
+		}
+		if ( finished ) {
+			break;
+		}
+		/* try scheduled key presses */ {
+			std::lock_guard<std::mutex> l( _mutex );
+			if ( !_keyPresses.empty() ) {
+				c = _keyPresses.front();
+				_keyPresses.pop_front();
+			}
+		}
+		if ( c == 0 ) {
+			Terminal::EVENT_TYPE eventType( _terminal.wait_for_input( -1 ) );
+			if ( eventType == Terminal::EVENT_TYPE::MESSAGE ) {
+				flush_messages();
+				continue;
+			}
+			c = read_char( false );
+			if ( ( c == Terminal::INPUT_PENDING ) || ( c == static_cast<char32_t>( -1 ) ) ) {
+				c = 0;
+				continue;
+			}
+		}
+		if ( c == Replxx::KEY::TAB ) {
+			// complete with what we have got so far
+			c = 0;
+		}
+		break;
+	}
+	request->cancel();
+	if ( ( c == 0 ) && ! finished ) {
+		request->take( _completions, contextLen_, finished );
+	}
+	_completionRequest = nullptr;
+	_hintSelection = hintSelection;
+	if ( c != 0 ) {
+		_completions.sink();
+		if ( shown ) {
+			refresh_line();
+		}
+	} else if ( finished && useCache ) {
+		_completionCache.store( input, wordLen, contextLen_, _completions, generation );
+	}
+	return ( c );
+}
+
+// Keep only best fuzzy matches of completion context, best first.
+void Replxx::ReplxxImpl::rank_completions( std::string const& input, int contextLen_ ) {
+	int start( static_cast<int>( input.length() ) );
+	for ( int i( 0 ); ( i < contextLen_ ) && ( start > 0 ); ) {
+		-- start;
+		if ( is_lead_byte( input[start] ) ) {
+			++ i;
+		}
+	}
+	_fuzzyMatcher.set_pattern( input.c_str() + start, static_cast<int>( input.length() ) - start );
+	Replxx::Candidates ranked;
+	_fuzzyMatcher.rank( _completions.candidates(), ranked, _fuzzyCompletion );
+	_completions.sink() = std::move( ranked );
+}
+
+Replxx::ReplxxImpl::hints_t const& Replxx::ReplxxImpl::call_hinter( std::string const& input, int& contextLen, Replxx::Color& color ) {
+	if ( _completionRequest ) {
+		// candidates of pending asynchronous completion request
+		contextLen = _completionRequest->context_length();
+		return ( _completions );
+	}
+	// buffers of the hint list are reused on every keystroke
+	Replxx::Candidates& hints( _hints.sink() );
+	if ( !! _hintCallback && ( ! _hintBudget.is_set() || callback_allowed( _hintBudget ) ) ) {
+		LatencyTimer timer( latency(), Replxx::LATENCY_PHASE::HINT );
+		CallbackBudget::clock_t::time_point start( _hintBudget.is_set() ? CallbackBudget::clock_t::now() : CallbackBudget::clock_t::time_point() );
+		_hintCallback( Replxx::StringView( input.c_str(), static_cast<int>( input.length() ) ), contextLen, color, hints );
+		if ( _hintBudget.is_set() ) {
+			callback_finished( Replxx::BUDGETED_CALLBACK::HINT, _hintBudget, start );
+		}
+	}
+	return ( _hints );
 }
 
 void Replxx::ReplxxImpl::set_preload_buffer( std::string const& preloadText ) {
@@ -365,42 +738,253 @@ void Replxx::ReplxxImpl::emulate_key_press( char32_t keyCode_ ) {
 
 char const* Replxx::ReplxxImpl::input( std::string const& prompt ) {
 #ifndef _WIN32
-	gotResize = false;
+	_resizeGeneration = _terminal.resize_generation();
 #endif
 	try {
 		errno = 0;
-		if ( ! tty::in ) { // input not from a terminal, we should work with piped input, i.e. redirected stdin
+		bool custom( _terminal.has_custom_backend() );
+		if ( ! _terminal.in_tty() ) { // input not from a terminal, we should work with piped input, i.e. redirected stdin
 			return ( read_from_stdin() );
 		}
-		if (!_errorMessage.empty()) {
-			printf("%s", _errorMessage.c_str());
-			fflush(stdout);
-			_errorMessage.clear();
-		}
-		if ( isUnsupportedTerm() ) {
+		print_error_message();
+		if ( isUnsupportedTerm() && ! custom ) {
 			cout << prompt << flush;
 			fflush(stdout);
 			return ( read_from_stdin() );
 		}
-		if (_terminal.enable_raw_mode() == -1) {
+		if ( ! start_line( prompt ) ) {
 			return nullptr;
 		}
-		_prompt.set_text( UnicodeString( prompt ) );
-		_currentThread = std::this_thread::get_id();
-		clear();
-		if (!_preloadedBuffer.empty()) {
-			preload_puffer(_preloadedBuffer.c_str());
-			_preloadedBuffer.clear();
+		// loop collecting characters, respond to line editing characters
+		Replxx::ACTION_RESULT next( Replxx::ACTION_RESULT::CONTINUE );
+		while ( next == Replxx::ACTION_RESULT::CONTINUE ) {
+			next = process_key( read_char( true, true ) );
+		}
+		return ( finish_line( next ) );
+	} catch ( std::exception const& ) {
+		return ( finalize_input( nullptr ) );
+	}
+}
+
+bool Replxx::ReplxxImpl::start_input( std::string const& prompt ) {
+#ifdef _WIN32
+	static_cast<void>( prompt );
+	errno = ENOTSUP;
+	return ( false );
+#else
+	_resizeGeneration = _terminal.resize_generation();
+	try {
+		errno = 0;
+		if ( ! _terminal.in_tty() || ( ! _terminal.has_custom_backend() && isUnsupportedTerm() ) ) {
+			errno = ENOTTY;
+			return ( false );
+		}
+		print_error_message();
+		if ( ! start_line( prompt ) ) {
+			return ( false );
 		}
-		if ( get_input_line() == -1 ) {
-			return ( finalize_input( nullptr ) );
+		// Type-ahead already consumed from the terminal will not make input_fd() readable.
+		std::lock_guard<std::mutex> l( _mutex );
+		if ( _terminal.has_buffered_input() || ! _keyPresses.empty() ) {
+			_terminal.notify_event( Terminal::EVENT_TYPE::KEY_PRESS );
 		}
-		printf("\n");
-		_utf8Buffer.assign( _data );
-		return ( finalize_input( _utf8Buffer.get() ) );
+		return ( true );
 	} catch ( std::exception const& ) {
+		finalize_input( nullptr );
+		return ( false );
+	}
+#endif
+}
+
+Replxx::INPUT_STATUS Replxx::ReplxxImpl::process_input( char const*& line_ ) {
+	line_ = nullptr;
+	if ( _currentThread == std::thread::id() ) {
+		errno = EINVAL;
+		return ( Replxx::INPUT_STATUS::END_OF_FILE );
+	}
+	try {
+		Replxx::ACTION_RESULT next( Replxx::ACTION_RESULT::CONTINUE );
+		while ( next == Replxx::ACTION_RESULT::CONTINUE ) {
+			char32_t c( read_char( false, true ) );
+			if ( c == Terminal::INPUT_PENDING ) {
+				return ( Replxx::INPUT_STATUS::EDITING );
+			}
+			next = process_key( c );
+		}
+		line_ = finish_line( next );
+	} catch ( std::exception const& ) {
+		line_ = finalize_input( nullptr );
+	}
+	return ( line_ ? Replxx::INPUT_STATUS::COMPLETE : Replxx::INPUT_STATUS::END_OF_FILE );
+}
+
+int Replxx::ReplxxImpl::set_terminal( Replxx::TerminalBackend* terminal_ ) {
+#ifdef _WIN32
+	static_cast<void>( terminal_ );
+	errno = ENOTSUP;
+	return ( -1 );
+#else
+	_terminal.set_backend( terminal_ );
+	return ( 0 );
+#endif
+}
+
+int Replxx::ReplxxImpl::set_terminal_fds( int in_, int out_ ) {
+#ifdef _WIN32
+	static_cast<void>( in_ );
+	static_cast<void>( out_ );
+	errno = ENOTSUP;
+	return ( -1 );
+#else
+	if ( ( in_ < 0 ) || ( out_ < 0 ) ) {
+		errno = EBADF;
+		return ( -1 );
+	}
+	_terminal.set_fds( in_, out_ );
+	return ( 0 );
+#endif
+}
+
+void Replxx::ReplxxImpl::window_changed( void ) {
+	// a single pending event is enough for any number of changes,
+	// the flag itself is what tells a resize from a key press
+	if ( ! _windowChanged.exchange( true ) ) {
+		_terminal.notify_event( Terminal::EVENT_TYPE::RESIZE );
+	}
+}
+
+// Window size changed since last redraw, signal handler serves standard terminal only,
+// other sessions are told by their backend or with window_changed().
+bool Replxx::ReplxxImpl::take_resize( void ) {
+	bool resized( _windowChanged.exchange( false ) );
+#ifndef _WIN32
+	if ( resized ) {
+		_terminal.record_resize();
+	}
+	resized = _terminal.take_resize() || resized;
+	int generation( _terminal.resize_generation() );
+	if ( generation != _resizeGeneration ) {
+		_resizeGeneration = generation;
+		resized = true;
+	}
+#endif
+	return ( resized );
+}
+
+void Replxx::ReplxxImpl::redraw_after_resize( void ) {
+	_prompt.update_screen_columns();
+	// redraw the original prompt with current input
+	dynamicRefresh( _prompt, _data.get(), _data.length(), _pos );
+}
+
+int Replxx::ReplxxImpl::set_session_recording( std::string const& filename_ ) {
+#ifdef _WIN32
+	static_cast<void>( filename_ );
+	errno = ENOTSUP;
+	return ( -1 );
+#else
+	if ( filename_.empty() ) {
+		_terminal.stop_recording();
+		return ( 0 );
+	}
+	return ( _terminal.start_recording( filename_ ) );
+#endif
+}
+
+int Replxx::ReplxxImpl::input_fd( void ) const {
+#ifdef _WIN32
+	return ( -1 );
+#else
+	return ( _terminal.input_fd() );
+#endif
+}
+
+int Replxx::ReplxxImpl::event_fd( void ) const {
+#ifdef _WIN32
+	return ( -1 );
+#else
+	return ( _terminal.event_fd() );
+#endif
+}
+
+// Earliest deadline process_input() checks without waiting for input.
+int Replxx::ReplxxImpl::next_timeout( void ) const {
+	if ( _currentThread == std::thread::id() ) {
+		return ( -1 );
+	}
+	int long timeout( key_sequence_time_left() );
+	int long toEscapeTimeout( _terminal.escape_time_left() );
+	if ( ( toEscapeTimeout >= 0 ) && ( ( timeout < 0 ) || ( toEscapeTimeout < timeout ) ) ) {
+		timeout = toEscapeTimeout;
+	}
+	if ( ! _messages.empty() ) {
+		int long toRedraw( max( time_to_redraw(), 0L ) );
+		if ( ( timeout < 0 ) || ( toRedraw < timeout ) ) {
+			timeout = toRedraw;
+		}
+	}
+	return ( static_cast<int>( timeout ) );
+}
+
+void Replxx::ReplxxImpl::print_error_message( void ) {
+	if (!_errorMessage.empty()) {
+		_terminal.write8( _errorMessage.data(), static_cast<int>( _errorMessage.length() ) );
+		_errorMessage.clear();
+	}
+}
+
+bool Replxx::ReplxxImpl::start_line( std::string const& prompt ) {
+	if (_terminal.enable_raw_mode() == -1) {
+		return ( false );
+	}
+	_prompt.set_text( UnicodeString( prompt ) );
+	_currentThread = std::this_thread::get_id();
+	_keySequenceNode = 0;
+	_keySequence.clear();
+	_callbacksDeferred = false;
+	clear();
+	if (!_preloadedBuffer.empty()) {
+		preload_puffer(_preloadedBuffer.c_str());
+		_preloadedBuffer.clear();
+	}
+
+	// The latest history entry is always our current buffer
+	if ( _data.length() > 0 ) {
+		history_add( _data.utf8() );
+	} else {
+		history_add( "" );
+	}
+	_history.reset_pos();
+
+	// display the prompt
+	_prompt.write();
+
+#ifndef _WIN32
+	// we have to generate our own newline on line wrap on Linux
+	if ( ( _prompt._indentation == 0 ) && ( _prompt._extraLines > 0 ) ) {
+		_terminal.write8( "\n", 1 );
+	}
+#endif
+
+	// the cursor starts out at the end of the prompt
+	_prompt._cursorRowOffset = _prompt._extraLines;
+
+	// kill and yank start in "other" mode
+	_killRing.lastAction = KillRing::actionOther;
+
+	// if there is already text in the buffer, display it first
+	if (_data.length() > 0) {
+		refresh_line();
+	}
+	return ( true );
+}
+
+char const* Replxx::ReplxxImpl::finish_line( Replxx::ACTION_RESULT result_ ) {
+	if ( result_ != Replxx::ACTION_RESULT::RETURN ) {
 		return ( finalize_input( nullptr ) );
 	}
+	_terminal.write8( "\n", 1 );
+	return ( finalize_input( _data.utf8().c_str() ) );
 }
 
 char const* Replxx::ReplxxImpl::finalize_input( char const* retVal_ ) {
@@ -426,9 +1010,7 @@ int Replxx::ReplxxImpl::install_window_change_handler( void ) {
 void Replxx::ReplxxImpl::print( char const* str_, int size_ ) {
 	if ( ( _currentThread == std::thread::id() ) || ( _currentThread == std::this_thread::get_id() ) ) {
 		_terminal.write8( str_, size_ );
-	} else {
-		std::lock_guard<std::mutex> l( _mutex );
-		_messages.emplace_back( str_, size_ );
+	} else if ( _messages.push( str_, size_ ) ) {
 		_terminal.notify_event( Terminal::EVENT_TYPE::MESSAGE );
 	}
 	return;
@@ -441,6 +1023,40 @@ void Replxx::ReplxxImpl::preload_puffer(const char* preloadText) {
 	_prefix = _pos = _data.length();
 }
 
+// Edits of the line recorded in undo log, cursor_ is cursor position before the edit.
+void Replxx::ReplxxImpl::insert_text( int pos_, char32_t const* text_, int len_, int cursor_, bool chained_ ) {
+	_undo.insert( pos_, text_, len_, cursor_, chained_ );
+	_data.insert( pos_, text_, len_ );
+}
+
+void Replxx::ReplxxImpl::erase_text( int pos_, int len_, int cursor_, bool chained_ ) {
+	_undo.erase( pos_, _data.get( pos_, len_ ), len_, cursor_, chained_ );
+	_data.erase( pos_, len_ );
+}
+
+void Replxx::ReplxxImpl::replace_line( UnicodeString const& line_ ) {
+	erase_text( 0, _data.length(), _pos );
+	insert_text( 0, line_.get(), line_.length(), _pos, true );
+}
+
+// Record that text at pos_ (before_ before the change) was modified in place.
+void Replxx::ReplxxImpl::record_modification( int pos_, UnicodeString const& before_, int cursor_ ) {
+	int len( before_.length() );
+	if ( std::equal( before_.begin(), before_.end(), _data.get( pos_, len ) ) ) {
+		return;
+	}
+	_undo.erase( pos_, before_.get(), len, cursor_ );
+	_undo.insert( pos_, _data.get( pos_, len ), len, cursor_, true );
+}
+
+UnicodeString Replxx::ReplxxImpl::word_at_cursor( void ) {
+	int end( _pos );
+	while ( ( end < _data.length() ) && ! is_word_break_character( _data[end] ) ) {
+		++ end;
+	}
+	return ( UnicodeString( _data.get( _pos, end - _pos ), end - _pos ) );
+}
+
 void Replxx::ReplxxImpl::set_color( Replxx::Color color_ ) {
 	char const* code( ansi_color( color_ ) );
 	while ( *code ) {
@@ -461,9 +1077,13 @@ void Replxx::ReplxxImpl::highlight( HINT_ACTION hintAction_ ) {
 		return;
 	}
 	Replxx::colors_t colors( _data.length(), Replxx::Color::DEFAULT );
-	_utf8Buffer.assign( _data );
-	if ( !! _highlighterCallback ) {
-		_highlighterCallback( _utf8Buffer.get(), colors );
+	if ( !! _highlighterCallback && ( ! _highlighterBudget.is_set() || callback_allowed( _highlighterBudget ) ) ) {
+		LatencyTimer timer( latency(), Replxx::LATENCY_PHASE::HIGHLIGHTER );
+		CallbackBudget::clock_t::time_point start( _highlighterBudget.is_set() ? CallbackBudget::clock_t::now() : CallbackBudget::clock_t::time_point() );
+		_highlighterCallback( Replxx::StringView( _data.utf8().c_str(), static_cast<int>( _data.utf8().length() ) ), colors );
+		if ( _highlighterBudget.is_set() ) {
+			callback_finished( Replxx::BUDGETED_CALLBACK::HIGHLIGHTER, _highlighterBudget, start );
+		}
 	}
 	paren_info_t pi( matching_paren() );
 	if ( pi.index != -1 ) {
@@ -487,7 +1107,11 @@ int Replxx::ReplxxImpl::handle_hints( HINT_ACTION hintAction_ ) {
 	if ( _noColor ) {
 		return ( 0 );
 	}
-	if ( ! _hintCallback ) {
+	if ( _completionMenu.is_open() && ( hintAction_ != HINT_ACTION::SKIP ) && ( hintAction_ != HINT_ACTION::TRIM ) ) {
+		render_completion_menu();
+		return ( 0 );
+	}
+	if ( ! _hintCallback && ! _completionRequest ) {
 		return ( 0 );
 	}
 	if ( ( hintAction_ == HINT_ACTION::SKIP ) || ( hintAction_ == HINT_ACTION::TRIM ) ) {
@@ -502,12 +1126,12 @@ int Replxx::ReplxxImpl::handle_hints( HINT_ACTION hintAction_ ) {
 		_hintSelection = -1;
 	}
 	Replxx::Color c( Replxx::Color::GRAY );
-	_utf8Buffer.assign( _data, _pos );
 	int contextLen( context_length() );
-	Replxx::ReplxxImpl::hints_t hints( call_hinter( _utf8Buffer.get(), contextLen, c ) );
+	// hints are shown only with cursor at the end of input
+	Replxx::ReplxxImpl::hints_t const& hints( call_hinter( _data.utf8(), contextLen, c ) );
 	int hintCount( hints.size() );
 	if ( hintCount == 1 ) {
-		_hint = hints.front();
+		_hint = hints[0];
 		len = _hint.length() - contextLen;
 		if ( len > 0 ) {
 			set_color( c );
@@ -567,6 +1191,60 @@ int Replxx::ReplxxImpl::handle_hints( HINT_ACTION hintAction_ ) {
 	return ( len );
 }
 
+// Only entries visible in the menu window are rendered.
+void Replxx::ReplxxImpl::render_completion_menu( void ) {
+	int maxCol( _prompt.screen_columns() );
+#ifdef _WIN32
+	-- maxCol;
+#endif
+	// selection marker goes in front of completion context
+	int startCol( max( _prompt._indentation + _pos - _completionMenu.context_length() - 2, 0 ) );
+	for ( int row( 0 ); row < _completionMenu.visible(); ++ row ) {
+		int entry( _completionMenu.top() + row );
+		bool selected( entry == _completionMenu.selected() );
+#ifdef _WIN32
+		_display.push_back( '\r' );
+#endif
+		_display.push_back( '\n' );
+		int col( 0 );
+		for ( ; ( col < startCol ) && ( col < maxCol ); ++ col ) {
+			_display.push_back( ' ' );
+		}
+		set_color( selected ? Replxx::Color::BRIGHTMAGENTA : Replxx::Color::GRAY );
+		_display.push_back( selected ? '>' : ' ' );
+		_display.push_back( ' ' );
+		col += 2;
+		UnicodeString const& c( _completions[_completionMenu.item( entry )] );
+		for ( int i( 0 ); i < c.length(); ++ i ) {
+			// wide characters take two columns
+			int width( max( calculate_displayed_length( c.get() + i, 1 ), 0 ) );
+			if ( col + width > maxCol ) {
+				break;
+			}
+			_display.push_back( c[i] );
+			col += width;
+		}
+		set_color( Replxx::Color::DEFAULT );
+	}
+	if ( _completionMenu.size() > _completionMenu.rows() ) {
+		char status[32];
+		int len( snprintf( status, sizeof ( status ), "%d/%d", _completionMenu.selected() + 1, _completionMenu.size() ) );
+#ifdef _WIN32
+		_display.push_back( '\r' );
+#endif
+		_display.push_back( '\n' );
+		int col( 0 );
+		for ( ; ( col < startCol + 2 ) && ( col < maxCol ); ++ col ) {
+			_display.push_back( ' ' );
+		}
+		set_color( Replxx::Color::GRAY );
+		for ( int i( 0 ); ( i < len ) && ( col < maxCol ); ++ i, ++ col ) {
+			_display.push_back( status[i] );
+		}
+		set_color( Replxx::Color::DEFAULT );
+	}
+}
+
 Replxx::ReplxxImpl::paren_info_t Replxx::ReplxxImpl::matching_paren( void ) {
 	if (_pos >= _data.length()) {
 		return ( paren_info_t{ -1, false } );
@@ -632,6 +1310,7 @@ Replxx::ReplxxImpl::paren_info_t Replxx::ReplxxImpl::matching_paren( void ) {
  * redrawn here screen position
  */
 void Replxx::ReplxxImpl::refresh_line( HINT_ACTION hintAction_ ) {
+	LatencyTimer timer( latency(), Replxx::LATENCY_PHASE::REFRESH );
 	// check for a matching brace/bracket/paren, remember its position if found
 	highlight( hintAction_ );
 	int hintLen( handle_hints( hintAction_ ) );
@@ -639,11 +1318,12 @@ void Replxx::ReplxxImpl::refresh_line( HINT_ACTION hintAction_ ) {
 	int xEndOfInput( 0 ), yEndOfInput( 0 );
 	calculate_screen_position(
 		_prompt._indentation, 0, _prompt.screen_columns(),
-		calculate_displayed_length( _data.get(), _data.length() ) + hintLen,
+		calculate_displayed_length( _data, _data.length() ) + hintLen,
 		xEndOfInput, yEndOfInput
 	);
 	if ( _noColor ) {
-		yEndOfInput += count( _data.begin(), _data.end(), '\n' );
+		yEndOfInput += count( _data.head(), _data.head() + _data.head_length(), '\n' );
+		yEndOfInput += count( _data.tail(), _data.tail() + _data.tail_length(), '\n' );
 	} else {
 		yEndOfInput += count( _display.begin(), _display.end(), '\n' );
 	}
@@ -652,7 +1332,7 @@ void Replxx::ReplxxImpl::refresh_line( HINT_ACTION hintAction_ ) {
 	int xCursorPos( 0 ), yCursorPos( 0 );
 	calculate_screen_position(
 		_prompt._indentation, 0, _prompt.screen_columns(),
-		calculate_displayed_length( _data.get(), _pos ),
+		calculate_displayed_length( _data, _pos ),
 		xCursorPos, yCursorPos
 	);
 
@@ -667,7 +1347,8 @@ void Replxx::ReplxxImpl::refresh_line( HINT_ACTION hintAction_ ) {
 	if ( !_noColor ) {
 		_terminal.write32( _display.data(), _display.size() );
 	} else {
-		_terminal.write32( _data.get(), _data.length() );
+		_terminal.write32( _data.head(), _data.head_length() );
+		_terminal.write32( _data.tail(), _data.tail_length() );
 	}
 #ifndef _WIN32
 	// we have to generate our own newline on line wrap
@@ -691,34 +1372,6 @@ int Replxx::ReplxxImpl::context_length() {
 	return ( _pos - prefixLength );
 }
 
-namespace {
-int longest_common_prefix( Replxx::ReplxxImpl::completions_t const& completions ) {
-	int completionsCount( completions.size() );
-	if ( completionsCount < 1 ) {
-		return ( 0 );
-	}
-	int longestCommonPrefix( 0 );
-	UnicodeString const& sample( completions.front() );
-	while ( true ) {
-		if ( longestCommonPrefix >= sample.length() ) {
-			return ( longestCommonPrefix );
-		}
-		char32_t sc( sample[longestCommonPrefix] );
-		for ( int i( 1 ); i < completionsCount; ++ i ) {
-			UnicodeString const& candidate( completions[i] );
-			if ( longestCommonPrefix >= candidate.length() ) {
-				return ( longestCommonPrefix );
-			}
-			char32_t cc( candidate[longestCommonPrefix] );
-			if ( cc != sc ) {
-				return ( longestCommonPrefix );
-			}
-		}
-		++ longestCommonPrefix;
-	}
-}
-}
-
 /**
  * Handle command completion, using a completionCallback() routine to provide
  * possible substitutions
@@ -736,14 +1389,25 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 	// extract a copy to parse.	we also handle the case where tab is hit while
 	// not at end-of-line.
 
-	_utf8Buffer.assign( _data, _pos );
+	std::string input( _data.utf8(), 0, static_cast<size_t>( _data.utf8_offset( _pos ) ) );
 	// get a list of completions
 	int contextLen( context_length() );
-	Replxx::ReplxxImpl::completions_t completions( call_completer( _utf8Buffer.get(), contextLen ) );
+	if ( !! _asyncCompletionCallback && ! _completionIndex ) {
+		c = call_async_completer( input, contextLen );
+		if ( c != 0 ) {
+			return ( c );
+		}
+	} else {
+		call_completer( input, contextLen );
+	}
+	if ( ( _fuzzyCompletion > 0 ) && ! _completionIndex ) {
+		rank_completions( input, contextLen );
+	}
+	Replxx::ReplxxImpl::completions_t const& completions( _completions );
 
 	// if no completions, we are done
 	if (completions.size() == 0) {
-		beep();
+		_terminal.beep();
 		return 0;
 	}
 
@@ -756,19 +1420,20 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 		completionsCount = 1;
 	}
 	if ( completionsCount == 1 ) {
-		longestCommonPrefix = static_cast<int>(completions[selectedCompletion].length());
+		longestCommonPrefix = completions.length( selectedCompletion );
 	} else {
-		longestCommonPrefix = longest_common_prefix( completions );
+		longestCommonPrefix = completions.longest_common_prefix();
 	}
 	if ( _beepOnAmbiguousCompletion && ( completionsCount != 1 ) ) { // beep if ambiguous
-		beep();
+		_terminal.beep();
 	}
 
 	// if we can extend the item, extend it and return to main loop
 	if ( ( longestCommonPrefix > contextLen ) || ( completionsCount == 1 ) ) {
+		int cursor( _pos );
 		_pos -= contextLen;
-		_data.erase( _pos, contextLen );
-		_data.insert( _pos, completions[selectedCompletion], 0, longestCommonPrefix );
+		erase_text( _pos, contextLen, cursor );
+		insert_text( _pos, completions[selectedCompletion].get(), longestCommonPrefix, cursor, true );
 		_prefix = _pos = _pos + longestCommonPrefix;
 		refresh_line();
 		return 0;
@@ -786,6 +1451,10 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 		}
 	}
 
+	if ( ( _completionMenuRows > 0 ) && ! _noColor ) {
+		return ( completion_menu( contextLen ) );
+	}
+
 	// we got a second tab, maybe show list of possible completions
 	bool showCompletions = true;
 	bool onNewLine = false;
@@ -794,9 +1463,9 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 		_pos = _data.length();
 		refresh_line();
 		_pos = savePos;
-		printf("\nDisplay all %u possibilities? (y or n)",
-					 static_cast<unsigned int>(completions.size()));
-		fflush(stdout);
+		char question[64];
+		int len( snprintf( question, sizeof ( question ), "\nDisplay all %u possibilities? (y or n)", static_cast<unsigned int>( completions.size() ) ) );
+		_terminal.write8( question, len );
 		onNewLine = true;
 		while (c != 'y' && c != 'Y' && c != 'n' && c != 'N' && c != Replxx::KEY::control('C')) {
 			do {
@@ -820,11 +1489,19 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 	// if showing the list, do it the way readline does it
 	bool stopList( false );
 	if ( showCompletions ) {
+		// column width is based on screen width of completions, not on their length
+		int completionCount( completions.size() );
+		_listingWidths.resize( static_cast<size_t>( completionCount ) );
 		int longestCompletion( 0 );
-		for ( size_t j( 0 ); j < completions.size(); ++ j ) {
-			int itemLength( static_cast<int>( completions[j].length() ) );
-			if ( itemLength > longestCompletion ) {
-				longestCompletion = itemLength;
+		for ( int j( 0 ); j < completionCount; ++ j ) {
+			UnicodeString const& item( completions[j] );
+			int itemWidth( calculate_displayed_length( item.get(), item.length() ) );
+			if ( itemWidth < 0 ) {
+				itemWidth = item.length();
+			}
+			_listingWidths[static_cast<size_t>( j )] = itemWidth;
+			if ( itemWidth > longestCompletion ) {
+				longestCompletion = itemWidth;
 			}
 		}
 		longestCompletion += 2;
@@ -840,19 +1517,26 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 		} else {
 			_terminal.clear_screen( Terminal::CLEAR_SCREEN::TO_END );
 		}
+		static UnicodeString const col( ansi_color( Replxx::Color::BRIGHTMAGENTA ) );
+		static UnicodeString const res( ansi_color( Replxx::Color::DEFAULT ) );
+		static char const more[] = "\n--More--";
+		static char const clearMore[] = "\r				\r";
+		// whole page is composed in _listing and written with a single call
+		_listing.clear();
 		size_t pauseRow = _terminal.get_screen_rows() - 1;
-		size_t rowCount = (completions.size() + columnCount - 1) / columnCount;
-		for (size_t row = 0; row < rowCount; ++row) {
-			if (row == pauseRow) {
-				printf("\n--More--");
-				fflush(stdout);
+		size_t rowCount = ( completionCount + columnCount - 1 ) / columnCount;
+		for ( size_t row = 0; row < rowCount; ++ row ) {
+			if ( row == pauseRow ) {
+				_listing.insert( _listing.end(), more, more + sizeof ( more ) - 1 );
+				_terminal.write32( _listing.data(), static_cast<int>( _listing.size() ) );
+				_listing.clear();
 				c = 0;
 				bool doBeep = false;
 				while (c != ' ' && c != Replxx::KEY::ENTER && c != 'y' && c != 'Y' &&
 							 c != 'n' && c != 'N' && c != 'q' && c != 'Q' &&
 							 c != Replxx::KEY::control('C')) {
 					if (doBeep) {
-						beep();
+						_terminal.beep();
 					}
 					doBeep = true;
 					do {
@@ -863,61 +1547,55 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 					case ' ':
 					case 'y':
 					case 'Y':
-						printf("\r				\r");
+						_listing.insert( _listing.end(), clearMore, clearMore + sizeof ( clearMore ) - 1 );
 						pauseRow += _terminal.get_screen_rows() - 1;
 						break;
 					case Replxx::KEY::ENTER:
-						printf("\r				\r");
+						_listing.insert( _listing.end(), clearMore, clearMore + sizeof ( clearMore ) - 1 );
 						++pauseRow;
 						break;
 					case 'n':
 					case 'N':
 					case 'q':
 					case 'Q':
-						printf("\r				\r");
+						_listing.insert( _listing.end(), clearMore, clearMore + sizeof ( clearMore ) - 1 );
 						stopList = true;
 						break;
 					case Replxx::KEY::control('C'):
 						// Display the ^C we got
-						_terminal.write8( "^C", 2 );
+						_listing.insert( _listing.end(), { '^', 'C' } );
 						stopList = true;
 						break;
 				}
 			} else {
-				printf("\n");
+				_listing.push_back( '\n' );
 			}
 			if (stopList) {
 				break;
 			}
 			for (int column = 0; column < columnCount; ++column) {
 				size_t index = (column * rowCount) + row;
-				if (index < completions.size()) {
-					int itemLength = static_cast<int>(completions[index].length());
-					fflush(stdout);
-
+				if ( index < static_cast<size_t>( completionCount ) ) {
+					UnicodeString const& item( completions[static_cast<int>( index )] );
+					char32_t const* text( item.get() );
 					if ( longestCommonPrefix > 0 ) {
-						static UnicodeString const col(ansi_color(Replxx::Color::BRIGHTMAGENTA));
-						if (!_noColor) {
-							_terminal.write32(col.get(), col.length());
+						if ( ! _noColor ) {
+							_listing.insert( _listing.end(), col.begin(), col.end() );
 						}
-						_terminal.write32(&_data[_pos - contextLen], longestCommonPrefix);
-						static UnicodeString const res(ansi_color(Replxx::Color::DEFAULT));
-						if (!_noColor) {
-							_terminal.write32(res.get(), res.length());
+						_listing.insert( _listing.end(), text, text + longestCommonPrefix );
+						if ( ! _noColor ) {
+							_listing.insert( _listing.end(), res.begin(), res.end() );
 						}
 					}
-
-					_terminal.write32( completions[index].get() + longestCommonPrefix, itemLength - longestCommonPrefix );
-
-					if (((column + 1) * rowCount) + row < completions.size()) {
-						for ( int k( itemLength ); k < longestCompletion; ++k ) {
-							printf( " " );
-						}
+					_listing.insert( _listing.end(), text + longestCommonPrefix, text + item.length() );
+					if ( ( ( column + 1 ) * rowCount ) + row < static_cast<size_t>( completionCount ) ) {
+						_listing.insert( _listing.end(), static_cast<size_t>( longestCompletion - _listingWidths[index] ), ' ' );
 					}
 				}
 			}
 		}
-		fflush(stdout);
+		_terminal.write32( _listing.data(), static_cast<int>( _listing.size() ) );
+		_listing.clear();
 	}
 
 	// display the prompt on a new line, then redisplay the input buffer
@@ -936,76 +1614,185 @@ char32_t Replxx::ReplxxImpl::do_complete_line( void ) {
 	return 0;
 }
 
-int Replxx::ReplxxImpl::get_input_line( void ) {
-	// The latest history entry is always our current buffer
-	if ( _data.length() > 0 ) {
-		_utf8Buffer.assign( _data );
-		history_add( _utf8Buffer.get() );
-	} else {
-		history_add( "" );
+// Let user pick one of completions from a menu, menu is filtered as user types.
+// Returns key that closed the menu and has to be handled by main loop, 0 otherwise.
+char32_t Replxx::ReplxxImpl::completion_menu( int contextLen_ ) {
+	int baseLen( contextLen_ );
+	int screenRows( max( _terminal.get_screen_rows() - 2, 1 ) );
+	int rows( min( _completionMenuRows, screenRows ) );
+	if ( ( _completions.size() > rows ) && ( rows == screenRows ) && ( rows > 1 ) ) {
+		// make room for status line
+		-- rows;
 	}
-	_history.reset_pos();
-
-	// display the prompt
-	_prompt.write();
+	_completionMenu.open( _completions.size(), rows, contextLen_ );
+	FuzzyMatcher* fuzzy( _fuzzyCompletion > 0 ? &_fuzzyMatcher : nullptr );
+	refresh_line();
+	char32_t c( 0 );
+	bool accept( false );
+	while ( true ) {
+		do {
+			c = read_char();
+		} while ( c == static_cast<char32_t>( -1 ) );
+		if ( static_cast<int>( c ) < 0 ) {
+			break;
+		}
+		if ( ( c == Replxx::KEY::DOWN ) || ( c == Replxx::KEY::TAB ) || ( c == Replxx::KEY::control( 'N' ) ) ) {
+			_completionMenu.move( 1 );
+		} else if ( ( c == Replxx::KEY::UP ) || ( c == Replxx::KEY::control( 'P' ) ) ) {
+			_completionMenu.move( -1 );
+		} else if ( c == Replxx::KEY::PAGE_DOWN ) {
+			_completionMenu.move( rows );
+		} else if ( c == Replxx::KEY::PAGE_UP ) {
+			_completionMenu.move( -rows );
+		} else if ( c == Replxx::KEY::ENTER ) {
+			accept = _completionMenu.size() > 0;
+			c = 0;
+			break;
+		} else if ( ( c == Replxx::KEY::ESCAPE ) || ( c == Replxx::KEY::control( 'C' ) ) || ( c == Replxx::KEY::control( 'G' ) ) ) {
+			c = 0;
+			break;
+		} else if ( c == Replxx::KEY::BACKSPACE ) {
+			if ( contextLen_ <= baseLen ) {
+				break;
+			}
+			-- _pos;
+			erase_text( _pos, 1, _pos + 1 );
+			-- contextLen_;
+			if ( contextLen_ == baseLen ) {
+				_completionMenu.open( _completions.size(), rows, contextLen_ );
+			} else {
+				int start( _data.utf8_offset( _pos - contextLen_ ) );
+				_completionMenu.filter( _completions, _data.utf8().c_str() + start, _data.utf8_offset( _pos ) - start, false, contextLen_, fuzzy );
+			}
+		} else if ( ( c < Replxx::KEY::BASE ) && ! is_control_code( c ) && ! is_word_break_character( c ) ) {
+			insert_text( _pos, &c, 1, _pos );
+			++ _pos;
+			++ contextLen_;
+			int start( _data.utf8_offset( _pos - contextLen_ ) );
+			_completionMenu.filter( _completions, _data.utf8().c_str() + start, _data.utf8_offset( _pos ) - start, true, contextLen_, fuzzy );
+		} else {
+			break;
+		}
+		refresh_line();
+	}
+	if ( accept ) {
+		UnicodeString const& choice( _completions[_completionMenu.item( _completionMenu.selected() )] );
+		int cursor( _pos );
+		_pos -= contextLen_;
+		erase_text( _pos, contextLen_, cursor );
+		insert_text( _pos, choice.get(), choice.length(), cursor, true );
+		_pos += choice.length();
+	}
+	_prefix = _pos;
+	_completionMenu.close();
+	refresh_line();
+	return ( c );
+}
 
-#ifndef _WIN32
-	// we have to generate our own newline on line wrap on Linux
-	if ( ( _prompt._indentation == 0 ) && ( _prompt._extraLines > 0 ) ) {
-		_terminal.write8( "\n", 1 );
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::process_key( int c ) {
+	LatencyTimer timer( latency(), Replxx::LATENCY_PHASE::DISPATCH );
+	if ( ( c == 0 ) && take_resize() ) {
+		// caught a window resize event
+		redraw_after_resize();
+		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
-#endif
 
-	// the cursor starts out at the end of the prompt
-	_prompt._cursorRowOffset = _prompt._extraLines;
+	if (c == 0) {
+		return ( Replxx::ACTION_RESULT::RETURN );
+	}
 
-	// kill and yank start in "other" mode
-	_killRing.lastAction = KillRing::actionOther;
+	if (c == -1) {
+		refresh_line();
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
 
-	// if there is already text in the buffer, display it first
-	if (_data.length() > 0) {
+	if (c == -2) {
+		_prompt.write();
 		refresh_line();
+		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
 
-	// loop collecting characters, respond to line editing characters
-	Replxx::ACTION_RESULT next( Replxx::ACTION_RESULT::CONTINUE );
-	while ( next == Replxx::ACTION_RESULT::CONTINUE ) {
-		int c( read_char() ); // get a new keystroke
-#ifndef _WIN32
-		if (c == 0 && gotResize) {
-			// caught a window resize event
-			// now redraw the prompt and line
-			gotResize = false;
-			_prompt.update_screen_columns();
-			// redraw the original prompt with current input
-			dynamicRefresh( _prompt, _data.get(), _data.length(), _pos );
-			continue;
-		}
-#endif
+	if ( c == KEY_SEQUENCE_TIMEOUT ) {
+		return ( flush_key_sequence() );
+	}
 
-		if (c == 0) {
-			return _data.length();
-		}
+	if ( _keySequenceNode != 0 ) {
+		return ( continue_key_sequence( c ) );
+	}
 
-		if (c == -1) {
-			refresh_line();
-			continue;
-		}
+	int id( _keyMap.find( static_cast<char32_t>( c ) ) );
+	if ( ( id != KeyMap::NONE ) && _keyPressHandlers[id - 1]._sequences ) {
+		// wait for the rest of key sequence
+		_keySequenceNode = _keyPressHandlers[id - 1]._sequences;
+		_keySequence.assign( 1, c );
+		_keySequenceDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( _keySequenceTimeout );
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	return ( call_key_press_handler( id, c ) );
+}
 
-		if (c == -2) {
-			_prompt.write();
-			refresh_line();
-			continue;
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::call_key_press_handler( int id_, char32_t c ) {
+	if ( id_ != KeyMap::NONE ) {
+		KeyPressHandler const& handler( _keyPressHandlers[id_ - 1] );
+		if ( handler._action ) {
+			return ( ( this->*handler._action )( c ) );
 		}
-
-		key_press_handlers_t::iterator it( _keyPressHandlers.find( c ) );
-		if ( it != _keyPressHandlers.end() ) {
-			next = it->second( c );
-		} else {
-			next = insert_character( c );
+		if ( handler._handler ) {
+			return ( handler._handler( c ) );
 		}
 	}
-	return ( next == Replxx::ACTION_RESULT::RETURN ? _data.length() : -1 );
+	return ( insert_character( c ) );
+}
+
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::continue_key_sequence( char32_t c ) {
+	int node( _keySequences.child( _keySequenceNode, c ) );
+	if ( node == 0 ) {
+		// no sequence continues with this key, resolve what we got so far
+		Replxx::ACTION_RESULT next( flush_key_sequence() );
+		return ( next == Replxx::ACTION_RESULT::CONTINUE ? process_key( c ) : next );
+	}
+	_keySequence.push_back( c );
+	if ( _keySequences.has_children( node ) ) {
+		_keySequenceNode = node;
+		_keySequenceDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( _keySequenceTimeout );
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	_keySequenceNode = 0;
+	_keySequence.clear();
+	return ( call_key_press_handler( _keySequences.handler( node ), c ) );
+}
+
+// Resolve pending key sequence prefix after timeout or a key that does not continue it.
+// Bound prefix invokes its handler, otherwise keys are replayed as separate key presses.
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::flush_key_sequence( void ) {
+	if ( _keySequenceNode == 0 ) {
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	Replxx::key_sequence_t keys;
+	keys.swap( _keySequence );
+	int id( _keySequences.handler( _keySequenceNode ) );
+	_keySequenceNode = 0;
+	if ( id != KeyMap::NONE ) {
+		return ( call_key_press_handler( id, keys.back() ) );
+	}
+	Replxx::ACTION_RESULT next( call_key_press_handler( _keyMap.find( keys.front() ), keys.front() ) );
+	for ( size_t i( 1 ); ( i < keys.size() ) && ( next == Replxx::ACTION_RESULT::CONTINUE ); ++ i ) {
+		next = process_key( static_cast<int>( keys[i] ) );
+	}
+	return ( next );
+}
+
+// Milliseconds left until pending key sequence prefix times out, -1 if there is no deadline.
+int long Replxx::ReplxxImpl::key_sequence_time_left( void ) const {
+	if ( ( _keySequenceNode == 0 ) || ( _keySequenceTimeout == 0 ) ) {
+		return ( -1 );
+	}
+	int long left(
+		static_cast<int long>(
+			std::chrono::duration_cast<std::chrono::milliseconds>( _keySequenceDeadline - std::chrono::steady_clock::now() ).count()
+		)
+	);
+	return ( left > 0 ? left : 0 );
 }
 
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::insert_character( char32_t c ) {
@@ -1016,13 +1803,13 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::insert_character( char32_t c ) {
 	 * don't insert control characters
 	 */
 	if ( ( c >= static_cast<int>( Replxx::KEY::BASE ) ) || is_control_code( c ) ) {
-		beep();
+		_terminal.beep();
 		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
-	_data.insert( _pos, c );
+	insert_text( _pos, &c, 1, _pos );
 	++ _pos;
 	_prefix = _pos;
-	int inputLen = calculate_displayed_length( _data.get(), _data.length() );
+	int inputLen = calculate_displayed_length( _data, _data.length() );
 	if ( _noColor
 		|| ( ! ( !! _highlighterCallback || !! _hintCallback )
 			&& ( _prompt._indentation + inputLen < _prompt.screen_columns() )
@@ -1121,8 +1908,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_word_to_left( char32_t ) {
 			-- _pos;
 		}
 		_prefix = _pos;
-		_killRing.kill( _data.get() + _pos, startingPos - _pos, false);
-		_data.erase( _pos, startingPos - _pos );
+		_killRing.kill( _data.get( _pos, startingPos - _pos ), startingPos - _pos, false );
+		erase_text( _pos, startingPos - _pos, startingPos );
 		refresh_line();
 	}
 	_killRing.lastAction = KillRing::actionKill;
@@ -1141,8 +1928,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_word_to_right( char32_t ) {
 			++ endingPos;
 		}
 		_prefix = _pos;
-		_killRing.kill( _data.get() + _pos, endingPos - _pos, true );
-		_data.erase( _pos, endingPos - _pos );
+		_killRing.kill( _data.get( _pos, endingPos - _pos ), endingPos - _pos, true );
+		erase_text( _pos, endingPos - _pos, _pos );
 		refresh_line();
 	}
 	_killRing.lastAction = KillRing::actionKill;
@@ -1161,8 +1948,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_whitespace_to_left( char32_t )
 			-- _pos;
 		}
 		_prefix = _pos;
-		_killRing.kill( _data.get() + _pos, startingPos - _pos, false );
-		_data.erase( _pos, startingPos - _pos );
+		_killRing.kill( _data.get( _pos, startingPos - _pos ), startingPos - _pos, false );
+		erase_text( _pos, startingPos - _pos, startingPos );
 		refresh_line();
 	}
 	_killRing.lastAction = KillRing::actionKill;
@@ -1171,8 +1958,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_whitespace_to_left( char32_t )
 
 // ctrl-K, kill from cursor to end of line
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_end_of_line( char32_t ) {
-	_killRing.kill( _data.get() + _pos, _data.length() - _pos, true );
-	_data.erase( _pos, _data.length() - _pos );
+	_killRing.kill( _data.get( _pos, _data.length() - _pos ), _data.length() - _pos, true );
+	erase_text( _pos, _data.length() - _pos, _pos );
 	refresh_line();
 	_killRing.lastAction = KillRing::actionKill;
 	_history.reset_recall_most_recent();
@@ -1183,8 +1970,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_end_of_line( char32_t ) {
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_begining_of_line( char32_t ) {
 	if (_pos > 0) {
 		_history.reset_recall_most_recent();
-		_killRing.kill( _data.get(), _pos, false );
-		_data.erase( 0, _pos );
+		_killRing.kill( _data.get( 0, _pos ), _pos, false );
+		erase_text( 0, _pos, _pos );
 		_prefix = _pos = 0;
 		refresh_line();
 	}
@@ -1195,16 +1982,16 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::kill_to_begining_of_line( char32_t ) {
 // ctrl-Y, yank killed text
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::yank( char32_t ) {
 	_history.reset_recall_most_recent();
-	UnicodeString* restoredText( _killRing.yank() );
+	KillRing::Text const* restoredText( _killRing.yank() );
 	if ( restoredText ) {
-		_data.insert( _pos, *restoredText, 0, restoredText->length() );
+		insert_text( _pos, restoredText->get(), restoredText->length(), _pos );
 		_pos += restoredText->length();
 		_prefix = _pos;
 		refresh_line();
 		_killRing.lastAction = KillRing::actionYank;
 		_killRing.lastYankSize = restoredText->length();
 	} else {
-		beep();
+		_terminal.beep();
 	}
 	return ( Replxx::ACTION_RESULT::CONTINUE );
 }
@@ -1212,18 +1999,19 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::yank( char32_t ) {
 // meta-Y, "yank-pop", rotate popped text
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::yank_cycle( char32_t ) {
 	if ( _killRing.lastAction != KillRing::actionYank ) {
-		beep();
+		_terminal.beep();
 		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
 	_history.reset_recall_most_recent();
-	UnicodeString* restoredText = _killRing.yankPop();
+	KillRing::Text const* restoredText( _killRing.yankPop() );
 	if ( !restoredText ) {
-		beep();
+		_terminal.beep();
 		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
+	int cursor( _pos );
 	_pos -= _killRing.lastYankSize;
-	_data.erase( _pos, _killRing.lastYankSize );
-	_data.insert( _pos, *restoredText, 0, restoredText->length() );
+	erase_text( _pos, _killRing.lastYankSize, cursor );
+	insert_text( _pos, restoredText->get(), restoredText->length(), cursor, true );
 	_pos += restoredText->length();
 	_prefix = _pos;
 	_killRing.lastYankSize = restoredText->length();
@@ -1236,21 +2024,25 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::capitalize_word( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	_history.reset_recall_most_recent();
 	if (_pos < _data.length()) {
+		int cursor( _pos );
 		while ( _pos < _data.length() && is_word_break_character( _data[_pos] ) ) {
 			++_pos;
 		}
+		int start( _pos );
+		UnicodeString before( word_at_cursor() );
 		if (_pos < _data.length() && !is_word_break_character( _data[_pos] ) ) {
 			if ( _data[_pos] >= 'a' && _data[_pos] <= 'z' ) {
-				_data[_pos] += 'A' - 'a';
+				_data.set( _pos, _data[_pos] + 'A' - 'a' );
 			}
 			++_pos;
 		}
 		while (_pos < _data.length() && !is_word_break_character( _data[_pos] ) ) {
 			if ( _data[_pos] >= 'A' && _data[_pos] <= 'Z' ) {
-				_data[_pos] += 'a' - 'A';
+				_data.set( _pos, _data[_pos] + 'a' - 'A' );
 			}
 			++_pos;
 		}
+		record_modification( start, before, cursor );
 		_prefix = _pos;
 		refresh_line();
 	}
@@ -1262,15 +2054,19 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::lowercase_word( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	if (_pos < _data.length()) {
 		_history.reset_recall_most_recent();
+		int cursor( _pos );
 		while ( _pos < _data.length() && is_word_break_character( _data[_pos] ) ) {
 			++ _pos;
 		}
+		int start( _pos );
+		UnicodeString before( word_at_cursor() );
 		while (_pos < _data.length() && !is_word_break_character( _data[_pos] ) ) {
 			if ( _data[_pos] >= 'A' && _data[_pos] <= 'Z' ) {
-				_data[_pos] += 'a' - 'A';
+				_data.set( _pos, _data[_pos] + 'a' - 'A' );
 			}
 			++ _pos;
 		}
+		record_modification( start, before, cursor );
 		_prefix = _pos;
 		refresh_line();
 	}
@@ -1282,15 +2078,19 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::uppercase_word( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	if (_pos < _data.length()) {
 		_history.reset_recall_most_recent();
+		int cursor( _pos );
 		while ( _pos < _data.length() && is_word_break_character( _data[_pos] ) ) {
 			++ _pos;
 		}
+		int start( _pos );
+		UnicodeString before( word_at_cursor() );
 		while ( _pos < _data.length() && !is_word_break_character( _data[_pos] ) ) {
 			if ( _data[_pos] >= 'a' && _data[_pos] <= 'z') {
-				_data[_pos] += 'A' - 'a';
+				_data.set( _pos, _data[_pos] + 'A' - 'a' );
 			}
 			++ _pos;
 		}
+		record_modification( start, before, cursor );
 		_prefix = _pos;
 		refresh_line();
 	}
@@ -1302,10 +2102,12 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::transpose_characters( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	if ( _pos > 0 && _data.length() > 1 ) {
 		_history.reset_recall_most_recent();
-		size_t leftCharPos = ( _pos == _data.length() ) ? _pos - 2 : _pos - 1;
+		int leftCharPos = ( _pos == _data.length() ) ? _pos - 2 : _pos - 1;
+		UnicodeString before( _data.get( leftCharPos, 2 ), 2 );
 		char32_t aux = _data[leftCharPos];
-		_data[leftCharPos] = _data[leftCharPos + 1];
-		_data[leftCharPos + 1] = aux;
+		_data.set( leftCharPos, _data[leftCharPos + 1] );
+		_data.set( leftCharPos + 1, aux );
+		record_modification( leftCharPos, before, _pos );
 		if ( _pos != _data.length() ) {
 			++_pos;
 		}
@@ -1315,6 +2117,32 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::transpose_characters( char32_t ) {
 	return ( Replxx::ACTION_RESULT::CONTINUE );
 }
 
+// ctrl-_, undo last change
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::undo( char32_t ) {
+	_killRing.lastAction = KillRing::actionOther;
+	if ( ! _undo.undo( _data, _pos ) ) {
+		_terminal.beep();
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	_history.reset_recall_most_recent();
+	_prefix = _pos;
+	refresh_line();
+	return ( Replxx::ACTION_RESULT::CONTINUE );
+}
+
+// meta-_, redo last undone change
+Replxx::ACTION_RESULT Replxx::ReplxxImpl::redo( char32_t ) {
+	_killRing.lastAction = KillRing::actionOther;
+	if ( ! _undo.redo( _data, _pos ) ) {
+		_terminal.beep();
+		return ( Replxx::ACTION_RESULT::CONTINUE );
+	}
+	_history.reset_recall_most_recent();
+	_prefix = _pos;
+	refresh_line();
+	return ( Replxx::ACTION_RESULT::CONTINUE );
+}
+
 // ctrl-C, abort this line
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::abort_line( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
@@ -1334,7 +2162,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::delete_character( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	if ( ( _data.length() > 0 ) && ( _pos < _data.length() ) ) {
 		_history.reset_recall_most_recent();
-		_data.erase( _pos );
+		erase_text( _pos, 1, _pos );
 		refresh_line();
 	}
 	return ( Replxx::ACTION_RESULT::CONTINUE );
@@ -1355,9 +2183,9 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::backspace_character( char32_t ) {
 	_killRing.lastAction = KillRing::actionOther;
 	if ( _pos > 0 ) {
 		_history.reset_recall_most_recent();
+		erase_text( _pos - 1, 1, _pos );
 		-- _pos;
 		_prefix = _pos;
-		_data.erase( _pos );
 		refresh_line();
 	}
 	return ( Replxx::ACTION_RESULT::CONTINUE );
@@ -1392,8 +2220,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::history_move( bool previous_ ) {
 	// we don't
 	// have to special case it
 	if ( _history.is_last() ) {
-		_utf8Buffer.assign( _data );
-		_history.update_last( _utf8Buffer.get() );
+		_history.update_last( _data.utf8() );
 	}
 	if ( _history.is_empty() ) {
 		return ( Replxx::ACTION_RESULT::CONTINUE );
@@ -1401,7 +2228,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::history_move( bool previous_ ) {
 	if ( ! _history.move( previous_ ) ) {
 		return ( Replxx::ACTION_RESULT::CONTINUE );
 	}
-	_data.assign( _history.current() );
+	replace_line( UnicodeString( _history.current() ) );
 	_prefix = _pos = _data.length();
 	refresh_line();
 	return ( Replxx::ACTION_RESULT::CONTINUE );
@@ -1425,12 +2252,11 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::history_jump( bool back_ ) {
 	// we don't
 	// have to special case it
 	if ( _history.is_last() ) {
-		_utf8Buffer.assign( _data );
-		_history.update_last( _utf8Buffer.get() );
+		_history.update_last( _data.utf8() );
 	}
 	if ( ! _history.is_empty() ) {
 		_history.jump( back_ );
-		_data.assign( _history.current().c_str() );
+		replace_line( UnicodeString( _history.current() ) );
 		_prefix = _pos = _data.length();
 		refresh_line();
 	}
@@ -1472,7 +2298,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::suspend( char32_t ) {
 #endif
 
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::complete_line( char32_t c ) {
-	if ( !! _completionCallback && ( _completeOnEmpty || ( _pos > 0 ) ) ) {
+	if ( ( !! _completionCallback || _completionIndex || !! _asyncCompletionCallback ) && ( _completeOnEmpty || ( _pos > 0 ) ) ) {
 		_killRing.lastAction = KillRing::actionOther;
 		_history.reset_recall_most_recent();
 
@@ -1497,14 +2323,13 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::complete_line( char32_t c ) {
 // Alt-N, forward history search for prefix
 Replxx::ACTION_RESULT Replxx::ReplxxImpl::common_prefix_search( char32_t startChar ) {
 	_killRing.lastAction = KillRing::actionOther;
-	_utf8Buffer.assign( _data );
-	int prefixSize( calculate_displayed_length( _data.get(), _prefix ) );
+	int prefixSize( calculate_displayed_length( _data, _prefix ) );
 	if (
 		_history.common_prefix_search(
-			_utf8Buffer.get(), prefixSize, ( startChar == ( Replxx::KEY::meta( 'p' ) ) ) || ( startChar == ( Replxx::KEY::meta( 'P' ) ) )
+			_data.utf8(), prefixSize, ( startChar == ( Replxx::KEY::meta( 'p' ) ) ) || ( startChar == ( Replxx::KEY::meta( 'P' ) ) )
 		)
 	) {
-		_data.assign( _history.current() );
+		replace_line( UnicodeString( _history.current() ) );
 		_pos = _data.length();
 		refresh_line();
 	}
@@ -1525,8 +2350,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 	// if not already recalling, add the current line to the history list so we
 	// don't have to special case it
 	if ( _history.is_last() ) {
-		_utf8Buffer.assign( _data );
-		_history.update_last( _utf8Buffer.get() );
+		_history.update_last( _data.utf8() );
 	}
 	int historyLinePosition( _pos );
 	clear_self_to_end_of_screen();
@@ -1605,8 +2429,8 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 			case Replxx::KEY::control('S'):
 			case Replxx::KEY::control('R'):
 				if ( dp._searchText.length() == 0 ) { // if no current search text, recall previous text
-					if ( previousSearchText.length() > 0 ) {
-						dp._searchText = previousSearchText;
+					if ( _previousSearchText.length() > 0 ) {
+						dp._searchText = _previousSearchText;
 					}
 				}
 				if ((dp._direction == 1 && c == Replxx::KEY::control('R')) ||
@@ -1637,7 +2461,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 					dp.updateSearchPrompt();
 					_history.reset_pos( dp._direction == -1 ? _history.size() - 1 : 0 );
 				} else {
-					beep();
+					_terminal.beep();
 				}
 				break;
 
@@ -1649,7 +2473,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 					dp._searchText.insert( dp._searchText.length(), c );
 					dp.updateSearchPrompt();
 				} else {
-					beep();
+					_terminal.beep();
 				}
 			}
 		} // switch
@@ -1684,7 +2508,7 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 					activeHistoryLine.assign( _history[historySearchIndex] );
 					lineSearchPos = ( dp._direction > 0 ) ? 0 : ( activeHistoryLine.length() - dp._searchText.length() );
 				} else {
-					beep();
+					_terminal.beep();
 					break;
 				}
 			} // while
@@ -1709,13 +2533,13 @@ Replxx::ACTION_RESULT Replxx::ReplxxImpl::incremental_history_search( char32_t s
 	pb._previousLen = dp._characterCount;
 	if ( useSearchedLine && ( activeHistoryLine.length() > 0 ) ) {
 		_history.set_recall_most_recent();
-		_data.assign( activeHistoryLine );
+		replace_line( activeHistoryLine );
 		_prefix = _pos = historyLinePosition;
 	}
 	dynamicRefresh(pb, _data.get(), _data.length(), _pos); // redraw the original prompt with current input
 	_prompt._previousInputLen = _data.length();
 	_prompt._cursorRowOffset = _prompt._extraLines + pb._cursorRowOffset;
-	previousSearchText = dp._searchText; // save search text for possible reuse on ctrl-R ctrl-R
+	_previousSearchText = dp._searchText; // save search text for possible reuse on ctrl-R ctrl-R
 	emulate_key_press( c ); // pass a character or -1 back to main loop
 	return ( Replxx::ACTION_RESULT::CONTINUE );
 }
@@ -1765,15 +2589,56 @@ std::string const& Replxx::ReplxxImpl::history_line( int index ) {
 	return ( _history[index] );
 }
 
+namespace {
+void completion_adapter( Replxx::completion_callback_t const& fn_, Replxx::StringView input_, int& contextLen_, Replxx::Candidates& completions_ ) {
+	for ( std::string const& c : fn_( input_.str(), contextLen_ ) ) {
+		completions_.add( c );
+	}
+}
+
+void highlighter_adapter( Replxx::highlighter_callback_t const& fn_, Replxx::StringView input_, Replxx::colors_t& colors_ ) {
+	fn_( input_.str(), colors_ );
+}
+
+void hint_adapter( Replxx::hint_callback_t const& fn_, Replxx::StringView input_, int& contextLen_, Replxx::Color& color_, Replxx::Candidates& hints_ ) {
+	for ( std::string const& h : fn_( input_.str(), contextLen_, color_ ) ) {
+		hints_.add( h );
+	}
+}
+}
+
 void Replxx::ReplxxImpl::set_completion_callback( Replxx::completion_callback_t const& fn ) {
-	_completionCallback = fn;
+	_completionCallback = !! fn ? Replxx::completion_view_callback_t( std::bind( &completion_adapter, fn, _1, _2, _3 ) ) : nullptr;
+	_completionCache.invalidate();
 }
 
 void Replxx::ReplxxImpl::set_highlighter_callback( Replxx::highlighter_callback_t const& fn ) {
-	_highlighterCallback = fn;
+	_highlighterCallback = !! fn ? Replxx::highlighter_view_callback_t( std::bind( &highlighter_adapter, fn, _1, _2 ) ) : nullptr;
 }
 
 void Replxx::ReplxxImpl::set_hint_callback( Replxx::hint_callback_t const& fn ) {
+	_hintCallback = !! fn ? Replxx::hint_view_callback_t( std::bind( &hint_adapter, fn, _1, _2, _3, _4 ) ) : nullptr;
+}
+
+void Replxx::ReplxxImpl::set_completion_view_callback( Replxx::completion_view_callback_t const& fn ) {
+	_completionCallback = fn;
+	_completionCache.invalidate();
+}
+
+void Replxx::ReplxxImpl::set_completion_index( Replxx::CompletionIndex const* index ) {
+	_completionIndex = index;
+}
+
+void Replxx::ReplxxImpl::set_async_completion_callback( Replxx::async_completion_callback_t const& fn ) {
+	_asyncCompletionCallback = fn;
+	_completionCache.invalidate();
+}
+
+void Replxx::ReplxxImpl::set_highlighter_view_callback( Replxx::highlighter_view_callback_t const& fn ) {
+	_highlighterCallback = fn;
+}
+
+void Replxx::ReplxxImpl::set_hint_view_callback( Replxx::hint_view_callback_t const& fn ) {
 	_hintCallback = fn;
 }
 
@@ -1781,16 +2646,73 @@ void Replxx::ReplxxImpl::set_max_history_size( int len ) {
 	_history.set_max_size( len );
 }
 
+void Replxx::ReplxxImpl::set_max_undo_size( int bytes ) {
+	_undo.set_max_size( bytes );
+}
+
+void Replxx::ReplxxImpl::set_max_kill_ring_size( int count ) {
+	_killRing.set_max_size( count );
+}
+
+void Replxx::ReplxxImpl::set_max_kill_ring_bytes( int bytes ) {
+	_killRing.set_max_bytes( bytes );
+}
+
+void Replxx::ReplxxImpl::set_kill_ring_clipboard( bool val ) {
+	_killRing.set_clipboard( val );
+}
+
 void Replxx::ReplxxImpl::set_completion_count_cutoff( int count ) {
 	_completionCountCutoff = count;
 }
 
+void Replxx::ReplxxImpl::set_completion_cache_ttl( int milliseconds ) {
+	_completionCacheTtl = milliseconds;
+	if ( milliseconds == 0 ) {
+		_completionCache.clear();
+	}
+}
+
+void Replxx::ReplxxImpl::set_completion_menu( int rows ) {
+	_completionMenuRows = rows > 0 ? rows : 0;
+}
+
+void Replxx::ReplxxImpl::set_fuzzy_completion( int maxResults ) {
+	_fuzzyCompletion = maxResults > 0 ? maxResults : 0;
+}
+
+void Replxx::ReplxxImpl::invalidate_completion_cache( void ) {
+	_completionCache.invalidate();
+}
+
+void Replxx::ReplxxImpl::set_latency_instrumentation( bool val ) {
+	_latencyInstrumentation = val;
+	_terminal.set_latency( latency() );
+}
+
+Replxx::LatencyHistogram Replxx::ReplxxImpl::latency_histogram( Replxx::LATENCY_PHASE phase ) const {
+	return ( _latency.snapshot( phase ) );
+}
+
+void Replxx::ReplxxImpl::reset_latency_histograms( void ) {
+	_latency.reset();
+}
+
+std::string Replxx::ReplxxImpl::latency_report( void ) const {
+	return ( _latency.report() );
+}
+
+void Replxx::ReplxxImpl::set_latency_report_file( std::string const& filename ) {
+	_latencyReportFile = filename;
+}
+
 void Replxx::ReplxxImpl::set_max_hint_rows( int count ) {
 	_maxHintRows = count;
 }
 
 void Replxx::ReplxxImpl::set_word_break_characters( char const* wordBreakers ) {
 	_breakChars = wordBreakers;
+	_completionCache.invalidate();
 }
 
 void Replxx::ReplxxImpl::set_double_tab_completion( bool val ) {
@@ -1805,6 +2727,26 @@ void Replxx::ReplxxImpl::set_beep_on_ambiguous_completion( bool val ) {
 	_beepOnAmbiguousCompletion = val;
 }
 
+void Replxx::ReplxxImpl::set_callback_budget( Replxx::BUDGETED_CALLBACK callback_, int microseconds_ ) {
+	( callback_ == Replxx::BUDGETED_CALLBACK::HIGHLIGHTER ? _highlighterBudget : _hintBudget ).set( microseconds_ );
+}
+
+void Replxx::ReplxxImpl::set_callback_idle_period( int milliseconds_ ) {
+	_callbackIdlePeriod = milliseconds_ > 0 ? milliseconds_ : 0;
+}
+
+void Replxx::ReplxxImpl::set_callback_budget_handler( Replxx::callback_budget_handler_t const& handler_ ) {
+	_callbackBudgetHandler = handler_;
+}
+
+Replxx::CALLBACK_DEGRADATION Replxx::ReplxxImpl::callback_degradation( Replxx::BUDGETED_CALLBACK callback_ ) const {
+	return ( ( callback_ == Replxx::BUDGETED_CALLBACK::HIGHLIGHTER ? _highlighterBudget : _hintBudget ).degradation() );
+}
+
+void Replxx::ReplxxImpl::set_max_redraw_rate( int rate ) {
+	_minRedrawInterval = rate > 0 ? 1000 / rate : 0;
+}
+
 void Replxx::ReplxxImpl::set_no_color( bool val ) {
 	_noColor = val;
 }
@@ -1825,7 +2767,7 @@ void Replxx::ReplxxImpl::clear_self_to_end_of_screen( void ) {
  * @param len   count of characters in the buffer
  * @param pos   current cursor position within the buffer (0 <= pos <= len)
  */
-void Replxx::ReplxxImpl::dynamicRefresh(Prompt& pi, char32_t* buf32, int len, int pos) {
+void Replxx::ReplxxImpl::dynamicRefresh(Prompt& pi, char32_t const* buf32, int len, int pos) {
 	clear_self_to_end_of_screen();
 	// calculate the position of the end of the prompt
 	int xEndOfPrompt, yEndOfPrompt;
@@ -38,70 +38,141 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <chrono>
+#include <atomic>
 
 #include "replxx.hxx"
 #include "history.hxx"
 #include "killring.hxx"
+#include "undolog.hxx"
 #include "utf8string.hxx"
+#include "editbuffer.hxx"
+#include "candidates.hxx"
 #include "prompt.hxx"
 #include "io.hxx"
+#include "messagequeue.hxx"
+#include "keymap.hxx"
+#include "completioncache.hxx"
+#include "completionrequest.hxx"
+#include "completionmenu.hxx"
+#include "fuzzymatcher.hxx"
+#include "latency.hxx"
+#include "callbackbudget.hxx"
 
 namespace replxx {
 
 class Replxx::ReplxxImpl {
 public:
-	typedef std::vector<UnicodeString> completions_t;
-	typedef std::vector<UnicodeString> hints_t;
+	typedef CandidateList completions_t;
+	typedef CandidateList hints_t;
 	typedef std::unique_ptr<char[]> utf8_buffer_t;
 	typedef std::unique_ptr<char32_t[]> input_buffer_t;
 	typedef std::vector<char> char_widths_t;
 	typedef std::vector<char32_t> display_t;
 	typedef std::deque<char32_t> key_presses_t;
-	typedef std::deque<std::string> messages_t;
 	enum class HINT_ACTION {
 		REGENERATE,
 		REPAINT,
 		TRIM,
 		SKIP
 	};
-	typedef std::unordered_map<int, Replxx::key_press_handler_t> key_press_handlers_t;
+	typedef Replxx::ACTION_RESULT ( ReplxxImpl::* key_press_handler_raw_t )( char32_t );
+	struct KeyPressHandler {
+		key_press_handler_raw_t _action;      // built-in action, called directly
+		Replxx::key_press_handler_t _handler; // user defined handler, used if _action is not set
+		int _sequences;                       // trie node of key sequences starting with this key, 0 if none
+	};
+	typedef std::deque<KeyPressHandler> key_press_handlers_t; // deque: handler may bind keys while being called
+	static int const KEY_SEQUENCE_TIMEOUT = -4;
 private:
 	Utf8String     _utf8Buffer;
-	UnicodeString  _data;
+	EditBuffer     _data;
 	char_widths_t  _charWidths; // character widths from mk_wcwidth()
 	display_t      _display;
 	int _displayInputLength;
+	display_t      _listing;       // page of completion listing, written to terminal at once
+	std::vector<int> _listingWidths; // screen widths of listed completions
 	UnicodeString  _hint;
+	hints_t        _hints; // last hints returned by user callback
+	completions_t  _completions; // last completions returned by user callback or cache
 	int _pos;    // character position in buffer ( 0 <= _pos <= _len )
 	int _prefix; // prefix length used in common prefix search
 	int _hintSelection; // Currently selected hint.
 	History _history;
 	KillRing _killRing;
+	UndoLog _undo;
 	int _maxHintRows;
 	char const* _breakChars;
 	int _completionCountCutoff;
 	bool _doubleTabCompletion;
 	bool _completeOnEmpty;
 	bool _beepOnAmbiguousCompletion;
+	CompletionCache _completionCache;
+	int _completionCacheTtl; // in milliseconds, 0 disables cache, negative means no expiry
+	CompletionMenu _completionMenu;
+	int _completionMenuRows; // 0 disables interactive completion menu
+	FuzzyMatcher _fuzzyMatcher;
+	int _fuzzyCompletion; // number of best fuzzy matches kept, 0 disables fuzzy matching
+	Latency _latency;
+	bool _latencyInstrumentation;
+	std::string _latencyReportFile; // written on destruction if set
+	CallbackBudget _highlighterBudget;
+	CallbackBudget _hintBudget;
+	Replxx::callback_budget_handler_t _callbackBudgetHandler;
+	int long _callbackIdlePeriod; // in milliseconds
+	bool _callbacksDeferred;      // a debounced callback was skipped since last idle refresh
+	bool _idleRefresh;            // refresh after idle period, debounced callbacks are called
+	std::chrono::steady_clock::time_point _callbacksDeferredAt;
 	bool _noColor;
+	KeyMap _keyMap; // key code -> 1-based index in _keyPressHandlers
 	key_press_handlers_t _keyPressHandlers;
+	KeySequenceTrie _keySequences;
+	Replxx::key_sequence_t _keySequence; // keys of pending key sequence prefix
+	int _keySequenceNode;                // trie node of pending key sequence prefix, 0 if none
+	int _keySequenceTimeout;             // in milliseconds, 0 means wait indefinitely
+	std::chrono::steady_clock::time_point _keySequenceDeadline;
 	Terminal _terminal;
+	int _resizeGeneration;              // SIGWINCH generation this instance has redrawn for
+	std::atomic<bool> _windowChanged;   // set by window_changed(), possibly from other thread
+	UnicodeString _previousSearchText;  // remembered across invocations of input()
 	std::thread::id _currentThread;
 	Prompt _prompt;
-	Replxx::completion_callback_t _completionCallback;
-	Replxx::highlighter_callback_t _highlighterCallback;
-	Replxx::hint_callback_t _hintCallback;
+	Replxx::completion_view_callback_t _completionCallback; // std::string based callbacks are wrapped
+	Replxx::CompletionIndex const* _completionIndex; // used instead of _completionCallback if set
+	Replxx::async_completion_callback_t _asyncCompletionCallback; // used instead of _completionCallback if set
+	AsyncCompletionRequest* _completionRequest; // pending asynchronous request, its candidates are shown as hints
+	Replxx::highlighter_view_callback_t _highlighterCallback;
+	Replxx::hint_view_callback_t _hintCallback;
 	key_presses_t _keyPresses;
-	messages_t _messages;
+	MessageQueue _messages; // printed from other threads
+	std::string _messageBuffer;
+	std::string _clipboardBuffer;
+	int long _minRedrawInterval; // in milliseconds
+	std::chrono::steady_clock::time_point _lastMessagesRedraw;
 	std::string _preloadedBuffer; // used with set_preload_buffer
 	std::string _errorMessage;
 	mutable std::mutex _mutex;
 public:
 	ReplxxImpl( FILE*, FILE*, FILE* );
+	~ReplxxImpl( void );
 	void set_completion_callback( Replxx::completion_callback_t const& fn );
 	void set_highlighter_callback( Replxx::highlighter_callback_t const& fn );
 	void set_hint_callback( Replxx::hint_callback_t const& fn );
+	void set_completion_view_callback( Replxx::completion_view_callback_t const& fn );
+	void set_highlighter_view_callback( Replxx::highlighter_view_callback_t const& fn );
+	void set_hint_view_callback( Replxx::hint_view_callback_t const& fn );
+	void set_completion_index( Replxx::CompletionIndex const* index );
+	void set_async_completion_callback( Replxx::async_completion_callback_t const& fn );
 	char const* input( std::string const& prompt );
+	bool start_input( std::string const& prompt );
+	Replxx::INPUT_STATUS process_input( char const*& );
+	int set_terminal( Replxx::TerminalBackend* );
+	int set_terminal_fds( int, int );
+	void window_changed( void );
+	int set_session_recording( std::string const& );
+	int input_fd( void ) const;
+	int event_fd( void ) const;
+	int next_timeout( void ) const;
 	void history_add( std::string const& line );
 	int history_save( std::string const& filename );
 	int history_load( std::string const& filename );
@@ -114,22 +185,57 @@ public:
 	void set_complete_on_empty( bool val );
 	void set_beep_on_ambiguous_completion( bool val );
 	void set_no_color( bool val );
+	void set_max_redraw_rate( int rate );
+	void set_callback_budget( Replxx::BUDGETED_CALLBACK, int );
+	void set_callback_idle_period( int );
+	void set_callback_budget_handler( Replxx::callback_budget_handler_t const& );
+	Replxx::CALLBACK_DEGRADATION callback_degradation( Replxx::BUDGETED_CALLBACK ) const;
 	void set_max_history_size( int len );
+	void set_max_undo_size( int bytes );
+	void set_max_kill_ring_size( int count );
+	void set_max_kill_ring_bytes( int bytes );
+	void set_kill_ring_clipboard( bool val );
 	void set_completion_count_cutoff( int len );
+	void set_completion_cache_ttl( int milliseconds );
+	void set_completion_menu( int rows );
+	void set_fuzzy_completion( int maxResults );
+	void invalidate_completion_cache( void );
+	void set_latency_instrumentation( bool );
+	Replxx::LatencyHistogram latency_histogram( Replxx::LATENCY_PHASE ) const;
+	void reset_latency_histograms( void );
+	std::string latency_report( void ) const;
+	void set_latency_report_file( std::string const& );
 	int install_window_change_handler( void );
-	completions_t call_completer( std::string const& input, int& ) const;
-	hints_t call_hinter( std::string const& input, int&, Replxx::Color& color ) const;
+	completions_t const& call_completer( std::string const& input, int& );
+	char32_t call_async_completer( std::string const& input, int& );
+	void rank_completions( std::string const& input, int );
+	hints_t const& call_hinter( std::string const& input, int&, Replxx::Color& color );
 	void print( char const*, int );
 	Replxx::ACTION_RESULT clear_screen( char32_t );
 	void emulate_key_press( char32_t );
 	Replxx::ACTION_RESULT invoke( Replxx::ACTION, char32_t );
 	void bind_key( char32_t, Replxx::key_press_handler_t );
+	void bind_key_sequence( Replxx::key_sequence_t const&, Replxx::key_press_handler_t );
+	void set_key_sequence_timeout( int );
 private:
 	ReplxxImpl( ReplxxImpl const& ) = delete;
 	ReplxxImpl& operator = ( ReplxxImpl const& ) = delete;
 private:
+	void bind_action( char32_t, key_press_handler_raw_t );
 	void preload_puffer( char const* preloadText );
-	int get_input_line( void );
+	void insert_text( int, char32_t const*, int, int, bool = false );
+	void erase_text( int, int, int, bool = false );
+	void replace_line( UnicodeString const& );
+	void record_modification( int, UnicodeString const&, int );
+	UnicodeString word_at_cursor( void );
+	bool start_line( std::string const& prompt );
+	Replxx::ACTION_RESULT process_key( int );
+	Replxx::ACTION_RESULT call_key_press_handler( int, char32_t );
+	Replxx::ACTION_RESULT continue_key_sequence( char32_t );
+	Replxx::ACTION_RESULT flush_key_sequence( void );
+	int long key_sequence_time_left( void ) const;
+	char const* finish_line( Replxx::ACTION_RESULT );
+	void print_error_message( void );
 	Replxx::ACTION_RESULT insert_character( char32_t );
 	Replxx::ACTION_RESULT go_to_begining_of_line( char32_t );
 	Replxx::ACTION_RESULT go_to_end_of_line( char32_t );
@@ -148,6 +254,8 @@ private:
 	Replxx::ACTION_RESULT lowercase_word( char32_t );
 	Replxx::ACTION_RESULT uppercase_word( char32_t );
 	Replxx::ACTION_RESULT transpose_characters( char32_t );
+	Replxx::ACTION_RESULT undo( char32_t );
+	Replxx::ACTION_RESULT redo( char32_t );
 	Replxx::ACTION_RESULT abort_line( char32_t );
 	Replxx::ACTION_RESULT send_eof( char32_t );
 	Replxx::ACTION_RESULT delete_character( char32_t );
@@ -168,9 +276,23 @@ private:
 	Replxx::ACTION_RESULT complete_line( char32_t );
 	Replxx::ACTION_RESULT incremental_history_search( char32_t startChar );
 	Replxx::ACTION_RESULT common_prefix_search( char32_t startChar );
-	char32_t read_char( void );
+	char32_t read_char( bool = true, bool = false );
+	void flush_messages( void );
+	void flush_clipboard( void );
+	int long time_to_redraw( void ) const;
+	int long time_to_idle( void ) const;
+	bool typeahead( void );
+	bool take_resize( void );
+	void redraw_after_resize( void );
+	bool callback_allowed( CallbackBudget const& );
+	void callback_finished( Replxx::BUDGETED_CALLBACK, CallbackBudget&, CallbackBudget::clock_t::time_point );
+	Latency* latency( void ) {
+		return ( _latencyInstrumentation ? &_latency : nullptr );
+	}
 	char const* read_from_stdin( void );
 	char32_t do_complete_line( void );
+	char32_t completion_menu( int );
+	void render_completion_menu( void );
 	void refresh_line( HINT_ACTION = HINT_ACTION::REGENERATE );
 	void highlight( HINT_ACTION );
 	int handle_hints( HINT_ACTION );
@@ -178,7 +300,7 @@ private:
 	int context_length( void );
 	void clear();
 	bool is_word_break_character( char32_t ) const;
-	void dynamicRefresh(Prompt& pi, char32_t* buf32, int len, int pos);
+	void dynamicRefresh(Prompt& pi, char32_t const* buf32, int len, int pos);
 	char const* finalize_input( char const* );
 	void clear_self_to_end_of_screen( void );
 	typedef struct {
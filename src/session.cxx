@@ -0,0 +1,142 @@
+#include <cstring>
+
+#include "session.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+char const MAGIC[] = "replxx-session 1\n";
+int const MAGIC_SIZE = static_cast<int>( sizeof ( MAGIC ) - 1 );
+
+}
+
+SessionRecorder::SessionRecorder( void )
+	: _file()
+	, _last()
+	, _columns( -1 )
+	, _rows( -1 ) {
+}
+
+int SessionRecorder::open( std::string const& filename ) {
+	close();
+	_file.open( filename, ios::binary | ios::trunc );
+	if ( ! _file ) {
+		return ( -1 );
+	}
+	_file.write( MAGIC, MAGIC_SIZE );
+	_last = clock_t::now();
+	_columns = _rows = -1;
+	return ( 0 );
+}
+
+void SessionRecorder::close( void ) {
+	if ( _file.is_open() ) {
+		_file.close();
+	}
+}
+
+void SessionRecorder::input( char const* data_, int size_ ) {
+	if ( ! _file.is_open() || ( size_ <= 0 ) ) {
+		return;
+	}
+	header( 'i' );
+	varint( static_cast<uint64_t>( size_ ) );
+	_file.write( data_, size_ );
+	// keep complete lines on disk in case the application never closes the recording
+	if ( memchr( data_, '\r', static_cast<size_t>( size_ ) ) || memchr( data_, '\n', static_cast<size_t>( size_ ) ) ) {
+		_file.flush();
+	}
+}
+
+void SessionRecorder::resize( int columns_, int rows_ ) {
+	if ( ! _file.is_open() || ( ( columns_ == _columns ) && ( rows_ == _rows ) ) ) {
+		return;
+	}
+	_columns = columns_;
+	_rows = rows_;
+	header( 'r' );
+	varint( static_cast<uint64_t>( columns_ ) );
+	varint( static_cast<uint64_t>( rows_ ) );
+}
+
+void SessionRecorder::header( char type_ ) {
+	clock_t::time_point now( clock_t::now() );
+	_file.put( type_ );
+	varint( static_cast<uint64_t>( chrono::duration_cast<chrono::microseconds>( now - _last ).count() ) );
+	_last = now;
+}
+
+void SessionRecorder::varint( uint64_t value_ ) {
+	while ( value_ >= 0x80 ) {
+		_file.put( static_cast<char>( ( value_ & 0x7f ) | 0x80 ) );
+		value_ >>= 7;
+	}
+	_file.put( static_cast<char>( value_ ) );
+}
+
+SessionReader::SessionReader( void )
+	: _file() {
+}
+
+int SessionReader::open( std::string const& filename ) {
+	_file.open( filename, ios::binary );
+	if ( ! _file ) {
+		return ( -1 );
+	}
+	char magic[MAGIC_SIZE];
+	if ( ! _file.read( magic, MAGIC_SIZE ) || ( memcmp( magic, MAGIC, MAGIC_SIZE ) != 0 ) ) {
+		_file.close();
+		return ( -1 );
+	}
+	return ( 0 );
+}
+
+bool SessionReader::next( Event& event_ ) {
+	char type( 0 );
+	uint64_t delay( 0 );
+	if ( ! _file.get( type ) || ! varint( delay ) ) {
+		return ( false );
+	}
+	event_.delay = static_cast<int long long>( delay );
+	uint64_t a( 0 );
+	uint64_t b( 0 );
+	if ( type == 'i' ) {
+		if ( ! varint( a ) || ( a > 0xffff ) ) {
+			return ( false );
+		}
+		event_.type = Event::TYPE::INPUT;
+		event_.data.resize( static_cast<size_t>( a ) );
+		return ( !! _file.read( &event_.data[0], static_cast<streamsize>( a ) ) );
+	} else if ( type == 'r' ) {
+		if ( ! varint( a ) || ! varint( b ) ) {
+			return ( false );
+		}
+		event_.type = Event::TYPE::RESIZE;
+		event_.data.clear();
+		event_.columns = static_cast<int>( a );
+		event_.rows = static_cast<int>( b );
+		return ( true );
+	}
+	return ( false );
+}
+
+bool SessionReader::varint( uint64_t& value_ ) {
+	value_ = 0;
+	for ( int shift( 0 ); shift < 64; shift += 7 ) {
+		char c( 0 );
+		if ( ! _file.get( c ) ) {
+			return ( false );
+		}
+		value_ |= static_cast<uint64_t>( c & 0x7f ) << shift;
+		if ( ! ( c & 0x80 ) ) {
+			return ( true );
+		}
+	}
+	return ( false );
+}
+
+}
+
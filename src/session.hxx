@@ -0,0 +1,74 @@
+#ifndef REPLXX_SESSION_HXX_INCLUDED
+#define REPLXX_SESSION_HXX_INCLUDED 1
+
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace replxx {
+
+// Session file format, all integers are LEB128 varints:
+//
+//   magic "replxx-session 1\n"
+//   records:
+//     'i' <microseconds since previous record> <size> <raw input bytes>
+//     'r' <microseconds since previous record> <columns> <rows>
+//
+// Input is recorded exactly as read from the terminal, in chunks returned
+// by a single read, so replay reproduces how key sequences were split.
+class SessionRecorder {
+public:
+	typedef std::chrono::steady_clock clock_t;
+private:
+	std::ofstream _file;
+	clock_t::time_point _last;
+	int _columns;
+	int _rows;
+public:
+	SessionRecorder( void );
+	int open( std::string const& filename );
+	void close( void );
+	bool is_open( void ) const {
+		return ( _file.is_open() );
+	}
+	void input( char const* data, int size );
+	// Record screen size, does nothing if size has not changed since last record.
+	void resize( int columns, int rows );
+private:
+	void header( char type );
+	void varint( uint64_t );
+	SessionRecorder( SessionRecorder const& ) = delete;
+	SessionRecorder& operator = ( SessionRecorder const& ) = delete;
+};
+
+class SessionReader {
+public:
+	struct Event {
+		enum class TYPE {
+			INPUT,
+			RESIZE
+		};
+		TYPE type;
+		int long long delay; // microseconds since previous event
+		std::string data;
+		int columns;
+		int rows;
+	};
+private:
+	std::ifstream _file;
+public:
+	SessionReader( void );
+	int open( std::string const& filename );
+	// Read next event, false on end of file or malformed record.
+	bool next( Event& );
+private:
+	bool varint( uint64_t& );
+	SessionReader( SessionReader const& ) = delete;
+	SessionReader& operator = ( SessionReader const& ) = delete;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,174 @@
+#ifndef REPLXX_UNDOLOG_HXX_INCLUDED
+#define REPLXX_UNDOLOG_HXX_INCLUDED 1
+
+#include <deque>
+#include <vector>
+
+#include "editbuffer.hxx"
+
+namespace replxx {
+
+// Log of edits made to the line for undo/redo.
+//
+// Every edit is a record of position and the inserted or erased text,
+// no snapshots of the whole line are kept. Consecutive single character
+// inserts are merged into one record, edits made by a single action
+// (e.g. replacing completion context with the completion) are chained
+// so they are undone and redone together.
+// Text of all records lives in a single queue in record order, oldest
+// records are dropped once the log exceeds its size limit in bytes.
+class UndoLog {
+	struct Record {
+		int _position;   // where text was inserted or erased
+		int _length;     // length of inserted or erased text
+		int _text;       // index of the text in _text queue (counting dropped text)
+		int _cursor;     // cursor position before the edit
+		bool _erase;     // text was erased, otherwise inserted
+		bool _chained;   // undo together with the previous record
+	};
+	typedef std::deque<Record> records_t;
+	typedef std::deque<char32_t> text_t;
+	records_t _records;
+	text_t _text;
+	int _textBase;     // number of characters dropped from the front of _text
+	int _current;      // number of records currently applied, records past it can be redone
+	int _maxSize;      // in bytes, 0 means no undo
+	bool _sealed;      // do not merge next insert with the last record
+	bool _skipped;     // last edit was empty and was not recorded
+	std::vector<char32_t> _buffer;
+public:
+	UndoLog( void )
+		: _records()
+		, _text()
+		, _textBase( 0 )
+		, _current( 0 )
+		, _maxSize( 64 * 1024 )
+		, _sealed( true )
+		, _skipped( false )
+		, _buffer() {
+	}
+	void set_max_size( int maxSize_ ) {
+		_maxSize = maxSize_ > 0 ? maxSize_ : 0;
+		trim();
+	}
+	void clear( void ) {
+		_records.clear();
+		_text.clear();
+		_textBase = 0;
+		_current = 0;
+		_sealed = true;
+		_skipped = false;
+	}
+	void insert( int pos_, char32_t const* text_, int len_, int cursor_, bool chained_ = false ) {
+		if (
+			! chained_ && ! _sealed && ( len_ == 1 ) && ( _current > 0 )
+			&& ( _current == static_cast<int>( _records.size() ) )
+		) {
+			Record& last( _records.back() );
+			if ( ! last._erase && ( ( last._position + last._length ) == pos_ ) ) {
+				_text.push_back( *text_ );
+				++ last._length;
+				trim();
+				return;
+			}
+		}
+		add( pos_, text_, len_, cursor_, false, chained_ );
+		_sealed = chained_ || ( len_ != 1 );
+	}
+	void erase( int pos_, char32_t const* text_, int len_, int cursor_, bool chained_ = false ) {
+		add( pos_, text_, len_, cursor_, true, chained_ );
+		_sealed = true;
+	}
+	bool can_undo( void ) const {
+		return ( _current > 0 );
+	}
+	bool can_redo( void ) const {
+		return ( _current < static_cast<int>( _records.size() ) );
+	}
+	// Revert the last applied action, sets cursor_ to its position before the action.
+	bool undo( EditBuffer& data_, int& cursor_ ) {
+		if ( ! can_undo() ) {
+			return ( false );
+		}
+		_sealed = true;
+		while ( _current > 0 ) {
+			-- _current;
+			Record const& r( _records[_current] );
+			if ( r._erase ) {
+				data_.insert( r._position, text( r ), r._length );
+			} else {
+				data_.erase( r._position, r._length );
+			}
+			cursor_ = r._cursor;
+			if ( ! r._chained ) {
+				break;
+			}
+		}
+		return ( true );
+	}
+	// Apply the last reverted action again, sets cursor_ right after the edit.
+	bool redo( EditBuffer& data_, int& cursor_ ) {
+		if ( ! can_redo() ) {
+			return ( false );
+		}
+		_sealed = true;
+		do {
+			Record const& r( _records[_current] );
+			if ( r._erase ) {
+				data_.erase( r._position, r._length );
+				cursor_ = r._position;
+			} else {
+				data_.insert( r._position, text( r ), r._length );
+				cursor_ = r._position + r._length;
+			}
+			++ _current;
+		} while ( can_redo() && _records[_current]._chained );
+		return ( true );
+	}
+private:
+	void add( int pos_, char32_t const* text_, int len_, int cursor_, bool erase_, bool chained_ ) {
+		if ( len_ <= 0 ) {
+			_skipped = true;
+			return;
+		}
+		// nothing to chain to if first edit of the action was empty
+		chained_ = chained_ && ! _skipped && ( _current > 0 );
+		_skipped = false;
+		// a new edit makes reverted edits unreachable
+		if ( can_redo() ) {
+			_text.erase( _text.begin() + ( _records[_current]._text - _textBase ), _text.end() );
+			_records.erase( _records.begin() + _current, _records.end() );
+		}
+		_records.push_back( Record{ pos_, len_, _textBase + static_cast<int>( _text.size() ), cursor_, erase_, chained_ } );
+		_text.insert( _text.end(), text_, text_ + len_ );
+		++ _current;
+		trim();
+	}
+	char32_t const* text( Record const& r_ ) {
+		text_t::const_iterator it( _text.begin() + ( r_._text - _textBase ) );
+		_buffer.assign( it, it + r_._length );
+		return ( _buffer.data() );
+	}
+	int size( void ) const {
+		return ( static_cast<int>( _text.size() * sizeof ( char32_t ) + _records.size() * sizeof ( Record ) ) );
+	}
+	// Drop oldest actions (with all their chained records) until the log fits its size limit.
+	void trim( void ) {
+		while ( ! _records.empty() && ( size() > _maxSize ) ) {
+			do {
+				Record const& r( _records.front() );
+				_text.erase( _text.begin(), _text.begin() + r._length );
+				_textBase += r._length;
+				_records.pop_front();
+				if ( _current > 0 ) {
+					-- _current;
+				}
+			} while ( ! _records.empty() && _records.front()._chained );
+		}
+	}
+};
+
+}
+
+#endif
+
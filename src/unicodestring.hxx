@@ -1,32 +1,45 @@
 #ifndef REPLXX_UNICODESTRING_HXX_INCLUDED
 #define REPLXX_UNICODESTRING_HXX_INCLUDED
 
-#include <vector>
+#include <algorithm>
+#include <string>
 #include <cstring>
 
 #include "conversion.hxx"
 
 namespace replxx {
 
+// Sequence of Unicode code points.
+//
+// Strings of up to INLINE_CAPACITY characters (most hints, completions,
+// kill ring entries, search texts and color sequences) are stored inline
+// in the object itself, only longer ones are allocated on the heap.
+// Moving a heap allocated string steals its buffer, growing a string
+// at least doubles its capacity.
 class UnicodeString {
 public:
-	typedef std::vector<char32_t> data_buffer_t;
-	typedef data_buffer_t::const_iterator const_iterator;
-	typedef data_buffer_t::iterator iterator;
+	typedef char32_t const* const_iterator;
+	typedef char32_t* iterator;
+	static int const INLINE_CAPACITY = 16;
 private:
-	data_buffer_t _data;
+	char32_t* _data;
+	int _len;
+	int _capacity;
+	char32_t _inline[INLINE_CAPACITY];
 public:
 	UnicodeString()
-		: _data() {
+		: _data( _inline )
+		, _len( 0 )
+		, _capacity( INLINE_CAPACITY ) {
 	}
 
 	explicit UnicodeString( std::string const& src )
-		: _data() {
+		: UnicodeString() {
 		assign( src );
 	}
 
 	explicit UnicodeString( char const* src )
-		: _data() {
+		: UnicodeString() {
 		assign( src );
 	}
 
@@ -35,95 +48,127 @@ public:
 	}
 
 	explicit UnicodeString( char32_t const* src )
-		: _data() {
+		: UnicodeString() {
 		int len( 0 );
 		while ( src[len] != 0 ) {
 			++ len;
 		}
-		_data.assign( src, src + len );
+		append( src, len );
 	}
 
 	explicit UnicodeString( char32_t const* src, int len )
-		: _data() {
-		_data.assign( src, src + len );
+		: UnicodeString() {
+		append( src, len );
 	}
 
 	explicit UnicodeString( int len )
-		: _data() {
-		_data.resize( len );
+		: UnicodeString() {
+		reserve( len, false );
+		std::fill( _data, _data + len, 0 );
+		_len = len;
 	}
 
-	UnicodeString& assign( std::string const& str_ ) {
-		_data.resize( str_.length() );
-		int len( 0 );
-		copyString8to32( _data.data(), str_.length(), len, str_.c_str() );
-		_data.resize( len );
-		return *this;
+	explicit UnicodeString( UnicodeString const& other_ )
+		: UnicodeString() {
+		append( other_._data, other_._len );
 	}
 
-	UnicodeString& assign( char const* str_ ) {
-		size_t byteCount( strlen( str_ ) );
-		_data.resize( byteCount );
-		int len( 0 );
-		copyString8to32( _data.data(), byteCount, len, str_ );
-		_data.resize( len );
+	UnicodeString( UnicodeString&& other_ ) noexcept
+		: UnicodeString() {
+		steal( other_ );
+	}
+
+	~UnicodeString( void ) {
+		release();
+	}
+
+	UnicodeString& operator = ( UnicodeString const& other_ ) {
+		if ( &other_ != this ) {
+			_len = 0;
+			append( other_._data, other_._len );
+		}
 		return *this;
 	}
 
-	UnicodeString& assign( UnicodeString const& other_ ) {
-		_data = other_._data;
+	UnicodeString& operator = ( UnicodeString&& other_ ) noexcept {
+		if ( &other_ != this ) {
+			release();
+			steal( other_ );
+		}
 		return *this;
 	}
 
-	explicit UnicodeString( UnicodeString const& ) = default;
-	UnicodeString& operator = ( UnicodeString const& ) = default;
-	UnicodeString( UnicodeString&& ) = default;
-	UnicodeString& operator = ( UnicodeString&& ) = default;
+	UnicodeString& assign( std::string const& str_ ) {
+		return ( assign_utf8( str_.c_str(), static_cast<int>( str_.length() ) ) );
+	}
+
+	UnicodeString& assign( char const* str_ ) {
+		return ( assign_utf8( str_, static_cast<int>( strlen( str_ ) ) ) );
+	}
+
+	UnicodeString& assign( UnicodeString const& other_ ) {
+		return ( *this = other_ );
+	}
 
 	UnicodeString& append( UnicodeString const& other ) {
-		_data.insert( _data.end(), other._data.begin(), other._data.end() );
-		return *this;
+		return ( insert( _len, other._data, other._len ) );
 	}
 
 	UnicodeString& append( char32_t const* src, int len ) {
-		_data.insert( _data.end(), src, src + len );
-		return *this;
+		return ( insert( _len, src, len ) );
 	}
 
 	UnicodeString& insert( int pos_, UnicodeString const& str_, int offset_, int len_ ) {
-		_data.insert( _data.begin() + pos_, str_._data.begin() + offset_, str_._data.begin() + offset_ + len_ );
-		return *this;
+		return ( insert( pos_, str_._data + offset_, len_ ) );
 	}
 
 	UnicodeString& insert( int pos_, char32_t c_ ) {
-		_data.insert( _data.begin() + pos_, c_ );
+		return ( insert( pos_, &c_, 1 ) );
+	}
+
+	UnicodeString& insert( int pos_, char32_t const* str_, int len_ ) {
+		if ( ( _len + len_ ) > _capacity ) {
+			// str_ may point into this string, old buffer is released only after copying
+			int capacity( std::max( _len + len_, _capacity * 2 ) );
+			char32_t* data( new char32_t[capacity] );
+			std::copy( _data, _data + pos_, data );
+			std::copy( str_, str_ + len_, data + pos_ );
+			std::copy( _data + pos_, _data + _len, data + pos_ + len_ );
+			release();
+			_data = data;
+			_capacity = capacity;
+		} else {
+			std::copy_backward( _data + pos_, _data + _len, _data + _len + len_ );
+			std::copy( str_, str_ + len_, _data + pos_ );
+		}
+		_len += len_;
 		return *this;
 	}
 
 	UnicodeString& erase( int pos_ ) {
-		_data.erase( _data.begin() + pos_ );
-		return *this;
+		return ( erase( pos_, 1 ) );
 	}
 
 	UnicodeString& erase( int pos_, int len_ ) {
-		_data.erase( _data.begin() + pos_, _data.begin() + pos_ + len_ );
+		std::copy( _data + pos_ + len_, _data + _len, _data + pos_ );
+		_len -= len_;
 		return *this;
 	}
 
 	char32_t const* get() const {
-		return _data.data();
+		return _data;
 	}
 
 	char32_t* get() {
-		return _data.data();
+		return _data;
 	}
 
 	int length() const {
-		return static_cast<int>( _data.size() );
+		return _len;
 	}
 
 	void clear( void ) {
-		_data.clear();
+		_len = 0;
 	}
 
 	const char32_t& operator[]( size_t pos ) const {
@@ -135,23 +180,75 @@ public:
 	}
 
 	void swap( UnicodeString& other_ ) {
-		_data.swap( other_._data );
+		UnicodeString tmp( std::move( other_ ) );
+		other_ = std::move( *this );
+		*this = std::move( tmp );
 	}
 
 	const_iterator begin( void ) const {
-		return ( _data.begin() );
+		return ( _data );
 	}
 
 	const_iterator end( void ) const {
-		return ( _data.end() );
+		return ( _data + _len );
 	}
 
 	iterator begin( void ) {
-		return ( _data.begin() );
+		return ( _data );
 	}
 
 	iterator end( void ) {
-		return ( _data.end() );
+		return ( _data + _len );
+	}
+
+private:
+	UnicodeString& assign_utf8( char const* str_, int byteCount_ ) {
+		// never more code points than bytes
+		reserve( byteCount_, false );
+		int len( 0 );
+		copyString8to32( _data, byteCount_, len, str_, byteCount_ );
+		_len = len;
+		return *this;
+	}
+
+	bool is_inline( void ) const {
+		return ( _data == _inline );
+	}
+
+	void reserve( int capacity_, bool keep_ ) {
+		if ( capacity_ <= _capacity ) {
+			return;
+		}
+		int capacity( std::max( capacity_, _capacity * 2 ) );
+		char32_t* data( new char32_t[capacity] );
+		if ( keep_ ) {
+			std::copy( _data, _data + _len, data );
+		}
+		release();
+		_data = data;
+		_capacity = capacity;
+	}
+
+	void release( void ) {
+		if ( ! is_inline() ) {
+			delete [] _data;
+		}
+		_data = _inline;
+		_capacity = INLINE_CAPACITY;
+	}
+
+	// Take over other_'s text, leaves other_ empty, this must not own a heap buffer.
+	void steal( UnicodeString& other_ ) {
+		if ( other_.is_inline() ) {
+			std::copy( other_._data, other_._data + other_._len, _inline );
+		} else {
+			_data = other_._data;
+			_capacity = other_._capacity;
+			other_._data = other_._inline;
+			other_._capacity = INLINE_CAPACITY;
+		}
+		_len = other_._len;
+		other_._len = 0;
 	}
 };
 
@@ -6,8 +6,6 @@
 
 namespace replxx {
 
-int mk_wcwidth( char32_t );
-
 /**
  * Recompute widths of all characters in a char32_t buffer
  * @param text      - input buffer of Unicode characters
@@ -54,44 +52,33 @@ void calculate_screen_position(
 }
 
 /**
- * Calculate a column width using mk_wcswidth()
- * @param buf32 - text to calculate
- * @param len   - length of text to calculate
+ * Append base64 encoded data to a string
+ * @param data - data to encode
+ * @param size - size of data in bytes
+ * @param out  - string encoded data is appended to
  */
-int calculate_displayed_length( char32_t const* buf32_, int size_ ) {
-	int len( 0 );
-	for ( int i( 0 ); i < size_; ++ i ) {
-		char32_t c( buf32_[i] );
-		if ( c == '\033' ) {
-			int escStart( i );
-			++ i;
-			if ( ( i < size_ ) && ( buf32_[i] != '[' ) ) {
-				i = escStart;
-				++ len;
-				continue;
-			}
-			++ i;
-			for ( ; i < size_; ++ i ) {
-				c = buf32_[i];
-				if ( ( c != ';' ) && ( ( c < '0' ) || ( c > '9' ) ) ) {
-					break;
-				}
-			}
-			if ( ( i < size_ ) && ( buf32_[i] == 'm' ) ) {
-				continue;
-			}
-			i = escStart;
-			++ len;
-		} else {
-			int wcw( mk_wcwidth( c ) );
-			if ( wcw < 0 ) {
-				len = -1;
-				break;
-			}
-			len += wcw;
+void base64_encode( char const* data, int size, std::string& out ) {
+	static char const alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	unsigned char const* in( reinterpret_cast<unsigned char const*>( data ) );
+	out.reserve( out.length() + ( size + 2 ) / 3 * 4 );
+	int i( 0 );
+	for ( ; ( i + 2 ) < size; i += 3 ) {
+		unsigned int v( ( in[i] << 16 ) | ( in[i + 1] << 8 ) | in[i + 2] );
+		out.push_back( alphabet[( v >> 18 ) & 0x3f] );
+		out.push_back( alphabet[( v >> 12 ) & 0x3f] );
+		out.push_back( alphabet[( v >> 6 ) & 0x3f] );
+		out.push_back( alphabet[v & 0x3f] );
+	}
+	if ( i < size ) {
+		unsigned int v( in[i] << 16 );
+		if ( ( i + 1 ) < size ) {
+			v |= ( in[i + 1] << 8 );
 		}
+		out.push_back( alphabet[( v >> 18 ) & 0x3f] );
+		out.push_back( alphabet[( v >> 12 ) & 0x3f] );
+		out.push_back( ( i + 1 ) < size ? alphabet[( v >> 6 ) & 0x3f] : '=' );
+		out.push_back( '=' );
 	}
-	return ( len );
 }
 
 char const* ansi_color( Replxx::Color color_ ) {
@@ -10,9 +10,53 @@ inline bool is_control_code(char32_t testChar) {
 				 (testChar >= 0x7F && testChar <= 0x9F);	// DEL and C1 controls
 }
 
+int mk_wcwidth( char32_t );
 void recompute_character_widths( char32_t const* text, char* widths, int charCount );
 void calculate_screen_position( int x, int y, int screenColumns, int charCount, int& xOut, int& yOut );
-int calculate_displayed_length( char32_t const* buf32, int size );
+
+/**
+ * Calculate a column width using mk_wcswidth()
+ * @param buf32 - text to calculate, a char32_t array or an EditBuffer
+ * @param len   - length of text to calculate
+ */
+template<typename buffer_t>
+int calculate_displayed_length( buffer_t const& buf32_, int size_ ) {
+	int len( 0 );
+	for ( int i( 0 ); i < size_; ++ i ) {
+		char32_t c( buf32_[i] );
+		if ( c == '\033' ) {
+			int escStart( i );
+			++ i;
+			if ( ( i < size_ ) && ( buf32_[i] != '[' ) ) {
+				i = escStart;
+				++ len;
+				continue;
+			}
+			++ i;
+			for ( ; i < size_; ++ i ) {
+				c = buf32_[i];
+				if ( ( c != ';' ) && ( ( c < '0' ) || ( c > '9' ) ) ) {
+					break;
+				}
+			}
+			if ( ( i < size_ ) && ( buf32_[i] == 'm' ) ) {
+				continue;
+			}
+			i = escStart;
+			++ len;
+		} else {
+			int wcw( mk_wcwidth( c ) );
+			if ( wcw < 0 ) {
+				len = -1;
+				break;
+			}
+			len += wcw;
+		}
+	}
+	return ( len );
+}
+
+void base64_encode( char const* data, int size, std::string& out );
 char const* ansi_color( Replxx::Color );
 
 }
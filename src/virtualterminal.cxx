@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include "replxx.hxx"
+#include "conversion.hxx"
+#include "util.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+Replxx::VirtualTerminal::Cell const BLANK = { ' ', Replxx::Color::DEFAULT };
+
+}
+
+Replxx::VirtualTerminal::VirtualTerminal( int columns_, int rows_ )
+	: _columns( max( columns_, 1 ) )
+	, _rows( max( rows_, 1 ) )
+	, _cells()
+	, _input()
+	, _inputPos( 0 )
+	, _x( 0 )
+	, _y( 0 )
+	, _wrapPending( false )
+	, _color( Replxx::Color::DEFAULT )
+	, _bold( false )
+	, _background( false )
+	, _sequence()
+	, _utf8Pending( 0 )
+	, _utf8CodePoint( 0 )
+	, _bytesWritten( 0 )
+	, _bells( 0 )
+	, _rawMode( false ) {
+	reset();
+}
+
+void Replxx::VirtualTerminal::feed( char const* data_, int size_ ) {
+	// drop consumed input once it dominates the buffer
+	if ( _inputPos > ( _input.length() / 2 ) ) {
+		_input.erase( 0, _inputPos );
+		_inputPos = 0;
+	}
+	_input.append( data_, static_cast<size_t>( size_ ) );
+	notify_input();
+}
+
+void Replxx::VirtualTerminal::feed( std::string const& data_ ) {
+	feed( data_.data(), static_cast<int>( data_.length() ) );
+}
+
+int Replxx::VirtualTerminal::pending_input( void ) const {
+	return ( static_cast<int>( _input.length() - _inputPos ) );
+}
+
+void Replxx::VirtualTerminal::resize( int columns_, int rows_ ) {
+	_columns = max( columns_, 1 );
+	_rows = max( rows_, 1 );
+	reset();
+}
+
+void Replxx::VirtualTerminal::reset( void ) {
+	_cells.assign( static_cast<size_t>( _columns * _rows ), BLANK );
+	_x = 0;
+	_y = 0;
+	_wrapPending = false;
+	_color = Replxx::Color::DEFAULT;
+	_bold = false;
+	_background = false;
+	_sequence.clear();
+	_utf8Pending = 0;
+	_bytesWritten = 0;
+	_bells = 0;
+}
+
+int Replxx::VirtualTerminal::columns( void ) const {
+	return ( _columns );
+}
+
+int Replxx::VirtualTerminal::rows( void ) const {
+	return ( _rows );
+}
+
+Replxx::VirtualTerminal::Cell const& Replxx::VirtualTerminal::cell( int x_, int y_ ) const {
+	return ( _cells[static_cast<size_t>( y_ * _columns + x_ )] );
+}
+
+std::string Replxx::VirtualTerminal::line( int y_ ) const {
+	std::vector<char32_t> text;
+	text.reserve( static_cast<size_t>( _columns ) );
+	for ( int x( 0 ); x < _columns; ++ x ) {
+		char32_t c( cell( x, y_ ).character );
+		if ( c != 0 ) {
+			text.push_back( c );
+		}
+	}
+	while ( ! text.empty() && ( text.back() == ' ' ) ) {
+		text.pop_back();
+	}
+	int size( static_cast<int>( text.size() ) * 4 + 1 );
+	std::unique_ptr<char[]> utf8( new char[size] );
+	int count( 0 );
+	copyString32to8( utf8.get(), size, text.data(), static_cast<int>( text.size() ), &count );
+	return ( std::string( utf8.get(), static_cast<size_t>( count ) ) );
+}
+
+std::string Replxx::VirtualTerminal::screen( void ) const {
+	std::string s;
+	std::string::size_type used( 0 );
+	for ( int y( 0 ); y < _rows; ++ y ) {
+		if ( y > 0 ) {
+			s.push_back( '\n' );
+		}
+		std::string l( line( y ) );
+		s.append( l );
+		if ( ! l.empty() ) {
+			used = s.length();
+		}
+	}
+	s.erase( used );
+	return ( s );
+}
+
+int Replxx::VirtualTerminal::cursor_x( void ) const {
+	return ( _x );
+}
+
+int Replxx::VirtualTerminal::cursor_y( void ) const {
+	return ( _y );
+}
+
+int long long Replxx::VirtualTerminal::bytes_written( void ) const {
+	return ( _bytesWritten );
+}
+
+int Replxx::VirtualTerminal::bells( void ) const {
+	return ( _bells );
+}
+
+bool Replxx::VirtualTerminal::is_raw_mode( void ) const {
+	return ( _rawMode );
+}
+
+int Replxx::VirtualTerminal::read( char* data_, int size_ ) {
+	int count( min( size_, pending_input() ) );
+	memcpy( data_, _input.data() + _inputPos, static_cast<size_t>( count ) );
+	_inputPos += static_cast<size_t>( count );
+	return ( count );
+}
+
+bool Replxx::VirtualTerminal::input_ready( void ) {
+	// input is either pending or exhausted, read() never blocks
+	return ( true );
+}
+
+int Replxx::VirtualTerminal::screen_columns( void ) {
+	return ( _columns );
+}
+
+int Replxx::VirtualTerminal::screen_rows( void ) {
+	return ( _rows );
+}
+
+int Replxx::VirtualTerminal::enable_raw_mode( void ) {
+	_rawMode = true;
+	return ( 0 );
+}
+
+void Replxx::VirtualTerminal::disable_raw_mode( void ) {
+	_rawMode = false;
+}
+
+int Replxx::VirtualTerminal::write( char const* data_, int size_ ) {
+	_bytesWritten += size_;
+	for ( int i( 0 ); i < size_; ++ i ) {
+		unsigned char b( static_cast<unsigned char>( data_[i] ) );
+		if ( ! _sequence.empty() ) {
+			_sequence.push_back( static_cast<char>( b ) );
+			if ( _sequence.length() == 2 ) {
+				if ( ( b == '[' ) || ( b == ']' ) ) {
+					continue;
+				}
+				if ( b == 'c' ) {
+					// full reset
+					int long long bytesWritten( _bytesWritten );
+					int bells( _bells );
+					reset();
+					_bytesWritten = bytesWritten;
+					_bells = bells;
+				}
+				_sequence.clear();
+			} else if ( _sequence[1] == ']' ) {
+				// operating system command (e.g. clipboard) is not emulated, it ends with BEL or ST (ESC \)
+				if ( ( b == '\a' ) || ( ( b == '\\' ) && ( _sequence[_sequence.length() - 2] == '\033' ) ) ) {
+					_sequence.clear();
+				}
+			} else if ( ( b >= 0x40 ) && ( b <= 0x7e ) ) {
+				execute();
+				_sequence.clear();
+			}
+			continue;
+		}
+		if ( _utf8Pending > 0 ) {
+			if ( ( b & 0xc0 ) == 0x80 ) {
+				_utf8CodePoint = ( _utf8CodePoint << 6 ) | ( b & 0x3f );
+				if ( -- _utf8Pending == 0 ) {
+					put( _utf8CodePoint );
+				}
+				continue;
+			}
+			_utf8Pending = 0; // malformed sequence, retry b as a lead byte
+		}
+		if ( b == 0x1b ) {
+			_sequence.push_back( static_cast<char>( b ) );
+		} else if ( b < 0x20 ) {
+			control( static_cast<char>( b ) );
+		} else if ( b < 0x7f ) {
+			put( b );
+		} else if ( ( b >= 0xc0 ) && ( b <= 0xdf ) ) {
+			_utf8Pending = 1;
+			_utf8CodePoint = b & 0x1f;
+		} else if ( ( b >= 0xe0 ) && ( b <= 0xef ) ) {
+			_utf8Pending = 2;
+			_utf8CodePoint = b & 0x0f;
+		} else if ( ( b >= 0xf0 ) && ( b <= 0xf7 ) ) {
+			_utf8Pending = 3;
+			_utf8CodePoint = b & 0x07;
+		}
+	}
+	return ( size_ );
+}
+
+void Replxx::VirtualTerminal::put( char32_t c_ ) {
+	int width( mk_wcwidth( c_ ) );
+	if ( width == 0 ) {
+		return;
+	}
+	width = width > 1 ? 2 : 1;
+	if ( _wrapPending || ( ( width == 2 ) && ( _x == ( _columns - 1 ) ) && ( _columns > 1 ) ) ) {
+		_x = 0;
+		line_feed();
+	}
+	Replxx::Color color( _color );
+	if ( _background ) {
+		color = Replxx::Color::ERROR;
+	} else if ( _bold && ( color >= Replxx::Color::BLACK ) && ( color < Replxx::Color::GRAY ) ) {
+		color = static_cast<Replxx::Color>( static_cast<int>( color ) + 8 );
+	}
+	_cells[static_cast<size_t>( _y * _columns + _x )] = Cell{ c_, color };
+	if ( ( width == 2 ) && ( _x < ( _columns - 1 ) ) ) {
+		_cells[static_cast<size_t>( _y * _columns + _x + 1 )] = Cell{ 0, color };
+	}
+	_x += width;
+	if ( _x >= _columns ) {
+		_x = _columns - 1;
+		_wrapPending = true;
+	}
+}
+
+void Replxx::VirtualTerminal::control( char c_ ) {
+	switch ( c_ ) {
+		case ( '\r' ): {
+			_x = 0;
+		} break;
+		case ( '\n' ): {
+			// output post processing of a terminal in raw mode turns LF into CR LF
+			_x = 0;
+			line_feed();
+		} break;
+		case ( '\b' ): {
+			if ( _x > 0 ) {
+				-- _x;
+			}
+		} break;
+		case ( '\t' ): {
+			_x = min( ( _x / 8 + 1 ) * 8, _columns - 1 );
+		} break;
+		case ( '\a' ): {
+			++ _bells;
+		} return;
+		default: {
+		} return;
+	}
+	_wrapPending = false;
+}
+
+void Replxx::VirtualTerminal::execute( void ) {
+	char command( _sequence.back() );
+	char const* p( _sequence.c_str() + 2 );
+	if ( *p == '?' ) {
+		// private modes are not emulated
+		return;
+	}
+	std::vector<int> params;
+	while ( *p != command ) {
+		char* end( nullptr );
+		long value( strtol( p, &end, 10 ) );
+		params.push_back( end != p ? static_cast<int>( value ) : -1 );
+		p = end;
+		if ( *p == ';' ) {
+			++ p;
+		} else if ( *p != command ) {
+			return;
+		}
+	}
+	int n( ! params.empty() && ( params[0] > 0 ) ? params[0] : 1 );
+	switch ( command ) {
+		case ( 'A' ): _y = max( _y - n, 0 ); break;
+		case ( 'B' ): _y = min( _y + n, _rows - 1 ); break;
+		case ( 'C' ): _x = min( _x + n, _columns - 1 ); break;
+		case ( 'D' ): _x = max( _x - n, 0 ); break;
+		case ( 'G' ): _x = min( n, _columns ) - 1; break;
+		case ( 'H' ):
+		case ( 'f' ): {
+			_y = min( n, _rows ) - 1;
+			_x = ( params.size() > 1 ) && ( params[1] > 0 ) ? min( params[1], _columns ) - 1 : 0;
+		} break;
+		case ( 'J' ): {
+			int mode( params.empty() ? 0 : max( params[0], 0 ) );
+			int cursor( _y * _columns + _x );
+			if ( mode == 0 ) {
+				erase( cursor, _columns * _rows );
+			} else if ( mode == 1 ) {
+				erase( 0, cursor + 1 );
+			} else {
+				erase( 0, _columns * _rows );
+			}
+		} break;
+		case ( 'K' ): {
+			int mode( params.empty() ? 0 : max( params[0], 0 ) );
+			int lineStart( _y * _columns );
+			if ( mode == 0 ) {
+				erase( lineStart + _x, lineStart + _columns );
+			} else if ( mode == 1 ) {
+				erase( lineStart, lineStart + _x + 1 );
+			} else {
+				erase( lineStart, lineStart + _columns );
+			}
+		} break;
+		case ( 'm' ): {
+			set_attributes( params );
+		} return;
+		default: {
+		} return;
+	}
+	_wrapPending = false;
+}
+
+void Replxx::VirtualTerminal::set_attributes( std::vector<int> const& params_ ) {
+	if ( params_.empty() ) {
+		_color = Replxx::Color::DEFAULT;
+		_bold = false;
+		_background = false;
+		return;
+	}
+	for ( size_t i( 0 ); i < params_.size(); ++ i ) {
+		int p( params_[i] );
+		if ( p <= 0 ) {
+			_color = Replxx::Color::DEFAULT;
+			_bold = false;
+			_background = false;
+		} else if ( p == 1 ) {
+			_bold = true;
+		} else if ( p == 22 ) {
+			_bold = false;
+		} else if ( ( p >= 30 ) && ( p <= 37 ) ) {
+			_color = static_cast<Replxx::Color>( p - 30 );
+		} else if ( p == 39 ) {
+			_color = Replxx::Color::DEFAULT;
+		} else if ( ( p >= 90 ) && ( p <= 97 ) ) {
+			_color = static_cast<Replxx::Color>( p - 90 + 8 );
+		} else if ( ( ( p >= 40 ) && ( p <= 47 ) ) || ( ( p >= 100 ) && ( p <= 107 ) ) ) {
+			_background = true;
+		} else if ( p == 49 ) {
+			_background = false;
+		} else if ( ( p == 38 ) || ( p == 48 ) ) {
+			// 256 color form: 38;5;n
+			if ( ( i + 2 < params_.size() ) && ( params_[i + 1] == 5 ) ) {
+				if ( p == 38 ) {
+					_color = params_[i + 2] < 16 ? static_cast<Replxx::Color>( params_[i + 2] ) : Replxx::Color::DEFAULT;
+				} else {
+					_background = true;
+				}
+				i += 2;
+			}
+		}
+	}
+}
+
+void Replxx::VirtualTerminal::line_feed( void ) {
+	_wrapPending = false;
+	if ( _y < ( _rows - 1 ) ) {
+		++ _y;
+		return;
+	}
+	// scroll whole screen up by one row
+	std::copy( _cells.begin() + _columns, _cells.end(), _cells.begin() );
+	std::fill( _cells.end() - _columns, _cells.end(), BLANK );
+}
+
+void Replxx::VirtualTerminal::erase( int from_, int to_ ) {
+	std::fill( _cells.begin() + from_, _cells.begin() + to_, BLANK );
+}
+
+}
+
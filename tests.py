@@ -7,6 +7,10 @@ import os
 import subprocess
 import signal
 import time
+import select
+import fcntl
+import termios
+import struct
 
 keytab = {
 	"<home>": "\033[1~",
@@ -51,9 +55,12 @@ keytab = {
 	"<c-u>": "",
 	"<c-v>": "",
 	"<c-w>": "",
+	"<c-x>": "",
+	"<c-_>": "",
 	"<c-y>": "",
 	"<c-z>": "",
 	"<m-b>": "\033b",
+	"<m-_>": "\033_",
 	"<m-c>": "\033c",
 	"<m-d>": "\033d",
 	"<m-f>": "\033f",
@@ -155,6 +162,37 @@ _words_ = [
 def skip( test_ ):
 	return "SKIP" in os.environ and os.environ["SKIP"].find( test_ ) >= 0
 
+def read_session( path_ ):
+	with open( path_, "rb" ) as f:
+		session = f.read()
+	def varint( pos ):
+		value = 0
+		shift = 0
+		while True:
+			b = session[pos]
+			pos += 1
+			value |= ( b & 0x7f ) << shift
+			shift += 7
+			if b < 0x80:
+				return value, pos
+	assert session[:17] == b"replxx-session 1\n"
+	pos = 17
+	sizes = []
+	keys = b""
+	while pos < len( session ):
+		kind = session[pos:pos + 1]
+		delay, pos = varint( pos + 1 )
+		if kind == b"r":
+			columns, pos = varint( pos )
+			rows, pos = varint( pos )
+			sizes.append( ( columns, rows ) )
+		else:
+			assert kind == b"i"
+			size, pos = varint( pos )
+			keys += session[pos:pos + size]
+			pos += size
+	return sizes, keys
+
 verbosity = None
 
 class ReplxxTests( unittest.TestCase ):
@@ -602,6 +640,15 @@ class ReplxxTests( unittest.TestCase ):
 			dimensions = ( 8, 32 ),
 			command = cmd
 		)
+	def test_completion_listing_wide_characters( self_ ):
+		cmd = ReplxxTests._cSample_ + " q1 x漢字,漢字平仮名,abc,abcdefgh"
+		self_.check_scenario(
+			"<tab><cr><c-d>",
+			"<c9><ceos><c9>\r\n"
+			"漢字        漢字平仮名  abc         abcdefgh\r\n"
+			"<brightgreen>replxx<rst>> <c9><ceos><rst><c9><c9><ceos><rst><c9>\r\n",
+			command = cmd
+		)
 	def test_double_tab_completion( self_ ):
 		cmd = ReplxxTests._cSample_ + " d1 q1 x" + ",".join( _words_ )
 		self_.check_scenario(
@@ -618,6 +665,175 @@ class ReplxxTests( unittest.TestCase ):
 			"fortran\r\n",
 			command = cmd
 		)
+	def test_completion_cache( self_ ):
+		cmd = ReplxxTests._cSample_ + " d1 q1 t-1 x" + ",".join( _words_ )
+		self_.check_scenario(
+			"fo<tab><tab>r<tab><cr><c-d>",
+			"<c9><ceos>f<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        <gray>fortran<rst>\r\n"
+			"        <gray>fsharp<rst><u3><c10><c9><ceos>fo<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        <gray>fortran<rst><u2><c11><c9><ceos>fort<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        "
+			"<gray>fortran<rst><u2><c13><c9><ceos>fortr<rst><gray>an<rst><c14><c9><ceos>fortran<rst><c16><c9><ceos>fortran<rst><c16>\r\n"
+			"fortran\r\n",
+			command = cmd
+		)
+	def test_completion_index( self_ ):
+		# index words differ from callback words, last word has no trailing newline
+		with open( "replxx_words.txt", "w" ) as f:
+			f.write( "alpha\nfoobar\nfortissimo\nformat" )
+		cmd = ReplxxTests._cSample_ + " d1 q1 vreplxx_words.txt x" + ",".join( _words_ )
+		try:
+			self_.check_scenario(
+				"fo<tab><tab>rm<tab><cr><c-d>",
+				"<c9><ceos>f<rst>\r\n"
+				"        <gray>forth<rst>\r\n"
+				"        <gray>fortran<rst>\r\n"
+				"        <gray>fsharp<rst><u3><c10><c9><ceos>fo<rst>\r\n"
+				"        <gray>forth<rst>\r\n"
+				"        <gray>fortran<rst><u2><c11><c9><ceos>fo<rst><c11>\r\n"
+				"<brightmagenta>fo<rst>obar      <brightmagenta>fo<rst>rmat      "
+				"<brightmagenta>fo<rst>rtissimo\r\n"
+				"<brightgreen>replxx<rst>> <c9><ceos>fo<rst>\r\n"
+				"        <gray>forth<rst>\r\n"
+				"        <gray>fortran<rst><u2><c11><c9><ceos>for<rst>\r\n"
+				"        <gray>forth<rst>\r\n"
+				"        "
+				"<gray>fortran<rst><u2><c12><c9><ceos>form<rst><c13><c9><ceos>format<rst><c15><c9><ceos>format<rst><c15>\r\n"
+				"format\r\n",
+				command = cmd
+			)
+		finally:
+			os.remove( "replxx_words.txt" )
+	def test_async_completion_partial( self_ ):
+		# completer delivers first match at once and the rest much later,
+		# second Tab stops waiting and completes with what it has got so far
+		self_.check_scenario(
+			[ "fo<tab>", "<tab><cr><c-d>" ],
+			"<c9><ceos>f<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        <gray>fortran<rst>\r\n"
+			"        <gray>fsharp<rst><u3><c10><c9><ceos>fo<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        "
+			"<gray>fortran<rst><u2><c11><c9><ceos>fo<rst><gray>rth<rst><c11><c9><ceos>forth<rst><c14><c9><ceos>forth<rst><c14>\r\n"
+			"forth\r\n",
+			command = ReplxxTests._cSample_ + " q1 a5000 x" + ",".join( _words_ )
+		)
+	def test_async_completion_cancel( self_ ):
+		# any other key cancels pending request and is processed as usual
+		self_.check_scenario(
+			[ "fo<tab>", "x<cr><c-d>" ],
+			"<c9><ceos>f<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        <gray>fortran<rst>\r\n"
+			"        <gray>fsharp<rst><u3><c10><c9><ceos>fo<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        "
+			"<gray>fortran<rst><u2><c11><c9><ceos>fo<rst><gray>rth<rst><c11><c9><ceos>fo<rst>\r\n"
+			"        <gray>forth<rst>\r\n"
+			"        "
+			"<gray>fortran<rst><u2><c11><c9><ceos>fox<rst><c12><c9><ceos>fox<rst><c12>\r\n"
+			"fox\r\n",
+			command = ReplxxTests._cSample_ + " q1 a5000 x" + ",".join( _words_ )
+		)
+	def test_completion_menu( self_ ):
+		self_.check_scenario(
+			"ha<tab><down>n<cr><cr><c-d>",
+			"<c9><ceos>h<rst>\r\n"
+			"        <gray>hello<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u4><c10><c9><ceos>ha<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u3><c11><c9><ceos>ha<rst>\r\n"
+			"      <brightmagenta>> hallo<rst>\r\n"
+			"      <gray>  hans<rst>\r\n"
+			"        <gray>1/3<rst><u3><c11><c9><ceos>ha<rst>\r\n"
+			"      <gray>  hallo<rst>\r\n"
+			"      <brightmagenta>> hans<rst>\r\n"
+			"        <gray>2/3<rst><u3><c11><c9><ceos>han<rst>\r\n"
+			"      <brightmagenta>> hans<rst>\r\n"
+			"      <gray>  hansekogge<rst><u2><c12><c9><ceos>hans<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u2><c13><c9><ceos>hans<rst><c13>\r\n"
+			"hans\r\n",
+			command = ReplxxTests._cSample_ + " q1 u2"
+		)
+	def test_completion_menu_small_screen( self_ ):
+		# status line fits on screen too, wide characters are cut by their width
+		self_.check_scenario(
+			"zh<tab><pgdown><pgdown><c-c><cr><c-d>",
+			"<c9><ceos>z<rst>\r\n"
+			"        <gray>zha<rst>\r\n"
+			"        <gray>zhb<rst>\r\n"
+			"        <gray>zhc<rst>\r\n"
+			"        <gray>zhd<rst><u4><c10><c9><ceos>zh<rst>\r\n"
+			"        <gray>zha<rst>\r\n"
+			"        <gray>zhb<rst>\r\n"
+			"        <gray>zhc<rst>\r\n"
+			"        <gray>zhd<rst><u4><c11><c9><ceos>zh<rst>\r\n"
+			"      <brightmagenta>> zha<rst>\r\n"
+			"      <gray>  zhb<rst>\r\n"
+			"      <gray>  zhc<rst>\r\n"
+			"        <gray>1/5<rst><u4><c11><c9><ceos>zh<rst>\r\n"
+			"      <gray>  zhb<rst>\r\n"
+			"      <gray>  zhc<rst>\r\n"
+			"      <brightmagenta>> zhd<rst>\r\n"
+			"        <gray>4/5<rst><u4><c11><c9><ceos>zh<rst>\r\n"
+			"      <gray>  zhc<rst>\r\n"
+			"      <gray>  zhd<rst>\r\n"
+			"      <brightmagenta>> zh日本語日本<rst>\r\n"
+			"        <gray>5/5<rst><u4><c11><c9><ceos>zh<rst>\r\n"
+			"        <gray>zha<rst>\r\n"
+			"        <gray>zhb<rst>\r\n"
+			"        <gray>zhc<rst>\r\n"
+			"        <gray>zhd<rst><u4><c11><c9><ceos>zh<rst><c11>\r\n"
+			"zh\r\n",
+			command = ReplxxTests._cSample_ + " q1 u10 xzha,zhb,zhc,zhd,zh日本語日本語日本語",
+			dimensions = ( 6, 20 )
+		)
+	def test_fuzzy_completion( self_ ):
+		self_.check_scenario(
+			"hk<tab><cr>lo<tab><cr><c-d>",
+			"<c9><ceos>h<rst>\r\n"
+			"        <gray>hello<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        "
+			"<gray>hansekogge<rst><u4><c10><c9><ceos>hk<rst><c11><c9><ceos>hansekogge<rst><c19><c9><ceos>hansekogge<rst><c19>\r\n"
+			"hansekogge\r\n"
+			"<brightgreen>replxx<rst>> "
+			"<c9><ceos>l<rst><c10><c9><ceos>lo<rst><c11><c9><ceos>lo<rst><c11>\r\n"
+			"hallo         hello         quetzalcoatl\r\n"
+			"<brightgreen>replxx<rst>> <c9><ceos>lo<rst><c11><c9><ceos>lo<rst><c11>\r\n"
+			"lo\r\n",
+			command = ReplxxTests._cSample_ + " q1 n1 f3"
+		)
+	def test_fuzzy_completion_callback( self_ ):
+		# candidates of completion callback are ranked too, best first, only best f<n> kept
+		self_.check_scenario(
+			"ha<tab><tab><cr><c-d>",
+			"<c9><ceos>h<rst>\r\n"
+			"        <gray>hello<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u4><c10><c9><ceos>ha<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u3><c11><c9><ceos>ha<rst><c11>\r\n"
+			"<brightmagenta>ha<rst>ns   <brightmagenta>ha<rst>llo\r\n"
+			"<brightgreen>replxx<rst>> <c9><ceos>ha<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u3><c11><c9><ceos>ha<rst><c11>\r\n"
+			"ha\r\n",
+			command = ReplxxTests._cSample_ + " q1 d1 f2"
+		)
 	def test_beep_on_ambiguous_completion( self_ ):
 		cmd = ReplxxTests._cSample_ + " b1 d1 q1 x" + ",".join( _words_ )
 		self_.check_scenario(
@@ -1302,6 +1518,21 @@ class ReplxxTests( unittest.TestCase ):
 			command = [ ReplxxTests._cxxSample_, "123456" ],
 			pause = 0.5
 		)
+	def test_step_input( self_ ):
+		self_.check_scenario(
+			[ "a", "b", "c", "d", "e", "f<cr><c-d>" ],
+			"<c9><ceos><yellow>1<rst><c10><c9><ceos><yellow>1<rst>a"
+			"<rst><c11><c9><ceos><yellow>1<rst>ab<rst><c12><c9><ceos><yellow>1<rst>ab"
+			"<yellow>2<rst><c13><c9><ceos><yellow>1<rst>ab<yellow>2"
+			"<rst>c<rst><c14><c9><ceos><yellow>1<rst>ab<yellow>2"
+			"<rst>cd<rst><c15><c9><ceos><yellow>1<rst>ab<yellow>2<rst>cd<yellow>3"
+			"<rst><c16><c9><ceos><yellow>1<rst>ab<yellow>2<rst>cd<yellow>3<rst>e"
+			"<rst><c17><c9><ceos><yellow>1<rst>ab<yellow>2<rst>cd<yellow>3<rst>ef"
+			"<rst><c18><c9><ceos><yellow>1<rst>ab<yellow>2<rst>cd<yellow>3<rst>ef<rst><c18>\r\n"
+			"1ab2cd3ef\r\n",
+			command = [ ReplxxTests._cxxSample_, "123456", "step" ],
+			pause = 0.5
+		)
 	def test_special_keys( self_ ):
 		self_.check_scenario(
 			"<f1><f2><f3><f4><f5><f6><f7><f8><f9><f10><f11><f12>"
@@ -1333,6 +1564,301 @@ class ReplxxTests( unittest.TestCase ):
 			"<S-F12>\r\n"
 			"<c9><ceos><c9>\r\n"
 	)
+	def test_unknown_escape_sequence( self_ ):
+		self_.check_scenario(
+			"ab\033[99;5Xc<cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><bell><c9><ceos>ab<rst><c11>"
+			"<c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n"
+		)
+
+	def test_key_sequence( self_ ):
+		self_.check_scenario(
+			"ab<c-x><c-e>c<cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><C-x C-e>\r\n"
+			"<c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n"
+		)
+
+	def test_broken_key_sequence( self_ ):
+		self_.check_scenario(
+			"ab<c-x>c<cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><bell><c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n"
+		)
+
+	def test_key_sequence_timeout( self_ ):
+		self_.check_scenario(
+			[ "ab<c-x>", "c<cr><c-d>" ],
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><bell><c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n",
+			pause = 1.5
+		)
+
+	def test_step_input_key_sequence_timeout( self_ ):
+		# nothing is typed after sequence prefix, event loop wakes up on next_timeout()
+		# to let process_input() give up on the sequence
+		with open( "replxx_history.txt", "wb" ) as f:
+			f.write( b"one\ntwo\nthree\n" )
+		os.environ["TERM"] = "xterm"
+		rx = pexpect.spawn( ReplxxTests._cxxSample_, args = [ "a", "step" ], maxread = 1, encoding = "utf-8", dimensions = ( 25, 80 ) )
+		rx.expect( ReplxxTests._prompt_ )
+		time.sleep( 0.25 )
+		rx.send( "b\x18" )
+		rx.expect( "\x07", timeout = 2 )
+		rx.send( "c\r\x04" )
+		rx.expect( ReplxxTests._end_ )
+		self_.assertTrue( rx.before.endswith( "abc\r\n" + ReplxxTests._prompt_.replace( "\\", "" ) ) )
+
+	def test_step_input_lone_escape( self_ ):
+		# ESC not followed by anything is a key press of its own after key sequence timeout,
+		# so the next key is not taken for Meta modified one
+		with open( "replxx_history.txt", "wb" ) as f:
+			f.write( b"one\ntwo\nthree\n" )
+		os.environ["TERM"] = "xterm"
+		rx = pexpect.spawn( ReplxxTests._cxxSample_, args = [ "a", "step" ], maxread = 1, encoding = "utf-8", dimensions = ( 25, 80 ) )
+		rx.expect( ReplxxTests._prompt_ )
+		time.sleep( 0.25 )
+		rx.send( "b\x1b" )
+		rx.expect( "\x07", timeout = 2 )
+		rx.send( "bc\r\x04" )
+		rx.expect( ReplxxTests._end_ )
+		self_.assertTrue( rx.before.endswith( "abbc\r\n" + ReplxxTests._prompt_.replace( "\\", "" ) ) )
+
+	def test_undo_redo( self_ ):
+		self_.check_scenario(
+			"abc def<home><m-u><c-_><m-_><end><c-w><c-_><c-_><c-_><m-_><m-_><m-_><cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><c9><ceos>abc<rst><c12><c9><ceos>abc "
+			"<rst><c13><c9><ceos>abc d<rst><c14><c9><ceos>abc de<rst><c15><c9><ceos>abc "
+			"def<rst><c16><c9><ceos>abc def<rst><c9><c9><ceos>ABC "
+			"def<rst><c12><c9><ceos>abc def<rst><c9><c9><ceos>ABC "
+			"def<rst><c12><c9><ceos>ABC def<rst><c16><c9><ceos>ABC "
+			"<rst><c13><c9><ceos>ABC def<rst><c16><c9><ceos>abc "
+			"def<rst><c9><c9><ceos><rst><c9><c9><ceos>abc def<rst><c16><c9><ceos>ABC "
+			"def<rst><c12><c9><ceos>ABC <rst><c13><c9><ceos>ABC <rst><c13>\r\n"
+			"ABC \r\n"
+		)
+	def test_kill_ring_size( self_ ):
+		self_.check_scenario(
+			"a b c<c-w><backspace><c-w><backspace><c-w><c-y><m-y><m-y><cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>a <rst><c11><c9><ceos>a "
+			"b<rst><c12><c9><ceos>a b <rst><c13><c9><ceos>a b c<rst><c14><c9><ceos>a b "
+			"<rst><c13><c9><ceos>a b<rst><c12><c9><ceos>a "
+			"<rst><c11><c9><ceos>a<rst><c10><c9><ceos><rst><c9><c9><ceos>a<rst><c10><c9><ceos>b<rst><c10><c9><ceos>a<rst><c10><c9><ceos>a<rst><c10>\r\n"
+			"a\r\n",
+			command = ReplxxTests._cSample_ + " q1 k2"
+		)
+	def test_kill_ring_clipboard( self_ ):
+		self_.check_scenario(
+			"abc<c-w><cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><c9><ceos>abc<rst><c12><c9><ceos><rst><c9>\x1b]52;c;YWJj<bell><c9><ceos><rst><c9>\r\n",
+			command = ReplxxTests._cSample_ + " q1 y1"
+		)
+	def test_latency_report( self_ ):
+		self_.check_scenario(
+			"abc<cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n",
+			command = ReplxxTests._cSample_ + " q1 lreplxx_latency.txt"
+		)
+		with open( "replxx_latency.txt", "rb" ) as f:
+			report = f.read().decode().split( "\n" )
+		os.remove( "replxx_latency.txt" )
+		self_.assertSequenceEqual( [l.split()[0] for l in report[1:-1]], [ "read_key", "dispatch", "highlighter", "hint", "refresh", "write" ] )
+		self_.assertSequenceEqual( report[2].split()[1], "5" )
+	def test_callback_budget( self_ ):
+		self_.check_scenario(
+			"han<cr><c-d>",
+			"<c9><ceos>h<rst>\r\n"
+			"        <gray>hello<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u4><c10><c9><ceos>ha<rst>\r\n"
+			"        <gray>hallo<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u3><c11><c9><ceos>han<rst>\r\n"
+			"        <gray>hans<rst>\r\n"
+			"        <gray>hansekogge<rst><u2><c12><c9><ceos>han<rst><c12>\r\n"
+			"han\r\n",
+			command = ReplxxTests._cSample_ + " q1 g1000000"
+		)
+	def test_callback_budget_degradation( self_ ):
+		# highlighter takes 20ms against 1ms budget, every 3 overruns degrade it one level:
+		# skipped while typeahead waits, then deferred until input is idle for 100ms,
+		# then off for input as long as the one it was too slow for
+		self_.check_scenario(
+			[ "1", "2", "3", "456", "7", "8", "9", "0", "1", "2", "<cr><c-d>" ],
+			"<c9><ceos><brightmagenta>1<rst><c10><c9><ceos><brightmagenta>12<rst><c11><c9><ceos><brightmagenta>123<rst><c12>"
+			"<c9><ceos>1234<rst><c13><c9><ceos>12345<rst><c14><c9><ceos><brightmagenta>123456<rst><c15>"
+			"<c9><ceos><brightmagenta>1234567<rst><c16><c9><ceos><brightmagenta>12345678<rst><c17>"
+			"<c9><ceos>123456789<rst><c18><c9><ceos><brightmagenta>123456789<rst><c18>"
+			"<c9><ceos>1234567890<rst><c19><c9><ceos><brightmagenta>1234567890<rst><c19>"
+			"<c9><ceos>12345678901<rst><c20><c9><ceos><brightmagenta>12345678901<rst><c20>"
+			"<c9><ceos>123456789012<rst><c21><c9><ceos>123456789012<rst><c21>\r\n"
+			"123456789012\r\n"
+			"<brightgreen>replxx<rst>> \r\n",
+			command = ReplxxTests._cSample_ + " q1 g1000 z20",
+			end = "callbacks exceeded their budgets 9 times, degradation 3\r\nExiting Replxx\r\n"
+		)
+	def test_session_recording( self_ ):
+		self_.check_scenario(
+			"abc<cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n",
+			command = ReplxxTests._cSample_ + " q1 rreplxx_session.bin"
+		)
+		sizes, keys = read_session( "replxx_session.bin" )
+		os.remove( "replxx_session.bin" )
+		self_.assertSequenceEqual( sizes, [ ( 80, 25 ) ] )
+		self_.assertSequenceEqual( keys, b"abc\r\x04" )
+	@unittest.skipUnless( os.path.exists( "./build/replxx-bench" ), "replxx-bench not built" )
+	def test_simd_conversion( self_ ):
+		# fast paths of every instruction set the CPU supports convert exactly as scalar code
+		res = subprocess.run( [ "./build/replxx-bench", "--check", "conversion" ], stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+		self_.assertEqual( res.returncode, 0, res.stderr.decode() )
+		self_.assertRegex( res.stdout.decode(), "check none +0.00 mismatches" )
+	@unittest.skipUnless( os.path.exists( "./build/replxx-bench" ), "replxx-bench not built" )
+	def test_unicodestring_sso( self_ ):
+		# strings crossing inline capacity keep their content through copies, moves and edits
+		res = subprocess.run( [ "./build/replxx-bench", "--check", "unicodestring" ], stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+		self_.assertEqual( res.returncode, 0, res.stderr.decode() )
+		self_.assertRegex( res.stdout.decode(), "check sso +0.00 failures" )
+	@unittest.skipUnless( os.path.exists( "./build/replxx-replay" ), "replxx-replay not built" )
+	def test_session_replay( self_ ):
+		# screen size change is recorded when it happens, and replayed
+		with open( "replxx_history.txt", "wb" ) as f:
+			f.write( b"one\ntwo\nthree\n" )
+		os.environ["TERM"] = "xterm"
+		rx = pexpect.spawn( ReplxxTests._cSample_, args = [ "q1", "rreplxx_session.bin" ], maxread = 1, encoding = "utf-8", dimensions = ( 25, 80 ) )
+		rx.expect( ReplxxTests._prompt_ )
+		rx.send( "ab" )
+		time.sleep( 0.25 )
+		rx.setwinsize( 20, 60 )
+		time.sleep( 0.25 )
+		rx.send( "c\r\x04" )
+		rx.expect( "Exiting Replxx" )
+		rx.wait()
+		sizes, keys = read_session( "replxx_session.bin" )
+		self_.assertSequenceEqual( sizes, [ ( 80, 25 ), ( 60, 20 ) ] )
+		self_.assertSequenceEqual( keys, b"abc\r\x04" )
+		res = subprocess.run( [ "./build/replxx-replay", "replxx_session.bin" ], stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+		os.remove( "replxx_session.bin" )
+		self_.assertEqual( res.returncode, 0 )
+		self_.assertRegex( res.stdout.decode(), "^chunks [0-9]+, lines 1, " )
+	def test_virtual_terminal( self_ ):
+		# whole session runs on in-process virtual terminal, its screen is printed at exit,
+		# killed text is sent to clipboard with OSC 52 which must not be drawn (nor scroll the screen)
+		self_.check_scenario(
+			"",
+			"\r\n"
+			"|abc dXef|\r\n"
+			"|replxx> one two|\r\n"
+			"|one two|\r\n"
+			"|replxx> x|\r\n"
+			"|x|\r\n"
+			"|replxx>|\r\n"
+			"cursor: 8,5\r\n",
+			command = [ ReplxxTests._cSample_, "q1", "y1", "Vabc def\033[D\033[DX\rone two\rx " + "y" * 60 + "\x17\r\x04" ],
+			prompt = "starting\\.\\.\\.\r\n",
+			end = "Exiting Replxx\r\n"
+		)
+	def test_virtual_terminal_wide_wrap( self_ ):
+		# double width characters wrap as a whole, ctrl-l clears virtual screen
+		self_.check_scenario(
+			"",
+			"\r\n"
+			"|replxx> 日本語日本語日本語日本語日本語日|\r\n"
+			"|本語日本語日本語日本語日本語日本語日本語|\r\n"
+			"||\r\n"
+			"|日本語日本語日本語日本語日本語日本語日本|\r\n"
+			"|語日本語日本語日本語日本語日本語|\r\n"
+			"|replxx>|\r\n"
+			"cursor: 8,5\r\n",
+			command = [ ReplxxTests._cSample_, "q1", "Vfirst\r\x0c" + "日本語" * 12 + "\r\x04" ],
+			prompt = "starting\\.\\.\\.\r\n",
+			end = "Exiting Replxx\r\n"
+		)
+	def test_terminal_fds( self_ ):
+		self_.check_scenario(
+			"abc<cr>x<c-r>ab<cr><cr><c-d>",
+			"<c9><ceos>a<rst><c10><c9><ceos>ab<rst><c11><c9><ceos>abc<rst><c12><c9><ceos>abc<rst><c12>\r\n"
+			"abc\r\n"
+			"<brightgreen>replxx<rst>> "
+			"<c9><ceos>x<rst><c10><c1><ceos><c1><ceos>(reverse-i-search)`': "
+			"x<c24><c1><ceos>(reverse-i-search)`a': "
+			"abc<c24><c1><ceos>(reverse-i-search)`ab': "
+			"abc<c25><c1><ceos><brightgreen>replxx<rst>> abc<c9><c9><ceos>x<rst><c12>\r\n"
+			"abc\r\n"
+			"<brightgreen>replxx<rst>> <c9><ceos><c9>\r\n",
+			command = ReplxxTests._cSample_ + " q1 o"
+		)
+	def test_terminal_sessions( self_ ):
+		# two more sessions on their own pseudo terminals, each with its own Replxx instance
+		# driven step-wise by its own thread, screen size change is told with window_changed()
+		# from main thread and must only redraw half typed line, not accept it,
+		# process wide SIGWINCH must not redraw them
+		def set_size( fd, rows, columns ):
+			fcntl.ioctl( fd, termios.TIOCSWINSZ, struct.pack( "HHHH", rows, columns, 0, 0 ) )
+		def drain( fd ):
+			time.sleep( 0.25 )
+			data = b""
+			while select.select( [ fd ], [], [], 0 )[0]:
+				data += os.read( fd, 1024 )
+			return data.decode()
+		terminals = []
+		for i in range( 2 ):
+			master, slave = os.openpty()
+			set_size( master, 25, 80 )
+			terminals.append( ( master, slave ) )
+		( a, aSlave ), ( b, bSlave ) = terminals
+		with open( "replxx_history.txt", "wb" ) as f:
+			f.write( b"one\ntwo\nthree\n" )
+		os.environ["TERM"] = "xterm"
+		rx = pexpect.spawn(
+			ReplxxTests._cSample_, args = [ "q1", "S" + os.ttyname( aSlave ), "S" + os.ttyname( bSlave ) ],
+			maxread = 1, encoding = "utf-8", dimensions = ( 25, 80 )
+		)
+		rx.expect( ReplxxTests._prompt_ )
+		outA = drain( a )
+		outB = drain( b )
+		os.write( a, b"abc" )
+		os.write( b, b"xyz" )
+		outA += drain( a )
+		outB += drain( b )
+		set_size( a, 25, 40 )
+		rx.send( "/resize\r" )
+		rx.expect( ReplxxTests._prompt_ )
+		outA += drain( a )
+		outB += drain( b )
+		# SIGWINCH concerns standard terminal only
+		rx.kill( signal.SIGWINCH )
+		self_.assertEqual( drain( a ) + drain( b ), "" )
+		os.write( a, b"d\r" )
+		os.write( b, b"\r" )
+		outA += drain( a )
+		outB += drain( b )
+		os.write( a, b"\x04" )
+		os.write( b, b"\x04" )
+		outA += drain( a )
+		outB += drain( b )
+		rx.send( "\x04" )
+		rx.expect( "Exiting Replxx" )
+		rx.wait()
+		for fd in ( a, aSlave, b, bSlave ):
+			os.close( fd )
+		self_.maxDiff = None
+		self_.assertSequenceEqual(
+			seq_to_sym( outA ),
+			"session> abc<c1><ceos>session> abc<c13>d<c10><ceos><c14>\r\n"
+			"session 1 got: abcd\r\n"
+			"session> "
+		)
+		self_.assertSequenceEqual(
+			seq_to_sym( outB ),
+			"session> xyz<c1><ceos>session> xyz<c13><c10><ceos><c13>\r\n"
+			"session 2 got: xyz\r\n"
+			"session> "
+		)
 
 def parseArgs( self, func, argv ):
 	global verbosity